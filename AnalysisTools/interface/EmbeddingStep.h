@@ -0,0 +1,64 @@
+#ifndef UWVV_AnalysisTools_EmbeddingStep_h
+#define UWVV_AnalysisTools_EmbeddingStep_h
+
+
+// STL
+#include <vector>
+
+// CMSSW
+#include "FWCore/Framework/interface/Event.h"
+#include "FWCore/Framework/interface/ConsumesCollector.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/PluginManager/interface/PluginFactory.h"
+#include "DataFormats/Common/interface/Ptr.h"
+#include "DataFormats/Common/interface/View.h"
+
+
+namespace uwvv
+{
+
+  // One embedding step (e.g. "add a scale factor as a userFloat"), which
+  // modifies PAT objects in place. Steps can run alone (see
+  // PATObjectStepEmbedder) or several at once on the same copy of the
+  // collection (see PATObjectEmbedderChain).
+  //
+  // Steps get their parameters and register what they consume in the
+  // constructor, and get their event products in setEvent().
+  template<class T>
+  class EmbeddingStep
+  {
+   public:
+    typedef T Object;
+
+    EmbeddingStep(const edm::ParameterSet& config, edm::ConsumesCollector cc) {;}
+    virtual ~EmbeddingStep() {;}
+
+    // Called once per event before any objects are embedded
+    virtual void setEvent(const edm::Event& event) {;}
+
+    // Embed everything in obj, the working copy of original (which points
+    // to the object in the input collection)
+    virtual void embed(T& obj, const edm::Ptr<T>& original) = 0;
+
+    // Embed everything in all objects, where objs[i] is the working copy of
+    // originals[i]. Steps that can do a whole collection at once faster
+    // than one object at a time may override this.
+    virtual void embedAll(std::vector<T>& objs, const edm::View<T>& originals)
+    {
+      for(size_t i = 0; i < objs.size(); ++i)
+        embed(objs[i], originals.ptrAt(i));
+    }
+  };
+
+  template<class T>
+    using EmbeddingStepFactory =
+    edmplugin::PluginFactory<EmbeddingStep<T>*(const edm::ParameterSet&, edm::ConsumesCollector)>;
+
+} // namespace
+
+// Register a step of class STEP as a step for PAT objects of type T, so a
+// PATObjectEmbedderChain can make it from a PSet with type = NAME
+#define DEFINE_EMBEDDING_STEP(T, STEP, NAME) \
+  DEFINE_EDM_PLUGIN(uwvv::EmbeddingStepFactory<T>, STEP, NAME)
+
+#endif // header guard
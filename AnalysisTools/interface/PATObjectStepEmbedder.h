@@ -0,0 +1,60 @@
+#ifndef UWVV_AnalysisTools_PATObjectStepEmbedder_h
+#define UWVV_AnalysisTools_PATObjectStepEmbedder_h
+
+
+// system includes
+#include <memory>
+#include <vector>
+
+// CMS includes
+#include "FWCore/Framework/interface/Frameworkfwd.h"
+#include "FWCore/Framework/interface/stream/EDProducer.h"
+#include "FWCore/Framework/interface/Event.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "DataFormats/Common/interface/View.h"
+
+// UWVV
+#include "UWVV/AnalysisTools/interface/EmbeddingStep.h"
+
+
+// Module that runs one embedding step on its own: copies the collection
+// in src, embeds, and puts the copy in the event
+template<class Step>
+class PATObjectStepEmbedder : public edm::stream::EDProducer<>
+{
+  typedef typename Step::Object T;
+
+public:
+  explicit PATObjectStepEmbedder(const edm::ParameterSet& iConfig) :
+    srcToken_(consumes<edm::View<T> >(iConfig.getParameter<edm::InputTag>("src"))),
+    step_(iConfig, consumesCollector())
+  {
+    produces<std::vector<T> >();
+  }
+  virtual ~PATObjectStepEmbedder() {};
+
+private:
+  virtual void produce(edm::Event& iEvent, const edm::EventSetup& iSetup)
+  {
+    edm::Handle<edm::View<T> > in;
+    iEvent.getByToken(srcToken_, in);
+
+    step_.setEvent(iEvent);
+
+    std::unique_ptr<std::vector<T> > out(new std::vector<T>);
+    out->reserve(in->size());
+
+    for(size_t i = 0; i < in->size(); ++i)
+      out->push_back(in->at(i));
+
+    step_.embedAll(*out, *in);
+
+    iEvent.put(std::move(out));
+  }
+
+  const edm::EDGetTokenT<edm::View<T> > srcToken_;
+  Step step_;
+};
+
+
+#endif // header guard
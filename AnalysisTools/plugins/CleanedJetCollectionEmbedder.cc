@@ -1,11 +1,25 @@
 ///////////////////////////////////////////////////////////////////////////////
 //      CleanedJetCollectionEmbedder.cc
-//      
+//
 //      Create new jet collection from input collection by removing all
 //      jets which overlap a lepton candidate contained in the initial state.
 //      Overlap is defined as dR(lepton candidate, jet) < DR_input. Default
 //      overlap value is 0.4.Collection is named cleanedJets by default.
 //
+//      If jetVariationSrc is given, its jets (nominal jets with
+//      JetVariations embedded, see PATJetSmearing) are used to make the
+//      collections for each of the systematic variations listed in
+//      variations, instead of separate shifted jet collections. A jet is
+//      kept in a variation's collection if its varied pt is above
+//      variationPtCut, and the collection is sorted by varied pt. The jets
+//      in these collections are nominal, so the varied kinematics have to
+//      be taken from their JetVariations (see DijetSummary).
+//
+//      Many initial state candidates share the same leptons, so the cleaned
+//      collections are worked out once per set of final-state daughters
+//      (identified by their directions, which are all the cleaning depends
+//      on) per event and reused.
+//
 ///////////////////////////////////////////////////////////////////////////////
 
 
@@ -14,6 +28,9 @@
 #include <vector>
 #include <string>
 #include <iostream>
+#include <algorithm>
+#include <utility>
+#include <map>
 
 // CMS includes
 #include "FWCore/Framework/interface/Frameworkfwd.h"
@@ -24,8 +41,10 @@
 #include "DataFormats/PatCandidates/interface/CompositeCandidate.h"
 #include "DataFormats/PatCandidates/interface/Jet.h"
 #include "DataFormats/Common/interface/View.h"
+#include "FWCore/Utilities/interface/Exception.h"
 
-#include "UWVV/Utilities/interface/helpers.h"
+#include "UWVV/DataFormats/interface/JetVariations.h"
+#include "UWVV/Utilities/interface/DeltaRKernels.h"
 
 typedef pat::CompositeCandidate CCand;
 
@@ -39,51 +58,117 @@ public:
 private:
   virtual void produce(edm::Event& iEvent, const edm::EventSetup& iSetup);
 
-  edm::PtrVector<pat::Jet> getCleanedJetCollection(edm::Event& iEvent,
-      const edm::EDGetTokenT<edm::View<pat::Jet>>& jetToken, 
-      const reco::CompositeCandidate& initialState);
+  // One input jet collection, with its jet directions laid out flat once
+  // per event
+  struct JetSource
+  {
+    edm::EDGetTokenT<edm::View<pat::Jet> > token;
+    edm::Handle<edm::View<pat::Jet> > jets;
+    uwvv::dr::EtaPhiArrays<double> directions;
+    std::vector<char> overlaps; // for the daughters being cleaned against
+  };
+
+  // One embedded collection: the jets from a source, with a variation from
+  // their JetVariations applied (NONE for jets used as they are)
+  struct Output
+  {
+    std::string label;
+    size_t source;
+    JetVariations::Variation variation;
+  };
+
+  typedef std::vector<std::pair<double, double> > DaughterKey;
+  typedef std::vector<edm::PtrVector<pat::Jet> > CleanedCollections;
+
+  void addSource(const edm::ParameterSet& iConfig, const std::string& param,
+                 const std::string& label, bool optional=true);
+
+  // Put the final daughters' directions in daughters
+  void flattenDaughters(const reco::Candidate& mother);
+
+  // Cleaned collections for all outputs, for the current daughters
+  void clean(CleanedCollections& cleaned);
 
   const edm::EDGetTokenT<edm::View<CCand> > srcToken;
-  const edm::EDGetTokenT<edm::View<pat::Jet> > jetSrcToken;
 
   const std::string collectionName;
   const double deltaR;
 
-  edm::EDGetTokenT<edm::View<pat::Jet> > jesUpJetSrcToken;
-  edm::EDGetTokenT<edm::View<pat::Jet> > jesDownJetSrcToken;
-  edm::EDGetTokenT<edm::View<pat::Jet> > jerUpJetSrcToken;
-  edm::EDGetTokenT<edm::View<pat::Jet> > jerDownJetSrcToken;
-  bool jesUpTagExists;
-  bool jesDownTagExists;
-  bool jerUpTagExists;
-  bool jerDownTagExists;
+  std::vector<JetSource> sources;
+  std::vector<Output> outputs;
 
-  typedef const edm::Ptr<reco::Candidate> (FType) (const reco::Candidate* const);
+  bool jetVariationTagExists;
+  size_t jetVariationSource;
+  const double variationPtCut;
+
+  // Per-event varied pt of each jet in the variation source, by variation
+  std::vector<std::vector<float> > variedPts;
+
+  // Per-candidate buffers, kept to avoid reallocating
+  uwvv::dr::EtaPhiArrays<double> daughters;
+  DaughterKey daughterKey;
+  std::vector<std::pair<float, size_t> > variedJets; // (varied pt, index)
+
+  // Cleaned collections already worked out this event
+  std::map<DaughterKey, CleanedCollections> cache;
 };
 
 
 CleanedJetCollectionEmbedder::CleanedJetCollectionEmbedder(const edm::ParameterSet& iConfig) :
   srcToken(consumes<edm::View<CCand> >(iConfig.getParameter<edm::InputTag>("src"))),
-  jetSrcToken(consumes<edm::View<pat::Jet> >(iConfig.getParameter<edm::InputTag>("jetSrc"))),
   collectionName(iConfig.getUntrackedParameter<std::string>("collectionName", "cleanedJets")),
   deltaR(iConfig.getUntrackedParameter<double>("deltaR", 0.4)),
-  jesUpTagExists(iConfig.existsAs<edm::InputTag>("jesUpJetSrc")),
-  jesDownTagExists(iConfig.existsAs<edm::InputTag>("jesDownJetSrc")),
-  jerUpTagExists(iConfig.existsAs<edm::InputTag>("jerUpJetSrc")),
-  jerDownTagExists(iConfig.existsAs<edm::InputTag>("jerDownJetSrc"))
+  jetVariationTagExists(iConfig.existsAs<edm::InputTag>("jetVariationSrc")),
+  jetVariationSource(0),
+  variationPtCut(iConfig.exists("variationPtCut") ?
+                 iConfig.getParameter<double>("variationPtCut") : 30.)
 {
-  if (jesUpTagExists) 
-      jesUpJetSrcToken = consumes<edm::View<pat::Jet> >(iConfig.getParameter<edm::InputTag>("jesUpJetSrc"));
-  if (jesDownTagExists) 
-      jesDownJetSrcToken = consumes<edm::View<pat::Jet> >(iConfig.getParameter<edm::InputTag>("jesDownJetSrc"));
-  if (jerUpTagExists) 
-      jerUpJetSrcToken = consumes<edm::View<pat::Jet> >(iConfig.getParameter<edm::InputTag>("jerUpJetSrc"));
-  if (jerDownTagExists) 
-      jerDownJetSrcToken = consumes<edm::View<pat::Jet> >(iConfig.getParameter<edm::InputTag>("jerDownJetSrc"));
+  addSource(iConfig, "jetSrc", collectionName, false);
+  addSource(iConfig, "jesUpJetSrc", collectionName+"_jesUp");
+  addSource(iConfig, "jesDownJetSrc", collectionName+"_jesDown");
+  addSource(iConfig, "jerUpJetSrc", collectionName+"_jerUp");
+  addSource(iConfig, "jerDownJetSrc", collectionName+"_jerDown");
+
+  if (jetVariationTagExists)
+    {
+      jetVariationSource = sources.size();
+      sources.push_back(JetSource());
+      sources.back().token = consumes<edm::View<pat::Jet> >(iConfig.getParameter<edm::InputTag>("jetVariationSrc"));
+
+      for(const auto& name : iConfig.getParameter<std::vector<std::string> >("variations"))
+        {
+          JetVariations::Variation v = JetVariations::variation(name);
+          if(v == JetVariations::NONE)
+            throw cms::Exception("UnknownVariation")
+              << "Unknown jet variation " << name << std::endl;
+
+          Output output = {collectionName+"_"+name, jetVariationSource, v};
+          outputs.push_back(output);
+        }
+    }
+
+  variedPts.resize(JetVariations::N_VARIATIONS);
+
   produces<std::vector<CCand> >();
 }
 
 
+void CleanedJetCollectionEmbedder::addSource(const edm::ParameterSet& iConfig,
+                                             const std::string& param,
+                                             const std::string& label,
+                                             bool optional)
+{
+  if(optional && !iConfig.existsAs<edm::InputTag>(param))
+    return;
+
+  Output output = {label, sources.size(), JetVariations::NONE};
+  outputs.push_back(output);
+
+  sources.push_back(JetSource());
+  sources.back().token = consumes<edm::View<pat::Jet> >(iConfig.getParameter<edm::InputTag>(param));
+}
+
+
 void CleanedJetCollectionEmbedder::produce(edm::Event& iEvent,
                                             const edm::EventSetup& iSetup)
 {
@@ -92,56 +177,123 @@ void CleanedJetCollectionEmbedder::produce(edm::Event& iEvent,
 
   iEvent.getByToken(srcToken, in);
 
+  // Everything about the jets is done once per event
+  for(auto& source : sources)
+    {
+      iEvent.getByToken(source.token, source.jets);
+
+      source.directions.clear();
+      for(size_t j = 0; j < source.jets->size(); ++j)
+        source.directions.add(source.jets->at(j).p4());
+    }
+
+  if(jetVariationTagExists)
+    {
+      const edm::View<pat::Jet>& jets = *sources[jetVariationSource].jets;
+      for(const auto& output : outputs)
+        {
+          if(output.variation == JetVariations::NONE)
+            continue;
+
+          std::vector<float>& pts = variedPts[output.variation];
+          pts.resize(jets.size());
+          for(size_t j = 0; j < jets.size(); ++j)
+            {
+              const pat::Jet& jet = jets.at(j);
+              pts[j] = jet.pt();
+              if(jet.hasUserData("jetVariations"))
+                pts[j] = jet.userData<JetVariations>("jetVariations")->pt(jet, output.variation);
+            }
+        }
+    }
+
+  cache.clear();
+
   for(size_t i = 0; i < in->size(); ++i)
     {
-      edm::PtrVector<pat::Jet> cleanedJesUpJets;
       edm::Ptr<CCand> cand = in->ptrAt(i);
 
-      out->push_back(*cand);
-      edm::PtrVector<pat::Jet> cleanedJets = getCleanedJetCollection(iEvent, jetSrcToken, *cand);
-      out->back().addUserData<edm::PtrVector<pat::Jet>>(collectionName, cleanedJets);
-      
-      if(jesUpTagExists) 
-        { 
-          edm::PtrVector<pat::Jet> cleanedJesUpJets = getCleanedJetCollection(iEvent, jesUpJetSrcToken, *cand);
-          out->back().addUserData<edm::PtrVector<pat::Jet>>(collectionName+"_jesUp", cleanedJesUpJets);
-        }
-      if(jesDownTagExists) 
-        { 
-          edm::PtrVector<pat::Jet> cleanedJesDownJets = getCleanedJetCollection(iEvent, jesDownJetSrcToken, *cand);
-          out->back().addUserData<edm::PtrVector<pat::Jet>>(collectionName+"_jesDown", cleanedJesDownJets);
-        }
-      if(jerUpTagExists) 
-        { 
-          edm::PtrVector<pat::Jet> cleanedJerUpJets = getCleanedJetCollection(iEvent, jerUpJetSrcToken, *cand);
-          out->back().addUserData<edm::PtrVector<pat::Jet>>(collectionName+"_jerUp", cleanedJerUpJets);
-        }
-      if(jerDownTagExists) 
-        { 
-          edm::PtrVector<pat::Jet> cleanedJerDownJets = getCleanedJetCollection(iEvent, jerDownJetSrcToken, *cand);
-          out->back().addUserData<edm::PtrVector<pat::Jet>>(collectionName+"_jerDown", cleanedJerDownJets);
+      daughters.clear();
+      flattenDaughters(*cand);
+
+      daughterKey.clear();
+      for(size_t k = 0; k < daughters.size(); ++k)
+        daughterKey.push_back(std::make_pair(daughters.eta[k], daughters.phi[k]));
+      std::sort(daughterKey.begin(), daughterKey.end());
+
+      auto found = cache.find(daughterKey);
+      if(found == cache.end())
+        {
+          found = cache.insert(std::make_pair(daughterKey, CleanedCollections())).first;
+          clean(found->second);
         }
+
+      out->push_back(*cand);
+      for(size_t iOut = 0; iOut < outputs.size(); ++iOut)
+        out->back().addUserData<edm::PtrVector<pat::Jet>>(outputs[iOut].label,
+                                                         found->second[iOut]);
     }
-      
+
   iEvent.put(std::move(out));
 }
 
-edm::PtrVector<pat::Jet> CleanedJetCollectionEmbedder::getCleanedJetCollection(edm::Event& iEvent,
-    const edm::EDGetTokenT<edm::View<pat::Jet>>& jetToken, 
-    const reco::CompositeCandidate& initialState) 
+
+void CleanedJetCollectionEmbedder::flattenDaughters(const reco::Candidate& mother)
+{
+  if(!mother.numberOfDaughters())
+    {
+      daughters.add(mother.p4());
+      return;
+    }
+
+  for(size_t i = 0; i < mother.numberOfDaughters(); ++i)
+    flattenDaughters(*mother.daughter(i));
+}
+
+
+void CleanedJetCollectionEmbedder::clean(CleanedCollections& cleaned)
 {
-  edm::Handle<edm::View<pat::Jet> > uncleanedJets;
-  edm::PtrVector<pat::Jet> cleanedJets; 
+  // same precision as the float cut this used to be
+  const double dR = float(deltaR);
 
-  iEvent.getByToken(jetToken, uncleanedJets);
+  for(auto& source : sources)
+    uwvv::dr::markWithinAny(source.directions, daughters, dR * dR,
+                            source.overlaps);
 
-  for(size_t j = 0; j < uncleanedJets->size(); ++j)
+  cleaned.resize(outputs.size());
+  for(size_t iOut = 0; iOut < outputs.size(); ++iOut)
     {
-      if(!uwvv::helpers::overlapWithAnyDaughter(uncleanedJets->at(j), initialState, deltaR)) 
-          cleanedJets.push_back(uncleanedJets->ptrAt(j));
+      const Output& output = outputs[iOut];
+      const JetSource& source = sources[output.source];
+      edm::PtrVector<pat::Jet>& cleanedJets = cleaned[iOut];
+
+      if(output.variation == JetVariations::NONE)
+        {
+          for(size_t j = 0; j < source.overlaps.size(); ++j)
+            {
+              if(!source.overlaps[j])
+                cleanedJets.push_back(source.jets->ptrAt(j));
+            }
+          continue;
+        }
+
+      const std::vector<float>& pts = variedPts[output.variation];
+
+      variedJets.clear();
+      for(size_t j = 0; j < source.overlaps.size(); ++j)
+        {
+          if(!source.overlaps[j] && pts[j] > variationPtCut)
+            variedJets.push_back(std::make_pair(pts[j], j));
+        }
+
+      std::stable_sort(variedJets.begin(), variedJets.end(),
+                       [](const std::pair<float, size_t>& a,
+                          const std::pair<float, size_t>& b)
+                       {return a.first > b.first;});
+
+      for(const auto& vj : variedJets)
+        cleanedJets.push_back(source.jets->ptrAt(vj.second));
     }
-    return cleanedJets;
 }
 
 DEFINE_FWK_MODULE(CleanedJetCollectionEmbedder);
-
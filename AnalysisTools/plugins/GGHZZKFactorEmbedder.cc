@@ -16,7 +16,8 @@
 #include <vector>
 #include <string>
 #include <iostream>
-#include <map>
+#include <utility>
+#include <algorithm>
 
 // CMS includes
 #include "FWCore/Framework/interface/Frameworkfwd.h"
@@ -29,10 +30,10 @@
 #include "DataFormats/PatCandidates/interface/Muon.h"
 #include "DataFormats/Common/interface/View.h"
 #include "DataFormats/Math/interface/deltaR.h"
+#include "FWCore/Utilities/interface/transform.h"
 
-// ROOT includes
-#include "TSpline.h"
-#include "TFile.h"
+// UWVV
+#include "UWVV/Utilities/interface/SplineTable.h"
 
 typedef pat::CompositeCandidate CCand;
 
@@ -50,11 +51,16 @@ class GGHZZKFactorEmbedder : public edm::stream::EDProducer<>
 
   const edm::EDGetTokenT<edm::View<CCand> > srcToken;
 
-  const std::unique_ptr<TFile> file;
-  
-  const std::map<std::string, TSpline3*> splines;
+  // userFloat labels, in the same order as the splines in the table
+  const std::vector<std::string> labels;
 
-  std::map<std::string, TSpline3*> getSplines() const;
+  // All variations tabulated together, shared by all modules and streams
+  // using the same file
+  const std::shared_ptr<const uwvv::SplineTable> splines;
+
+  std::vector<float> kFactors;
+
+  static const std::vector<std::pair<std::string, std::string> >& splineNames();
   float getGenMass(const CCand& cand) const;
 };
 
@@ -62,14 +68,13 @@ class GGHZZKFactorEmbedder : public edm::stream::EDProducer<>
 template<class T12, class T34>
 GGHZZKFactorEmbedder<T12,T34>::GGHZZKFactorEmbedder(const edm::ParameterSet& iConfig) :
   srcToken(consumes<edm::View<CCand> >(iConfig.getParameter<edm::InputTag>("src"))),
-  file(new TFile(iConfig.getParameter<std::string>("fileName").c_str())),
-  splines(getSplines())
+  labels(edm::vector_transform(splineNames(),
+                               [](const std::pair<std::string, std::string>& p){return p.first;})),
+  splines(uwvv::SplineTableCache::get(iConfig.getParameter<std::string>("fileName"),
+                                      edm::vector_transform(splineNames(),
+                                                            [](const std::pair<std::string, std::string>& p){return p.second;}))),
+  kFactors(labels.size(), 1.)
 {
-  if(file->IsZombie())
-    throw cms::Exception("InvalidFile") 
-      << "Scale factor file "<< iConfig.getParameter<std::string>("fileName")
-      << " does not exist!" << std::endl;
-
   produces<std::vector<CCand> >();
 }
 
@@ -91,39 +96,37 @@ void GGHZZKFactorEmbedder<T12,T34>::produce(edm::Event& iEvent,
 
       float mGen = getGenMass(cand);
 
-      for(auto& iSpl : splines)
-        {
-          float kFactor = 1.;
-          if(mGen > 0.)
-            kFactor = iSpl.second->Eval(mGen);
+      if(mGen > 0.)
+        splines->eval(mGen, kFactors.data());
+      else
+        std::fill(kFactors.begin(), kFactors.end(), 1.);
 
-          cand.addUserFloat(iSpl.first, kFactor);
-        }
+      for(size_t iSpl = 0; iSpl < labels.size(); ++iSpl)
+        cand.addUserFloat(labels[iSpl], kFactors[iSpl]);
     }
 
   iEvent.put(std::move(out));
 }
 
 
+// (userFloat label, spline name in the file)
 template<class T12, class T34>
-std::map<std::string, TSpline3*> GGHZZKFactorEmbedder<T12,T34>::getSplines() const
+const std::vector<std::pair<std::string, std::string> >&
+GGHZZKFactorEmbedder<T12,T34>::splineNames()
 {
-  std::map<std::string, TSpline3*> out;
-
-  if(file->IsZombie() || !file->IsOpen())
-    return out;
-
-  out["kFactor"] = (TSpline3*)file->Get("sp_kfactor_Nominal");
-  out["kFactorPDFScaleUp"] = (TSpline3*)file->Get("sp_kfactor_PDFScaleUp");
-  out["kFactorPDFScaleDn"] = (TSpline3*)file->Get("sp_kfactor_PDFScaleDn");
-  out["kFactorQCDScaleUp"] = (TSpline3*)file->Get("sp_kfactor_QCDScaleUp");
-  out["kFactorQCDScaleDn"] = (TSpline3*)file->Get("sp_kfactor_QCDScaleDn");
-  out["kFactorAsUp"] = (TSpline3*)file->Get("sp_kfactor_AsUp");
-  out["kFactorAsDn"] = (TSpline3*)file->Get("sp_kfactor_AsDn");
-  out["kFactorPDFReplicaUp"] = (TSpline3*)file->Get("sp_kfactor_PDFReplicaUp");
-  out["kFactorPDFReplicaDn"] = (TSpline3*)file->Get("sp_kfactor_PDFReplicaDn");
-
-  return out;
+  static const std::vector<std::pair<std::string, std::string> > names = {
+    {"kFactor", "sp_kfactor_Nominal"},
+    {"kFactorPDFScaleUp", "sp_kfactor_PDFScaleUp"},
+    {"kFactorPDFScaleDn", "sp_kfactor_PDFScaleDn"},
+    {"kFactorQCDScaleUp", "sp_kfactor_QCDScaleUp"},
+    {"kFactorQCDScaleDn", "sp_kfactor_QCDScaleDn"},
+    {"kFactorAsUp", "sp_kfactor_AsUp"},
+    {"kFactorAsDn", "sp_kfactor_AsDn"},
+    {"kFactorPDFReplicaUp", "sp_kfactor_PDFReplicaUp"},
+    {"kFactorPDFReplicaDn", "sp_kfactor_PDFReplicaDn"},
+  };
+
+  return names;
 }
 
 
@@ -4,6 +4,9 @@
 //    
 //    Reimplementation of PATCleaner that works with gen particle types.
 //    Only does delta-R cross cleaning; other functionality removed.
+//    Configured like PATCleaner (checkOverlaps PSets with src,
+//    preselection, and deltaR), but the overlap checks use flat arrays
+//    of the other collections' directions instead of pat::OverlapTest.
 //    
 //    Nate Woods, U. Wisconsin
 //    Based on https://github.com/cms-sw/cmssw/blob/CMSSW_8_1_X/PhysicsTools/PatAlgos/plugins/PATCleaner.h
@@ -17,11 +20,13 @@
 #include "FWCore/Utilities/interface/InputTag.h"
 #include "CommonTools/Utils/interface/StringObjectFunction.h"
 #include "CommonTools/Utils/interface/StringCutObjectSelector.h"
-#include "PhysicsTools/PatAlgos/interface/OverlapTest.h"
 
 #include "DataFormats/HepMCCandidate/interface/GenParticle.h"
 #include "DataFormats/JetReco/interface/GenJet.h"
 #include "DataFormats/PatCandidates/interface/PackedGenParticle.h"
+#include "DataFormats/Candidate/interface/Candidate.h"
+
+#include "UWVV/Utilities/interface/DeltaRKernels.h"
 
 #include "FWCore/Framework/interface/MakerMacros.h"
 
@@ -47,8 +52,19 @@ namespace uwvv {
     const Selector preselector;
     const Selector finalSelector;
 
-    typedef pat::helper::OverlapTest OverlapTest;
-    std::vector<std::unique_ptr<OverlapTest> > overlapTests;
+    // Objects to clean against, refilled each event
+    struct OverlapCollection
+    {
+      OverlapCollection(const edm::EDGetTokenT<edm::View<reco::Candidate> >& tok,
+                        const std::string& presel, double dR) :
+        token(tok), preselection(presel), deltaR2(dR * dR) {;}
+
+      edm::EDGetTokenT<edm::View<reco::Candidate> > token;
+      StringCutObjectSelector<reco::Candidate> preselection;
+      double deltaR2;
+      uwvv::dr::EtaPhiArrays<double> directions; // passing preselection
+    };
+    std::vector<OverlapCollection> overlapCollections;
   };
 
 } // namespace
@@ -72,13 +88,11 @@ uwvv::GenCleaner<ObjType>::GenCleaner(const edm::ParameterSet& iConfig) :
       if (cfg.empty()) 
         continue;
 
-      // We'll only actually use this for delta-R cross cleaning
-      cfg.addParameter("checkRecoComponents", false);
-      cfg.addParameter("pairCut", std::string(""));
-      cfg.addParameter("requireNoOverlaps", true);
-
-      overlapTests.emplace_back(new pat::helper::BasicOverlapTest(name, cfg, 
-                                                                  consumesCollector()));
+      // We only do delta-R cross cleaning, as if checkRecoComponents
+      // were false, pairCut were empty, and requireNoOverlaps were true
+      overlapCollections.emplace_back(consumes<edm::View<reco::Candidate> >(cfg.getParameter<edm::InputTag>("src")),
+                                      cfg.getParameter<std::string>("preselection"),
+                                      cfg.getParameter<double>("deltaR"));
     }
 
   produces<std::vector<ObjType> >();
@@ -95,9 +109,17 @@ uwvv::GenCleaner<ObjType>::produce(edm::Event& iEvent,
 
   std::unique_ptr<std::vector<ObjType> > out = std::make_unique<std::vector<ObjType> >();
 
-  for(auto& overlap : overlapTests)
+  for(auto& overlap : overlapCollections)
     {
-      overlap->readInput(iEvent, iSetup);
+      edm::Handle<edm::View<reco::Candidate> > others;
+      iEvent.getByToken(overlap.token, others);
+
+      overlap.directions.clear();
+      for(const auto& other : *others)
+        {
+          if(overlap.preselection(other))
+            overlap.directions.add(other);
+        }
     }
 
   for(size_t i = 0; i < in->size(); ++i)
@@ -107,10 +129,13 @@ uwvv::GenCleaner<ObjType>::produce(edm::Event& iEvent,
         continue;
 
       bool bad = false;
-      for(auto& test : overlapTests)
+      for(const auto& overlap : overlapCollections)
         {
-          reco::CandidatePtrVector overlaps;
-          bad |= test->fillOverlapsForItem(cand, overlaps);
+          bad = uwvv::dr::anyWithin<double>(cand.eta(), cand.phi(),
+                                            overlap.directions.eta.data(),
+                                            overlap.directions.phi.data(),
+                                            overlap.directions.size(),
+                                            overlap.deltaR2);
           if(bad)
             break;
         }
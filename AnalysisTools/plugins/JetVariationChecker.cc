@@ -0,0 +1,113 @@
+//////////////////////////////////////////////////////////////////////////////
+//                                                                          //
+//    JetVariationChecker.cc                                                //
+//                                                                          //
+//    Sanity check for jets with embedded JetVariations (see               //
+//    PATJetEnergyScaleShifter and PATJetSmearing with                      //
+//    makeVariations=cms.bool(True)). Throws if a jet has no or more than   //
+//    one "jetVariations" entry, or is missing any variation, and at the    //
+//    end of the job if no jet ever had a JES or JER shifted pt different   //
+//    from its nominal pt. Prints how many jets were shifted by each        //
+//    variation.                                                            //
+//                                                                          //
+//////////////////////////////////////////////////////////////////////////////
+
+
+// STL
+#include <iostream>
+#include <algorithm>
+
+// CMSSW
+#include "FWCore/Framework/interface/Frameworkfwd.h"
+#include "FWCore/Framework/interface/one/EDAnalyzer.h"
+#include "FWCore/Framework/interface/Event.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/Utilities/interface/Exception.h"
+
+#include "DataFormats/Common/interface/View.h"
+#include "DataFormats/PatCandidates/interface/Jet.h"
+
+#include "UWVV/DataFormats/interface/JetVariations.h"
+
+
+class JetVariationChecker : public edm::one::EDAnalyzer<>
+{
+ public:
+  explicit JetVariationChecker(const edm::ParameterSet& config);
+  virtual ~JetVariationChecker() {;}
+
+ private:
+  virtual void analyze(edm::Event const& event,
+                       edm::EventSetup const& setup) override;
+  virtual void endJob() override;
+
+  const edm::EDGetTokenT<edm::View<pat::Jet> > srcToken;
+
+  unsigned long nJets;
+  unsigned long nShifted[JetVariations::N_VARIATIONS];
+};
+
+
+JetVariationChecker::JetVariationChecker(const edm::ParameterSet& config) :
+  srcToken(consumes<edm::View<pat::Jet> >(config.getParameter<edm::InputTag>("src"))),
+  nJets(0)
+{
+  std::fill(nShifted, nShifted + JetVariations::N_VARIATIONS, 0);
+}
+
+
+void JetVariationChecker::analyze(edm::Event const& event,
+                                  edm::EventSetup const& setup)
+{
+  edm::Handle<edm::View<pat::Jet> > jets;
+  event.getByToken(srcToken, jets);
+
+  for(const auto& jet : *jets)
+    {
+      const std::vector<std::string>& names = jet.userDataNames();
+      if(std::count(names.begin(), names.end(), "jetVariations") != 1)
+        throw cms::Exception("BadJetVariations")
+          << "Jet in event " << event.id() << " has "
+          << std::count(names.begin(), names.end(), "jetVariations")
+          << " jetVariations entries (should be 1)" << std::endl;
+
+      const JetVariations* variations = jet.userData<JetVariations>("jetVariations");
+
+      ++nJets;
+      for(int v = 0; v < JetVariations::N_VARIATIONS; ++v)
+        {
+          JetVariations::Variation var = JetVariations::Variation(v);
+          if(!variations->has(var))
+            throw cms::Exception("BadJetVariations")
+              << "Jet in event " << event.id() << " is missing variation "
+              << JetVariations::name(var) << std::endl;
+
+          if(variations->pt(jet, var) != jet.pt())
+            ++nShifted[v];
+        }
+    }
+}
+
+
+void JetVariationChecker::endJob()
+{
+  std::cout << "JetVariationChecker: " << nJets << " jets" << std::endl;
+  for(int v = 0; v < JetVariations::N_VARIATIONS; ++v)
+    std::cout << "    " << JetVariations::name(JetVariations::Variation(v))
+              << ": pt shifted in " << nShifted[v] << std::endl;
+
+  if(!nJets)
+    return;
+
+  for(int v = 0; v < JetVariations::N_VARIATIONS; ++v)
+    {
+      if(!nShifted[v])
+        throw cms::Exception("BadJetVariations")
+          << "No jet had its pt changed by variation "
+          << JetVariations::name(JetVariations::Variation(v)) << std::endl;
+    }
+}
+
+
+#include "FWCore/Framework/interface/MakerMacros.h"
+DEFINE_FWK_MODULE(JetVariationChecker);
@@ -3,6 +3,7 @@
 //   PATElectronEAEmbedder.cc                                               //
 //                                                                          //
 //   Embeds electron effective areas using the EGamma POG recommendation.   //
+//   Also available as the "EA" step of a PATElectronEmbedderChain.         //
 //                                                                          //
 //   Authors: Devin Taylor and Nate Woods, U. Wisconsin                     //
 //                                                                          //
@@ -26,70 +27,57 @@
 #include "CommonTools/UtilAlgos/interface/TFileService.h"
 #include "RecoEgamma/EgammaTools/interface/EffectiveAreas.h"
 
+// UWVV
+#include "UWVV/AnalysisTools/interface/EmbeddingStep.h"
+#include "UWVV/AnalysisTools/interface/PATObjectStepEmbedder.h"
 
-class PATElectronEAEmbedder : public edm::stream::EDProducer<>
+
+class ElectronEAEmbeddingStep : public uwvv::EmbeddingStep<pat::Electron>
 {
 public:
-  explicit PATElectronEAEmbedder(const edm::ParameterSet&);
-  virtual ~PATElectronEAEmbedder() {}
+  ElectronEAEmbeddingStep(const edm::ParameterSet& iConfig, edm::ConsumesCollector cc);
+  virtual ~ElectronEAEmbeddingStep() {}
+
+  virtual void embed(pat::Electron& elec, const edm::Ptr<pat::Electron>& original) override;
 
 private:
   // Methods
-  virtual void produce(edm::Event& iEvent, const edm::EventSetup& iSetup);
-  float getEA(const edm::Ptr<pat::Electron>& elec) const;
+  float getEA(const pat::Electron& elec) const;
 
   // Data
-  edm::EDGetTokenT<edm::View<pat::Electron> > electronCollectionToken_;
   const std::string label_; // label for the embedded userfloat
-  const std::string filename_; //filename for effective area
   EffectiveAreas effectiveAreas_;
 };
 
 
 // Constructors and destructors
 
-PATElectronEAEmbedder::PATElectronEAEmbedder(const edm::ParameterSet& iConfig):
-  electronCollectionToken_(consumes<edm::View<pat::Electron> >(iConfig.exists("src") ? 
-                                                               iConfig.getParameter<edm::InputTag>("src") :
-                                                               edm::InputTag("slimmedElectrons"))),
+ElectronEAEmbeddingStep::ElectronEAEmbeddingStep(const edm::ParameterSet& iConfig,
+                                                 edm::ConsumesCollector cc):
+  uwvv::EmbeddingStep<pat::Electron>(iConfig, cc),
   label_(iConfig.exists("label") ?
          iConfig.getParameter<std::string>("label") :
          std::string("EffectiveArea")),
   effectiveAreas_((iConfig.getParameter<edm::FileInPath>("configFile")).fullPath())
 {
-  produces<std::vector<pat::Electron> >();
 }
 
 
-void PATElectronEAEmbedder::produce(edm::Event& iEvent, const edm::EventSetup& iSetup)
+void ElectronEAEmbeddingStep::embed(pat::Electron& elec,
+                                    const edm::Ptr<pat::Electron>& original)
 {
-  std::unique_ptr<std::vector<pat::Electron> > out = 
-    std::unique_ptr<std::vector<pat::Electron> >(new std::vector<pat::Electron>);
-
-  edm::Handle<edm::View<pat::Electron> > electronsIn;
-
-  iEvent.getByToken(electronCollectionToken_, electronsIn);
-
-  for(edm::View<pat::Electron>::const_iterator ei = electronsIn->begin();
-      ei != electronsIn->end(); ei++) // loop over electrons
-    {
-      const edm::Ptr<pat::Electron> eptr(electronsIn, ei - electronsIn->begin());
-
-      out->push_back(*ei); // copy electron to save correctly in event
-
-      float ea;
-      ea = getEA(eptr);
-      
-      out->back().addUserFloat(label_, ea);
-    }
-
-  iEvent.put(std::move(out));
+  elec.addUserFloat(label_, getEA(elec));
 }
 
-float PATElectronEAEmbedder::getEA(const edm::Ptr<pat::Electron>& elec) const
+float ElectronEAEmbeddingStep::getEA(const pat::Electron& elec) const
 {
-  float abseta = fabs(elec->eta());
+  float abseta = fabs(elec.eta());
   return effectiveAreas_.getEffectiveArea(abseta);
 }
 
+
+typedef PATObjectStepEmbedder<ElectronEAEmbeddingStep> PATElectronEAEmbedder;
+
 DEFINE_FWK_MODULE(PATElectronEAEmbedder);
+
+DEFINE_EMBEDDING_STEP(pat::Electron, ElectronEAEmbeddingStep, "EA");
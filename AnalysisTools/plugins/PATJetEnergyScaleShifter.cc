@@ -5,6 +5,10 @@
 //    Copies a jet collection to two new collections with the energy scale  //
 //    shifted up and down by 1sigma.                                        //
 //                                                                          //
+//    If makeVariations=cms.bool(True), instead makes one copy of the       //
+//    collection with the shifts embedded in each jet as JetVariations      //
+//    user data (label "jetVariations").                                    //
+//                                                                          //
 //    Author: Nate Woods, U. Wisconsin                                      //
 //                                                                          //
 //////////////////////////////////////////////////////////////////////////////
@@ -13,6 +17,7 @@
 #include<memory>
 #include<string>
 #include<vector>
+#include<cmath>
 
 #include "FWCore/Framework/interface/Frameworkfwd.h"
 #include "FWCore/Framework/interface/Event.h"
@@ -25,6 +30,7 @@
 #include "CondFormats/JetMETObjects/interface/JetCorrectorParameters.h"
 #include "JetMETCorrections/Objects/interface/JetCorrectionsRecord.h"
 #include "FWCore/Framework/interface/ESHandle.h"
+#include "UWVV/DataFormats/interface/JetVariations.h"
 
 typedef pat::Jet Jet;
 typedef std::vector<Jet> VJet;
@@ -41,14 +47,23 @@ class PATJetEnergyScaleShifter : public edm::stream::EDProducer<>
   virtual void produce(edm::Event& iEvent, const edm::EventSetup& iSetup);
 
   edm::EDGetTokenT<JetView> srcToken;
+
+  const bool makeVariations;
 };
 
 
 PATJetEnergyScaleShifter::PATJetEnergyScaleShifter(const edm::ParameterSet& pset) :
-  srcToken(consumes<JetView>(pset.getParameter<edm::InputTag>("src")))
+  srcToken(consumes<JetView>(pset.getParameter<edm::InputTag>("src"))),
+  makeVariations(pset.exists("makeVariations") ?
+                 pset.getParameter<bool>("makeVariations") : false)
 {
-  produces<VJet>("jesUp");
-  produces<VJet>("jesDown");
+  if(makeVariations)
+    produces<VJet>();
+  else
+    {
+      produces<VJet>("jesUp");
+      produces<VJet>("jesDown");
+    }
 }
 
 
@@ -66,6 +81,39 @@ void PATJetEnergyScaleShifter::produce(edm::Event& iEvent,
   JetCorrectorParameters const & param = (*jecParams)["Uncertainty"];
   JetCorrectionUncertainty jecUnc(param);
 
+  if(makeVariations)
+    {
+      std::unique_ptr<VJet> out(new VJet());
+
+      for(size_t i = 0; i < in->size(); ++i)
+        {
+          const Jet& jet = in->at(i);
+
+          jecUnc.setJetEta(jet.eta());
+          jecUnc.setJetPt(jet.pt());
+          float unc = jecUnc.getUncertainty(true);
+
+          // Shifted jets keep their mass, so the energy scales differently
+          // from the momentum
+          JetVariations variations;
+          for(int sign : {1, -1})
+            {
+              float pScale = 1. + sign * unc;
+              double energy = std::sqrt(jet.p() * jet.p() * pScale * pScale +
+                                        jet.mass() * jet.mass());
+              float eScale = jet.energy() > 0. ? energy / jet.energy() : pScale;
+              variations.set(sign > 0 ? JetVariations::JES_UP : JetVariations::JES_DOWN,
+                             pScale, eScale);
+            }
+
+          out->push_back(jet);
+          out->back().addUserData<JetVariations>("jetVariations", variations);
+        }
+
+      iEvent.put(std::move(out));
+      return;
+    }
+
   std::unique_ptr<VJet> outUp(new VJet());
   std::unique_ptr<VJet> outDn(new VJet());
 
@@ -26,6 +26,8 @@
 #include "DataFormats/Common/interface/View.h"
 #include "CommonTools/Utils/interface/StringCutObjectSelector.h"
 
+#include "UWVV/Utilities/interface/DeltaRKernels.h"
+
 
 typedef reco::Candidate Cand;
 typedef edm::Ptr<Cand> CandPtr;
@@ -74,6 +76,11 @@ private:
 
   // Size of cleaning cone
   const double coneDR;
+
+  // Per-event buffers, kept to avoid reallocating
+  uwvv::dr::EtaPhiArrays<double> jetDirections;
+  uwvv::dr::EtaPhiArrays<double> fsrDirections;
+  std::vector<char> rejected;
 };
 
 
@@ -119,18 +126,21 @@ void PATJetFSRCleaner::produce(edm::Event& iEvent, const edm::EventSetup& iSetup
   std::auto_ptr<std::vector<Jet> > out = 
     std::auto_ptr<std::vector<Jet> >(new std::vector<Jet>);
 
+  fsrDirections.clear();
+  for(const auto& pho : fsr)
+    fsrDirections.add(pho->p4());
+
+  jetDirections.clear();
+  for(size_t iJ = 0; iJ < jetsIn->size(); ++iJ)
+    jetDirections.add(jetsIn->at(iJ).p4());
+
+  uwvv::dr::markWithinAny(jetDirections, fsrDirections, coneDR * coneDR,
+                          rejected);
+
   for(size_t iJ = 0; iJ < jetsIn->size(); ++iJ)
     {
-      JetPtr jet = jetsIn->ptrAt(iJ);
-
-      bool rejected = false;
-      for(size_t iFSR = 0; iFSR < fsr.size(); ++iFSR)
-        {
-          rejected = reco::deltaR(fsr.at(iFSR)->p4(), jet->p4()) < coneDR;
-          if(rejected) break;
-        }
-      if(!rejected)
-        out->push_back(*jet);
+      if(!rejected[iJ])
+        out->push_back(jetsIn->at(iJ));
     }
 
   iEvent.put(out);
@@ -13,6 +13,18 @@
 //    sigma, and another with the smearing shifted down by one sigma, for   //
 //    systematics. Labels for these are "jerUp" and "jerDown".              //
 //                                                                          //
+//    If makeVariations=cms.bool(True), no extra collections are made.      //
+//    Instead, the JER shifts are embedded in each jet as JetVariations     //
+//    user data (label "jetVariations"). JES shifts already embedded in     //
+//    the input jets (see PATJetEnergyScaleShifter) are smeared too and     //
+//    stored relative to the smeared jet, so all four variations end up     //
+//    in the output. The highest pt of the jet in any variation is stored   //
+//    as the userFloat "jetVariationMaxPt", for selections.                 //
+//                                                                          //
+//    Jets without a matching gen jet are smeared randomly, with random     //
+//    numbers determined by the event and the jet direction, so the         //
+//    results are reproducible.                                             //
+//                                                                          //
 //    Obviously, this only makes sense for MC                               //
 //                                                                          //
 //    Author: Nate Woods, U. Wisconsin                                      //
@@ -23,8 +35,9 @@
 #include<memory>
 #include<string>
 #include<vector>
-#include<cmath> // std::sqrt, std::abs, std::sin
+#include<cmath> // std::sqrt, std::abs
 #include<algorithm> // std::max
+#include<cstring> // std::memcpy
 
 #include "FWCore/Framework/interface/Frameworkfwd.h"
 #include "FWCore/Framework/interface/Event.h"
@@ -36,7 +49,8 @@
 #include "CondFormats/JetMETObjects/interface/JetResolutionObject.h"
 #include "DataFormats/Math/interface/LorentzVector.h"
 
-#include "TRandom3.h"
+#include "UWVV/Utilities/interface/Philox.h"
+#include "UWVV/DataFormats/interface/JetVariations.h"
 
 
 typedef pat::Jet Jet;
@@ -52,10 +66,28 @@ class PATJetSmearing : public edm::stream::EDProducer<>
  private:
   virtual void produce(edm::Event& iEvent, const edm::EventSetup& iSetup);
 
+  // Counter for the random number used to smear this jet. Keyed to the
+  // jet's direction, so it doesn't depend on the order of the collection
+  static uwvv::Philox4x32::Counter randomCounter(const Jet& jet,
+                                                 const edm::EventID& id);
+
+  // pt of the matched gen jet if the jet (with this pt and resolution) has
+  // one, negative otherwise
+  static float matchedGenPt(const Jet& jet, float pt, float relPtErr);
+
+  // Smeared pt, with scale factor sf, for a jet with this pt
+  static double smearedPt(float pt, float relPtErr, float sf, float genPt,
+                          float smear);
+
   edm::EDGetTokenT<JetView> srcToken;
   edm::EDGetTokenT<double> rhoToken;
 
   const bool systematics;
+  const bool makeVariations;
+
+  // Per-event buffers, kept to avoid reallocating
+  std::vector<uwvv::Philox4x32::Counter> counters;
+  std::vector<double> smears;
 };
 
 
@@ -63,10 +95,12 @@ PATJetSmearing::PATJetSmearing(const edm::ParameterSet& pset) :
   srcToken(consumes<JetView>(pset.getParameter<edm::InputTag>("src"))),
   rhoToken(consumes<double>(pset.getParameter<edm::InputTag>("rhoSrc"))),
   systematics(pset.exists("systematics") ?
-              pset.getParameter<bool>("systematics") : false)
+              pset.getParameter<bool>("systematics") : false),
+  makeVariations(pset.exists("makeVariations") ?
+                 pset.getParameter<bool>("makeVariations") : false)
 {
   produces<VJet>();
-  if(systematics)
+  if(systematics && !makeVariations)
     {
       produces<VJet>("jerUp");
       produces<VJet>("jerDown");
@@ -90,13 +124,27 @@ void PATJetSmearing::produce(edm::Event& iEvent,
     JME::JetResolutionScaleFactor::get(iSetup, "AK4PFchs");
   JME::JetResolution resPt = JME::JetResolution::get(iSetup, "AK4PFchs_pt");
 
-  for(size_t i = 0; i < in->size(); ++i)
+  const size_t nJets = in->size();
+
+  // Random numbers for all jets at once (unused for matched jets)
+  counters.resize(nJets);
+  for(size_t i = 0; i < nJets; ++i)
+    counters[i] = randomCounter(in->at(i), iEvent.id());
+
+  const edm::EventNumber_t evtNum = iEvent.id().event();
+  const uwvv::Philox4x32::Key key = {{uint32_t(evtNum), uint32_t(evtNum >> 32)}};
+  smears.resize(nJets);
+  uwvv::Philox4x32::gaussians(nJets, counters.data(), key, smears.data());
+
+  const bool doShifts = systematics || makeVariations;
+
+  for(size_t i = 0; i < nJets; ++i)
     {
       const Jet& jet = in->at(i);
 
       float pt = jet.pt();
       float eta = jet.eta();
-      float phi = jet.phi();
+      float smear = smears[i];
 
       JME::JetParameters params;
       params.setJetPt(pt).setJetEta(eta).setRho(*rho);
@@ -107,32 +155,14 @@ void PATJetSmearing::produce(edm::Event& iEvent,
       paramsSF.setJetEta(eta).setRho(*rho);
 
       float sf = resSF.getScaleFactor(paramsSF);
-      float sfUp = systematics ? resSF.getScaleFactor(paramsSF, Variation::UP) : 0.;
-      float sfDn = systematics ? resSF.getScaleFactor(paramsSF, Variation::DOWN) : 0.;
+      float sfUp = doShifts ? resSF.getScaleFactor(paramsSF, Variation::UP) : 0.;
+      float sfDn = doShifts ? resSF.getScaleFactor(paramsSF, Variation::DOWN) : 0.;
 
-      double ptJER, ptJERUp, ptJERDn;
-      const reco::GenJet* gen = jet.genJet();
-      if(gen && reco::deltaR(eta, phi, gen->eta(), gen->phi()) < 0.2 &&
-         (std::abs(pt - gen->pt()) < 3. * relPtErr * pt))
-        {
-          float genPt = gen->pt();
+      float genPt = matchedGenPt(jet, pt, relPtErr);
 
-          ptJER = std::max(float(0.), genPt + sf * (pt - genPt));
-          ptJERUp = std::max(float(0.), genPt + sfUp * (pt - genPt));
-          ptJERDn = std::max(float(0.), genPt + sfDn * (pt - genPt));
-        }
-      else
-        {
-          TRandom3 rand;
-          rand.SetSeed(std::abs(static_cast<int>(std::sin(phi)*100000)));
-          float smear = rand.Gaus(0.,1.);
-          float sig = std::sqrt(sf * sf - 1.) * relPtErr * pt;
-          float sigUp = std::sqrt(sfUp * sfUp - 1.) * relPtErr * pt;
-          float sigDn = std::sqrt(sfDn * sfDn - 1.) * relPtErr * pt;
-          ptJER = std::max(float(0.), smear * sig + pt);
-          ptJERUp = std::max(float(0.), smear * sigUp + pt);
-          ptJERDn = std::max(float(0.), smear * sigDn + pt);
-        }
+      double ptJER = smearedPt(pt, relPtErr, sf, genPt, smear);
+      double ptJERUp = smearedPt(pt, relPtErr, sfUp, genPt, smear);
+      double ptJERDn = smearedPt(pt, relPtErr, sfDn, genPt, smear);
 
       float jerCorr = ptJER / pt;
       float jerCorrUp = ptJERUp / pt;
@@ -146,7 +176,53 @@ void PATJetSmearing::produce(edm::Event& iEvent,
       out->back().setP4(p4JER);
       out->back().addUserFloat("jerCorrInverse", 1./jerCorr);
 
-      if(systematics)
+      if(makeVariations)
+        {
+          // Everything relative to the nominal smeared jet. A jet smeared
+          // all the way to 0 can't be scaled back up, so its variations
+          // are 0 too
+          const float norm = jerCorr > 0. ? 1. / jerCorr : 0.;
+
+          JetVariations variations;
+          variations.set(JetVariations::JER_UP, jerCorrUp * norm, jerCorrUp * norm);
+          variations.set(JetVariations::JER_DOWN, jerCorrDn * norm, jerCorrDn * norm);
+
+          // JES-shifted jets are smeared with the nominal scale factor, as
+          // if the shifted collection had been smeared on its own
+          if(jet.hasUserData("jetVariations"))
+            {
+              const JetVariations* jes = jet.userData<JetVariations>("jetVariations");
+              for(auto v : {JetVariations::JES_UP, JetVariations::JES_DOWN})
+                {
+                  if(!jes->has(v))
+                    continue;
+
+                  float ptShifted = jes->pt(jet, v);
+
+                  JME::JetParameters paramsShifted;
+                  paramsShifted.setJetPt(ptShifted).setJetEta(eta).setRho(*rho);
+                  float relPtErrShifted = resPt.getResolution(paramsShifted);
+
+                  float genPtShifted = matchedGenPt(jet, ptShifted, relPtErrShifted);
+                  float jerCorrShifted = ptShifted > 0. ?
+                    smearedPt(ptShifted, relPtErrShifted, sf, genPtShifted, smear) / ptShifted :
+                    0.;
+
+                  variations.set(v, jerCorrShifted * jes->momentumScale(v) * norm,
+                                 jerCorrShifted * jes->energyScale(v) * norm);
+                }
+            }
+
+          float maxPt = p4JER.pt();
+          for(int v = 0; v < JetVariations::N_VARIATIONS; ++v)
+            maxPt = std::max(maxPt, variations.pt(out->back(), JetVariations::Variation(v)));
+
+          // replace the JES-only variations copied from the input jet
+          out->back().addUserData<JetVariations>("jetVariations", variations,
+                                                 false, true);
+          out->back().addUserFloat("jetVariationMaxPt", maxPt);
+        }
+      else if(systematics)
         {
           outUp->push_back(jet);
           outUp->back().setP4(p4JERUp);
@@ -159,7 +235,7 @@ void PATJetSmearing::produce(edm::Event& iEvent,
     }
 
   iEvent.put(std::move(out));
-  if(systematics)
+  if(systematics && !makeVariations)
     {
       iEvent.put(std::move(outUp), "jerUp");
       iEvent.put(std::move(outDn), "jerDown");
@@ -167,5 +243,43 @@ void PATJetSmearing::produce(edm::Event& iEvent,
 }
 
 
+float PATJetSmearing::matchedGenPt(const Jet& jet, float pt, float relPtErr)
+{
+  const reco::GenJet* gen = jet.genJet();
+  if(gen && reco::deltaR(jet.eta(), jet.phi(), gen->eta(), gen->phi()) < 0.2 &&
+     (std::abs(pt - gen->pt()) < 3. * relPtErr * pt))
+    return gen->pt();
+
+  return -1.;
+}
+
+
+double PATJetSmearing::smearedPt(float pt, float relPtErr, float sf,
+                                 float genPt, float smear)
+{
+  if(genPt >= 0.)
+    return std::max(float(0.), genPt + sf * (pt - genPt));
+
+  float sig = std::sqrt(sf * sf - 1.) * relPtErr * pt;
+  return std::max(float(0.), smear * sig + pt);
+}
+
+
+uwvv::Philox4x32::Counter PATJetSmearing::randomCounter(const Jet& jet,
+                                                        const edm::EventID& id)
+{
+  float eta = jet.eta();
+  float phi = jet.phi();
+
+  uwvv::Philox4x32::Counter out;
+  std::memcpy(&out[0], &phi, sizeof(uint32_t));
+  std::memcpy(&out[1], &eta, sizeof(uint32_t));
+  out[2] = id.luminosityBlock();
+  out[3] = id.run();
+
+  return out;
+}
+
+
 #include "FWCore/Framework/interface/MakerMacros.h"
 DEFINE_FWK_MODULE(PATJetSmearing);
@@ -31,6 +31,8 @@
 #include "CommonTools/Utils/interface/StringCutObjectSelector.h"
 #include "DataFormats/MuonReco/interface/MuonPFIsolation.h"
 
+#include "UWVV/Utilities/interface/DeltaRKernels.h"
+
 
 typedef reco::Candidate Cand;
 typedef edm::Ptr<Cand> CandPtr;
@@ -56,22 +58,22 @@ private:
   // Make collection to output. Heap allocation done here.
   template<typename Lep>
   std::auto_ptr<std::vector<Lep> >
-  makeCollection(const edm::Handle<edm::View<Lep> >& lepsIn,
-                 const std::vector<CandPtr>& fsrs) const;
+  makeCollection(const edm::Handle<edm::View<Lep> >& lepsIn) const;
 
   // Actual isolation calculation
   template<typename Lep>
-  float relPFIsoFSR(const edm::Ptr<Lep>& lep,
-                    const std::vector<CandPtr>& fsrs) const;
+  float relPFIsoFSR(const edm::Ptr<Lep>& lep) const;
   float isoPUCorrection(const ElecPtr& e) const;
   float isoPUCorrection(const MuonPtr& m) const;
+  // Sum of pt of this event's FSR photons in lep's isolation cone
   template<typename Lep>
-  float isoFSRCorrection(const edm::Ptr<Lep>& lep,
-                         const std::vector<CandPtr>& fsr) const;
-  bool fsrInIsoCone(const ElecPtr& e,
-                    const CandPtr& fsr) const;
-  bool fsrInIsoCone(const MuonPtr& m,
-                    const CandPtr& fsr) const;
+  float isoFSRCorrection(const edm::Ptr<Lep>& lep) const;
+  // Squared size of the isolation cone and of the veto cone inside it for
+  // FSR photons (negative for no veto)
+  double fsrConeDR2(const ElecPtr& e) const {return isoConeDRMaxE * isoConeDRMaxE;}
+  double fsrConeDR2(const MuonPtr& m) const {return isoConeDRMaxM * isoConeDRMaxM;}
+  double fsrVetoDR2(const ElecPtr& e) const;
+  double fsrVetoDR2(const MuonPtr& m) const {return isoConeDRMinM * isoConeDRMinM;}
   
   // Isolation variables for e and mu (why isn't this standard???)
   const reco::GsfElectron::PflowIsolationVariables& 
@@ -129,6 +131,10 @@ private:
 
   // Label of FSR userCand
   const std::string fsrLabel;
+
+  // This event's FSR photons, refilled each event
+  uwvv::dr::EtaPhiArrays<double> fsrDirections;
+  std::vector<double> fsrPts;
 };
 
 
@@ -193,8 +199,16 @@ void PATLeptonZZIsoEmbedder::produce(edm::Event& iEvent, const edm::EventSetup&
 
   std::vector<CandPtr> fsr = getFSR(elecsIn, muonsIn);
 
-  outE = makeCollection(elecsIn, fsr);
-  outM = makeCollection(muonsIn, fsr);
+  fsrDirections.clear();
+  fsrPts.clear();
+  for(const auto& pho : fsr)
+    {
+      fsrDirections.add(pho->p4());
+      fsrPts.push_back(pho->pt());
+    }
+
+  outE = makeCollection(elecsIn);
+  outM = makeCollection(muonsIn);
 
   iEvent.put(outE, "electrons");
   iEvent.put(outM, "muons");
@@ -203,8 +217,7 @@ void PATLeptonZZIsoEmbedder::produce(edm::Event& iEvent, const edm::EventSetup&
 
 template<typename Lep>
 std::auto_ptr<std::vector<Lep> >
-PATLeptonZZIsoEmbedder::makeCollection(const edm::Handle<edm::View<Lep> >& lepsIn,
-                                       const std::vector<CandPtr>& fsrs) const
+PATLeptonZZIsoEmbedder::makeCollection(const edm::Handle<edm::View<Lep> >& lepsIn) const
 {
   std::auto_ptr<std::vector<Lep> > out = 
     std::auto_ptr<std::vector<Lep> >(new std::vector<Lep>);
@@ -221,7 +234,7 @@ PATLeptonZZIsoEmbedder::makeCollection(const edm::Handle<edm::View<Lep> >& lepsI
       bool decision  = false;
       if(out->back().pt() > 0.)
         {
-          iso = relPFIsoFSR(lep, fsrs);
+          iso = relPFIsoFSR(lep);
           decision = (iso < getIsoCut(lep));
         }
       out->back().addUserFloat(isoValueLabel, iso);
@@ -235,15 +248,14 @@ PATLeptonZZIsoEmbedder::makeCollection(const edm::Handle<edm::View<Lep> >& lepsI
 
 template<typename Lep>
 float 
-PATLeptonZZIsoEmbedder::relPFIsoFSR(const edm::Ptr<Lep>& lep,
-                                    const std::vector<CandPtr>& fsrs) const
+PATLeptonZZIsoEmbedder::relPFIsoFSR(const edm::Ptr<Lep>& lep) const
 {
   float chHadIso = isolationVariables(lep).sumChargedHadronPt;
   float nHadIso = isolationVariables(lep).sumNeutralHadronEt;
   float phoIso = isolationVariables(lep).sumPhotonEt;
   float puCorrection = isoPUCorrection(lep);
 
-  float fsrCorrection = isoFSRCorrection(lep, fsrs);
+  float fsrCorrection = isoFSRCorrection(lep);
   
   float neutralIso = nHadIso + phoIso - puCorrection - fsrCorrection;
   if(neutralIso < 0.)
@@ -285,43 +297,25 @@ PATLeptonZZIsoEmbedder::isolationVariables(const MuonPtr& m) const
 
 template<typename Lep>
 float
-PATLeptonZZIsoEmbedder::isoFSRCorrection(const edm::Ptr<Lep>& lep,
-                                             const std::vector<CandPtr>& fsrs) const
-{
-  float corr = 0.;
-
-  for(auto iFSR = fsrs.begin(); iFSR != fsrs.end(); iFSR++)
-    {
-      if(fsrInIsoCone(lep, *iFSR))
-         corr += (*iFSR)->pt();
-    }
-
-  return corr;
-}
-
-
-bool
-PATLeptonZZIsoEmbedder::fsrInIsoCone(const ElecPtr& e,
-                                     const CandPtr& fsr) const
+PATLeptonZZIsoEmbedder::isoFSRCorrection(const edm::Ptr<Lep>& lep) const
 {
-  // float fsrDR = reco::deltaR(*fsr, *(e->superCluster()));
-  float fsrDR = reco::deltaR(fsr->p4(), e->p4());
+  const auto p4 = lep->p4();
 
-  bool inCone = (fsrDR < isoConeDRMaxE && 
-                 (e->superCluster()->eta() < isoConeVetoEtaThresholdE ||
-                  fsrDR > isoConeDRMinE));
-
-  return inCone;
+  return uwvv::dr::coneSum<double, float>(p4.eta(), p4.phi(),
+                                          fsrDirections.eta.data(),
+                                          fsrDirections.phi.data(),
+                                          fsrPts.data(), fsrPts.size(),
+                                          fsrConeDR2(lep), fsrVetoDR2(lep));
 }
 
 
-bool
-PATLeptonZZIsoEmbedder::fsrInIsoCone(const MuonPtr& m,
-                                     const CandPtr& fsr) const
+double
+PATLeptonZZIsoEmbedder::fsrVetoDR2(const ElecPtr& e) const
 {
-  float fsrDR = reco::deltaR(fsr->p4(), m->p4());
+  if(e->superCluster()->eta() < isoConeVetoEtaThresholdE)
+    return -1.;
 
-  return (fsrDR < isoConeDRMaxM && fsrDR > isoConeDRMinM);
+  return isoConeDRMinE * isoConeDRMinE;
 }
 
 
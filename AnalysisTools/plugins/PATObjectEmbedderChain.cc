@@ -0,0 +1,109 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+//    PATObjectEmbedderChain                                                 //
+//                                                                           //
+//    Runs an ordered list of embedding steps on one copy of a collection    //
+//    of PAT objects, instead of one embedder module (and one copy of the    //
+//    collection) per step. Each PSet in "steps" configures one step, with   //
+//    the step name (e.g. "Expression" or "ScaleFactor") in "type" and the   //
+//    same parameters as the standalone embedder module, minus src.          //
+//                                                                           //
+//    Nate Woods, U. Wisconsin                                               //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+
+// system includes
+#include <memory>
+#include <vector>
+#include <string>
+
+// CMS includes
+#include "FWCore/Framework/interface/Frameworkfwd.h"
+#include "FWCore/Framework/interface/stream/EDProducer.h"
+#include "FWCore/Framework/interface/Event.h"
+#include "FWCore/Framework/interface/MakerMacros.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "DataFormats/PatCandidates/interface/Electron.h"
+#include "DataFormats/PatCandidates/interface/Muon.h"
+#include "DataFormats/PatCandidates/interface/Tau.h"
+#include "DataFormats/PatCandidates/interface/Jet.h"
+#include "DataFormats/PatCandidates/interface/CompositeCandidate.h"
+#include "DataFormats/Common/interface/View.h"
+
+// UWVV
+#include "UWVV/AnalysisTools/interface/EmbeddingStep.h"
+
+
+template<class T>
+class PATObjectEmbedderChain : public edm::stream::EDProducer<>
+{
+
+public:
+  explicit PATObjectEmbedderChain(const edm::ParameterSet& iConfig);
+  virtual ~PATObjectEmbedderChain() {};
+
+private:
+  virtual void produce(edm::Event& iEvent, const edm::EventSetup& iSetup);
+
+  const edm::EDGetTokenT<edm::View<T> > srcToken_;
+  std::vector<std::unique_ptr<uwvv::EmbeddingStep<T> > > steps_;
+};
+
+
+template<class T>
+PATObjectEmbedderChain<T>::PATObjectEmbedderChain(const edm::ParameterSet& iConfig) :
+  srcToken_(consumes<edm::View<T> >(iConfig.getParameter<edm::InputTag>("src")))
+{
+  for(const auto& stepParams : iConfig.getParameter<std::vector<edm::ParameterSet> >("steps"))
+    {
+      const std::string type = stepParams.getParameter<std::string>("type");
+
+      steps_.emplace_back(uwvv::EmbeddingStepFactory<T>::get()->create(type, stepParams,
+                                                                        consumesCollector()));
+      if(!steps_.back())
+        throw cms::Exception("InvalidParams")
+          << "Could not make embedding step of type " << type << std::endl;
+    }
+
+  produces<std::vector<T> >();
+}
+
+
+template<class T>
+void PATObjectEmbedderChain<T>::produce(edm::Event& iEvent,
+                                        const edm::EventSetup& iSetup)
+{
+  edm::Handle<edm::View<T> > in;
+  iEvent.getByToken(srcToken_, in);
+
+  for(auto& step : steps_)
+    step->setEvent(iEvent);
+
+  std::unique_ptr<std::vector<T> > out(new std::vector<T>);
+  out->reserve(in->size());
+
+  for(size_t i = 0; i < in->size(); ++i)
+    out->push_back(in->at(i));
+
+  // Steps only look at the object they're embedding in, so doing each step
+  // for the whole collection gives the same result as doing each object
+  // completely in turn
+  for(auto& step : steps_)
+    step->embedAll(*out, *in);
+
+  iEvent.put(std::move(out));
+}
+
+
+typedef PATObjectEmbedderChain<pat::Electron> PATElectronEmbedderChain;
+typedef PATObjectEmbedderChain<pat::Muon> PATMuonEmbedderChain;
+typedef PATObjectEmbedderChain<pat::Tau> PATTauEmbedderChain;
+typedef PATObjectEmbedderChain<pat::Jet> PATJetEmbedderChain;
+typedef PATObjectEmbedderChain<pat::CompositeCandidate> PATCompositeCandidateEmbedderChain;
+
+DEFINE_FWK_MODULE(PATElectronEmbedderChain);
+DEFINE_FWK_MODULE(PATMuonEmbedderChain);
+DEFINE_FWK_MODULE(PATTauEmbedderChain);
+DEFINE_FWK_MODULE(PATJetEmbedderChain);
+DEFINE_FWK_MODULE(PATCompositeCandidateEmbedderChain);
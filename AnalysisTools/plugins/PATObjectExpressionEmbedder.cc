@@ -4,6 +4,7 @@
 //                                                                           //
 //    Takes a string function and a collection of PAT objects and embeds     //
 //    the results of the function in the objects as userFloats.              //
+//    Also available as the "Expression" step of a PATObjectEmbedderChain.   //
 //                                                                           //
 //    Nate Woods, U. Wisconsin                                               //
 //                                                                           //
@@ -31,76 +32,73 @@
 #include "DataFormats/Common/interface/View.h"
 #include "FWCore/Utilities/interface/transform.h"
 
+// UWVV
+#include "UWVV/AnalysisTools/interface/EmbeddingStep.h"
+#include "UWVV/AnalysisTools/interface/PATObjectStepEmbedder.h"
+
 
 template<class T>
-class PATObjectExpressionEmbedder : public edm::stream::EDProducer<>
+class ExpressionEmbeddingStep : public uwvv::EmbeddingStep<T>
 {
 
 public:
-  explicit PATObjectExpressionEmbedder(const edm::ParameterSet& iConfig);
-  virtual ~PATObjectExpressionEmbedder() {};
+  ExpressionEmbeddingStep(const edm::ParameterSet& iConfig, edm::ConsumesCollector cc);
+  virtual ~ExpressionEmbeddingStep() {};
+
+  virtual void embed(T& obj, const edm::Ptr<T>& original) override;
 
 private:
-  virtual void produce(edm::Event& iEvent, const edm::EventSetup& iSetup);
   void embedValue(T& object, float value, const std::string& label) const;
 
-  const edm::EDGetTokenT<edm::View<T> > srcToken_;
   const std::vector<std::string> labels_;
   const std::vector<StringObjectFunction<T,true> > functions_;
 };
 
 
 template<class T>
-PATObjectExpressionEmbedder<T>::PATObjectExpressionEmbedder(const edm::ParameterSet& iConfig) :
-  srcToken_(consumes<edm::View<T> >(iConfig.getParameter<edm::InputTag>("src"))),
+ExpressionEmbeddingStep<T>::ExpressionEmbeddingStep(const edm::ParameterSet& iConfig,
+                                                    edm::ConsumesCollector cc) :
+  uwvv::EmbeddingStep<T>(iConfig, cc),
   labels_(iConfig.getUntrackedParameter<std::vector<std::string> >("labels")),
   functions_(edm::vector_transform(iConfig.getUntrackedParameter<std::vector<std::string> >("functions"),
-                                   [this](const std::string& expr){return StringObjectFunction<T,true>(expr);}))
+                                   [](const std::string& expr){return StringObjectFunction<T,true>(expr);}))
 {
   if(labels_.size() != functions_.size())
     throw cms::Exception("InvalidParams")
       << "Must have exactly one label for each expression.";
-
-  produces<std::vector<T> >();
 }
 
 
 template<class T>
-void PATObjectExpressionEmbedder<T>::produce(edm::Event& iEvent,
-                                             const edm::EventSetup& iSetup)
+void ExpressionEmbeddingStep<T>::embed(T& obj, const edm::Ptr<T>& original)
 {
-  std::unique_ptr<std::vector<T> > out = std::make_unique<std::vector<T> >();
-  edm::Handle<edm::View<T> > in;
-  iEvent.getByToken(srcToken_, in);
-
-  for(size_t i = 0; i < in->size(); ++i)
-    {
-      out->push_back(in->at(i));
-
-      for(size_t j = 0; j < labels_.size(); ++j)
-        embedValue(out->back(), functions_.at(j)(out->back()), labels_.at(j));
-    }
-
-  iEvent.put(std::move(out));
+  for(size_t j = 0; j < labels_.size(); ++j)
+    embedValue(obj, functions_.at(j)(obj), labels_.at(j));
 }
 
 template<class T>
-void PATObjectExpressionEmbedder<T>::embedValue(T& object,
-                                                float value,
-                                                const std::string& label) const
+void ExpressionEmbeddingStep<T>::embedValue(T& object,
+                                            float value,
+                                            const std::string& label) const
 {
   object.addUserFloat(label, value);
 }
 
 
-typedef PATObjectExpressionEmbedder<pat::Electron> PATElectronExpressionEmbedder;
-typedef PATObjectExpressionEmbedder<pat::Muon> PATMuonExpressionEmbedder;
-typedef PATObjectExpressionEmbedder<pat::Tau> PATTauExpressionEmbedder;
-typedef PATObjectExpressionEmbedder<pat::Jet> PATJetExpressionEmbedder;
-typedef PATObjectExpressionEmbedder<pat::CompositeCandidate> PATCompositeCandidateExpressionEmbedder;
+typedef PATObjectStepEmbedder<ExpressionEmbeddingStep<pat::Electron> > PATElectronExpressionEmbedder;
+typedef PATObjectStepEmbedder<ExpressionEmbeddingStep<pat::Muon> > PATMuonExpressionEmbedder;
+typedef PATObjectStepEmbedder<ExpressionEmbeddingStep<pat::Tau> > PATTauExpressionEmbedder;
+typedef PATObjectStepEmbedder<ExpressionEmbeddingStep<pat::Jet> > PATJetExpressionEmbedder;
+typedef PATObjectStepEmbedder<ExpressionEmbeddingStep<pat::CompositeCandidate> > PATCompositeCandidateExpressionEmbedder;
 
 DEFINE_FWK_MODULE(PATElectronExpressionEmbedder);
 DEFINE_FWK_MODULE(PATMuonExpressionEmbedder);
 DEFINE_FWK_MODULE(PATTauExpressionEmbedder);
 DEFINE_FWK_MODULE(PATJetExpressionEmbedder);
 DEFINE_FWK_MODULE(PATCompositeCandidateExpressionEmbedder);
+
+DEFINE_EMBEDDING_STEP(pat::Electron, ExpressionEmbeddingStep<pat::Electron>, "Expression");
+DEFINE_EMBEDDING_STEP(pat::Muon, ExpressionEmbeddingStep<pat::Muon>, "Expression");
+DEFINE_EMBEDDING_STEP(pat::Tau, ExpressionEmbeddingStep<pat::Tau>, "Expression");
+DEFINE_EMBEDDING_STEP(pat::Jet, ExpressionEmbeddingStep<pat::Jet>, "Expression");
+DEFINE_EMBEDDING_STEP(pat::CompositeCandidate, ExpressionEmbeddingStep<pat::CompositeCandidate>, "Expression");
@@ -20,8 +20,11 @@
 #include <memory>
 #include <iostream>
 #include <cmath> // pow, abs
-#include <list>
-#include <functional>
+#include <vector>
+#include <array>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm> // sort, lower_bound, upper_bound
 #include <utility> // pair
 
 // user include files
@@ -38,6 +41,9 @@
 #include "CommonTools/Utils/interface/StringCutObjectSelector.h"
 #include "DataFormats/Common/interface/RefToPtr.h"
 
+#include "UWVV/Utilities/interface/EtaPhiGrid.h"
+#include "UWVV/Utilities/interface/DeltaRKernels.h"
+
 
 typedef reco::Candidate Cand;
 typedef edm::Ptr<Cand> CandPtr;
@@ -52,6 +58,75 @@ typedef pat::Muon Muon;
 typedef edm::Ptr<pat::Muon> MuonPtr;
 typedef edm::View<pat::Muon> MuonView;
 
+namespace
+{
+  // Isolation candidates sorted by eta, with their eta, phi, and pt in
+  // separate arrays, so a cone sum only looks at the slice of candidates
+  // within the cone's eta range
+  class EtaSortedCands
+  {
+   public:
+    void add(float eta, float phi, float pt) {unsorted_.push_back({{eta, phi, pt}});}
+
+    // call after all candidates are added
+    void sort();
+
+    // Scalar pt sum of candidates with vetoDR < deltaR < maxDR
+    double coneSum(float eta, float phi, float maxDR, float vetoDR) const;
+
+   private:
+    std::vector<float> eta_;
+    std::vector<float> phi_;
+    std::vector<float> pt_;
+
+    std::vector<std::array<float,3> > unsorted_;
+  };
+
+
+  void EtaSortedCands::sort()
+  {
+    std::sort(unsorted_.begin(), unsorted_.end(),
+              [](const std::array<float,3>& a, const std::array<float,3>& b)
+              {return a[0] < b[0];});
+
+    eta_.resize(unsorted_.size());
+    phi_.resize(unsorted_.size());
+    pt_.resize(unsorted_.size());
+    for(size_t i = 0; i < unsorted_.size(); ++i)
+      {
+        eta_[i] = unsorted_[i][0];
+        phi_[i] = unsorted_[i][1];
+        pt_[i] = unsorted_[i][2];
+      }
+  }
+
+
+  double EtaSortedCands::coneSum(float eta, float phi, float maxDR, float vetoDR) const
+  {
+    const size_t first = std::lower_bound(eta_.begin(), eta_.end(), eta - maxDR) - eta_.begin();
+    const size_t last = std::upper_bound(eta_.begin() + first, eta_.end(), eta + maxDR) - eta_.begin();
+
+    return uwvv::dr::coneSum(eta, phi, eta_.data() + first, phi_.data() + first,
+                             pt_.data() + first, last - first,
+                             maxDR * maxDR, vetoDR * vetoDR);
+  }
+
+
+  // Everything passIso() needs for one event. The isolation candidates are
+  // found the first time they're needed, and each photon's result is kept
+  // in case the photon is checked again for another lepton.
+  struct IsoInfo
+  {
+    IsoInfo() : filled(false) {;}
+
+    bool filled;
+    EtaSortedCands nIsoCands;
+    EtaSortedCands chIsoCands;
+    std::unordered_map<size_t, bool> results; // keyed to photon key
+  };
+}
+
+
 class PATObjectFSREmbedder : public edm::stream::EDProducer<>
 {
 public:
@@ -61,15 +136,18 @@ public:
 private:
   virtual void produce(edm::Event&, const edm::EventSetup&);
   
-  // check if pho is in PF supercluster of any passing electron
+  // Unique key for a packed candidate (product and index)
+  static unsigned long long footprintKey(const PCandRef& cand);
+
+  // check if pho is in PF supercluster of any passing electron, given the
+  // keys of all the passing electrons' associated packed candidates
   bool candInSuperCluster(const PCandRef& pho, 
-                          const edm::Handle<edm::View<Elec> >& elecs) const;
+                          const std::unordered_set<unsigned long long>& footprint) const;
   
-  // Compute relative isolation for pho from the cands in nIsoCands and chIsoCands
-  // If those vectors are empty, they are filled from allCands
+  // Compute relative isolation for pho from the cands in isoInfo
+  // If they haven't been found yet, they are filled from allCands
   bool passIso(const PCandRef& pho,
-               std::vector<PCandRef>& nIsoCands,
-               std::vector<PCandRef>& chIsoCands,
+               IsoInfo& isoInfo,
                const edm::Handle<edm::View<PCand> >& allCands) const;
 
   edm::EDGetTokenT<PCandView> cands_;
@@ -96,6 +174,10 @@ private:
   const float relIsoCut_;
 
   const float eMuCrossCleaningDR_;
+
+  // selected leptons, refilled each event
+  uwvv::EtaPhiGrid eGrid_;
+  uwvv::EtaPhiGrid mGrid_;
 };
 
 
@@ -150,7 +232,9 @@ PATObjectFSREmbedder::PATObjectFSREmbedder(const edm::ParameterSet& iConfig):
              1.8),
   eMuCrossCleaningDR_(iConfig.exists("eMuCrossCleaningDR") ?
                       float(iConfig.getParameter<double>("eMuCrossCleaningDR")) :
-                      0.)
+                      0.),
+  eGrid_(maxDR_),
+  mGrid_(maxDR_)
 {
   produces<std::vector<Muon> >();
   produces<std::vector<Elec> >();
@@ -176,134 +260,118 @@ void PATObjectFSREmbedder::produce(edm::Event& iEvent, const edm::EventSetup& iS
   iEvent.getByToken(muons_, mus);
 
   
-  // associate photons to their closest leptons
-  std::vector<std::vector<PCandRef> > phosByEle = std::vector<std::vector<PCandRef> >(elecs->size());
-  std::vector<std::vector<PCandRef> > phosByMu = std::vector<std::vector<PCandRef> >(mus->size());
-
-  for( size_t iPho = 0; iPho != cands->size(); ++iPho )
+  // Evaluate the lepton selections once, and put the passing leptons in
+  // eta-phi grids so each photon only looks at nearby ones. The packed
+  // candidates in the passing electrons' superclusters go in a hash set so
+  // the supercluster veto is just a lookup
+  std::unordered_set<unsigned long long> footprint;
+  eGrid_.clear();
+  for(size_t iE = 0; iE < elecs->size(); ++iE)
     {
-      PCandRef pho = cands->refAt(iPho).castTo<PCandRef>();
-      
-      // basic selection
-      if (!phoSelection_(*pho))
+      const Elec& e = elecs->at(iE);
+      if(!eSelection_(e))
         continue;
 
-      std::list<std::pair<size_t, float> > closeEles;
-      std::list<std::pair<size_t, float> > closeMus;
+      eGrid_.add(iE, e.eta(), e.phi());
 
-      for(size_t iE = 0; iE < elecs->size(); ++iE)
-        {
-          float deltaR = reco::deltaR(pho->p4(), elecs->at(iE).p4());
+      for(const auto& cand : e.associatedPackedPFCandidates())
+        footprint.insert(footprintKey(cand));
+    }
 
-          if(deltaR > maxDR_ || !eSelection_(elecs->at(iE)))
-            continue;
+  mGrid_.clear();
+  for(size_t iM = 0; iM < mus->size(); ++iM)
+    {
+      if(mSelection_(mus->at(iM)))
+        mGrid_.add(iM, mus->at(iM).eta(), mus->at(iM).phi());
+    }
 
-          if(closeEles.empty() || deltaR < closeEles.front().second)
-            {
-              closeEles.emplace_front(std::pair<size_t, float>(iE, deltaR));
-            }
-          else
-            {
-              // we almost never need the second one, so don't waste time 
-              // sorting the rest
-              closeEles.emplace_back(std::pair<size_t, float>(iE, deltaR));
-            }
-        }
+  // associate photons to their closest leptons
+  std::vector<std::vector<PCandRef> > phosByEle = std::vector<std::vector<PCandRef> >(elecs->size());
+  std::vector<std::vector<PCandRef> > phosByMu = std::vector<std::vector<PCandRef> >(mus->size());
 
-      for(size_t iM = 0; iM < mus->size(); ++iM)
-        {
-          float deltaR = reco::deltaR(pho->p4(), mus->at(iM).p4());
+  // (index, deltaR) of leptons near the current photon, closest first
+  std::vector<std::pair<size_t, float> > closeEles;
+  std::vector<std::pair<size_t, float> > closeMus;
 
-          if(deltaR > maxDR_ || !mSelection_(mus->at(iM)))
-            continue;
+  auto closerFirst = [](const std::pair<size_t,float>& a,
+                        const std::pair<size_t,float>& b)
+    {return a.second < b.second || (a.second == b.second && a.first < b.first);};
 
-          if(closeMus.empty() || deltaR < closeMus.front().second)
-            {
-              closeMus.emplace_front(std::pair<size_t, float>(iM, deltaR));
-            }
-          else
+  // Is this electron removed by cross cleaning with any of the close muons?
+  auto crossCleaned = [&](const std::pair<size_t,float>& e)
+    {
+      for(auto& m : closeMus)
+        {
+          if(std::abs(e.second - m.second) < eMuCrossCleaningDR_)
             {
-              // we almost never need the second one, so don't waste time 
-              // sorting the rest
-              closeMus.emplace_back(std::pair<size_t, float>(iM, deltaR));
+              if(reco::deltaR(elecs->at(e.first).p4(),
+                              mus->at(m.first)) < eMuCrossCleaningDR_)
+                return true;
             }
         }
+      return false;
+    };
 
+  for( size_t iPho = 0; iPho != cands->size(); ++iPho )
+    {
+      // basic selection
+      if (!phoSelection_(cands->at(iPho)))
+        continue;
 
-      if(closeEles.size() && 
-         (closeMus.empty() || 
+      PCandRef pho = cands->refAt(iPho).castTo<PCandRef>();
+
+      closeEles.clear();
+      closeMus.clear();
+
+      eGrid_.forEachNear(pho->eta(), pho->phi(), maxDR_,
+                         [&](size_t iE)
+                         {
+                           float deltaR = reco::deltaR(pho->p4(), elecs->at(iE).p4());
+                           if(deltaR <= maxDR_)
+                             closeEles.emplace_back(iE, deltaR);
+                         });
+      mGrid_.forEachNear(pho->eta(), pho->phi(), maxDR_,
+                         [&](size_t iM)
+                         {
+                           float deltaR = reco::deltaR(pho->p4(), mus->at(iM).p4());
+                           if(deltaR <= maxDR_)
+                             closeMus.emplace_back(iM, deltaR);
+                         });
+
+      // there are almost never more than one or two of these
+      std::sort(closeEles.begin(), closeEles.end(), closerFirst);
+      std::sort(closeMus.begin(), closeMus.end(), closerFirst);
+
+      if(closeEles.size() &&
+         (closeMus.empty() ||
           closeEles.front().second < closeMus.front().second)
          )
         {
           // Make sure electron isn't removed by cross cleaning
-          bool crossCleaned = false;
-          for(auto& m : closeMus)
+          if(!crossCleaned(closeEles.front()))
+            phosByEle.at(closeEles.front().first).push_back(pho);
+          // if there are only muons left, use them
+          else if(closeEles.size() == 1)
+            {
+              if(closeMus.size() && closeMus.front().second < maxDR_)
+                phosByMu.at(closeMus.front().first).push_back(pho);
+            }
+          else
             {
-              if(std::abs(closeEles.front().second - m.second) < eMuCrossCleaningDR_)
+              // find the next closest electron that survives
+              for(auto e = closeEles.begin() + 1; e != closeEles.end(); ++e)
                 {
-                  if(reco::deltaR(elecs->at(closeEles.front().first).p4(),
-                                  mus->at(m.first)) < eMuCrossCleaningDR_)
+                  // if the best muon is better, use that
+                  if(closeMus.size() && e->second > closeMus.front().second)
                     {
-                      crossCleaned = true;
+                      phosByMu.at(closeMus.front().first).push_back(pho);
                       break;
                     }
-                }
-            }
-
-          if(!crossCleaned)
-            phosByEle.at(closeEles.front().first).push_back(pho);
-          else
-            {
-              // remove the bad electron
-              closeEles.pop_front();
-
-              //// find the new closest electron
-              // function for sorting these things
-              std::function<bool(const std::pair<size_t,float>&,
-                                 const std::pair<size_t,float>&)>
-                f([](const std::pair<size_t,float>& a, 
-                     const std::pair<size_t,float>& b)
-                  {return a.second < b.second;});
 
-              closeEles.sort(f);
-
-              // if there are only muons left, use them
-              if(closeEles.empty())
-                {
-                  if(closeMus.size() && closeMus.front().second < maxDR_)
-                    phosByMu.at(closeMus.front().first).push_back(pho);
-                }
-              else
-                {
-                  for(auto& e : closeEles)
+                  if(!crossCleaned(*e))
                     {
-                      // if the best muon is better, use that
-                      if(closeMus.size() && e.second > closeMus.front().second)
-                        {
-                          phosByMu.at(closeMus.front().first).push_back(pho);
-                          break;
-                        }
-
-                      // is this electron also cross cleaned?
-                      bool crossCleaned = false;
-                      for(auto& m : closeMus)
-                        {
-                          if(std::abs(e.second - m.second) < eMuCrossCleaningDR_)
-                            {
-                              if(reco::deltaR(elecs->at(e.first).p4(),
-                                              mus->at(m.first)) < eMuCrossCleaningDR_)
-                                {
-                                  crossCleaned = true;
-                                  break;
-                                }
-                            }
-                        }
-
-                      if(!crossCleaned)
-                        {
-                          phosByEle.at(e.first).push_back(pho);
-                          break;
-                        }
+                      phosByEle.at(e->first).push_back(pho);
+                      break;
                     }
                 }
             }
@@ -312,10 +380,9 @@ void PATObjectFSREmbedder::produce(edm::Event& iEvent, const edm::EventSetup& iS
         phosByMu.at(closeMus.front().first).push_back(pho);
     }
 
-  
+
   // Will be filled in isolation calculation function if needed
-  std::vector<PCandRef> nIsoCands;
-  std::vector<PCandRef> chIsoCands;
+  IsoInfo isoInfo;
 
   for(size_t iE = 0; iE < elecs->size(); ++iE)
     {
@@ -332,9 +399,9 @@ void PATObjectFSREmbedder::produce(edm::Event& iEvent, const edm::EventSetup& iS
 
           if(drEt > cut_ || drEt > dREtBestPho) continue;
 
-          if(candInSuperCluster(pho, elecs)) continue;
+          if(candInSuperCluster(pho, footprint)) continue;
 
-          if(!passIso(pho, nIsoCands, chIsoCands, cands)) continue;
+          if(!passIso(pho, isoInfo, cands)) continue;
 
           dREtBestPho = drEt;
           bestPho = pho;
@@ -364,9 +431,9 @@ void PATObjectFSREmbedder::produce(edm::Event& iEvent, const edm::EventSetup& iS
 
           if(drEt > cut_ || drEt > dREtBestPho) continue;
 
-          if(candInSuperCluster(pho, elecs)) continue;
+          if(candInSuperCluster(pho, footprint)) continue;
 
-          if(!passIso(pho, nIsoCands, chIsoCands, cands)) continue;
+          if(!passIso(pho, isoInfo, cands)) continue;
 
           dREtBestPho = drEt;
           bestPho = pho;
@@ -386,60 +453,57 @@ void PATObjectFSREmbedder::produce(edm::Event& iEvent, const edm::EventSetup& iS
 }
 
 
-bool PATObjectFSREmbedder::candInSuperCluster(const PCandRef& pho, 
-                                              const edm::Handle<edm::View<Elec> >& elecs) const
+unsigned long long PATObjectFSREmbedder::footprintKey(const PCandRef& cand)
 {
-  for(size_t iE = 0; iE < elecs->size(); ++iE)
-    {
-      ElecPtr elec = elecs->ptrAt(iE);
-      if(eSelection_(*elec))
-        {
-          for(auto& cand : elec->associatedPackedPFCandidates())
-            {
-              if(pho == cand)
-                return true;
-            }
-        }
-    }
+  return ((static_cast<unsigned long long>(cand.id().processIndex()) << 48) |
+          (static_cast<unsigned long long>(cand.id().productIndex()) << 32) |
+          static_cast<unsigned long long>(cand.key()));
+}
 
-  return false;
+
+bool PATObjectFSREmbedder::candInSuperCluster(const PCandRef& pho, 
+                                              const std::unordered_set<unsigned long long>& footprint) const
+{
+  return footprint.count(footprintKey(pho));
 }
 
 
 bool PATObjectFSREmbedder::passIso(const PCandRef& pho,
-                                   std::vector<PCandRef>& nIsoCands,
-                                   std::vector<PCandRef>& chIsoCands,
+                                   IsoInfo& isoInfo,
                                    const edm::Handle<edm::View<PCand> >& allCands) const
 {
+  auto found = isoInfo.results.find(pho.key());
+  if(found != isoInfo.results.end())
+    return found->second;
+
   // fill iso cand lists if needed
-  if(nIsoCands.size() == 0 && chIsoCands.size() == 0)
+  if(!isoInfo.filled)
     {
       for(size_t i = 0; i < allCands->size(); ++i)
         {
-          if(nIsoSelection_(allCands->at(i)))
-            nIsoCands.push_back(allCands->refAt(i).castTo<PCandRef>());
-          else if(chIsoSelection_(allCands->at(i)))
-            chIsoCands.push_back(allCands->refAt(i).castTo<PCandRef>());
+          const PCand& cand = allCands->at(i);
+
+          // The selections start with these pdgId requirements anyway, so
+          // skip the string cuts for everything else
+          int pdgId = std::abs(cand.pdgId());
+          if((pdgId == 22 || pdgId == 130) && nIsoSelection_(cand))
+            isoInfo.nIsoCands.add(cand.eta(), cand.phi(), cand.pt());
+          else if(pdgId == 211 && chIsoSelection_(cand))
+            isoInfo.chIsoCands.add(cand.eta(), cand.phi(), cand.pt());
         }
-    }
 
-  double iso = 0.;
-
-  for(auto& cand : nIsoCands)
-    {
-      double dR = reco::deltaR(pho->p4(), cand->p4());
-      if(dR < isoDR_ && dR > nIsoVetoDR_)
-        iso += cand->pt();
+      isoInfo.nIsoCands.sort();
+      isoInfo.chIsoCands.sort();
+      isoInfo.filled = true;
     }
 
-  for(auto& cand : chIsoCands)
-    {
-      double dR = reco::deltaR(pho->p4(), cand->p4());
-      if(dR < isoDR_ && dR > chIsoVetoDR_)
-        iso += cand->pt();
-    }
+  double iso = (isoInfo.nIsoCands.coneSum(pho->eta(), pho->phi(), isoDR_, nIsoVetoDR_) +
+                isoInfo.chIsoCands.coneSum(pho->eta(), pho->phi(), isoDR_, chIsoVetoDR_));
+
+  bool pass = iso / pho->pt() < relIsoCut_;
+  isoInfo.results[pho.key()] = pass;
 
-  return iso / pho->pt() < relIsoCut_;
+  return pass;
 }
 
 
@@ -6,6 +6,7 @@
 //    content of the bin the object would fill as a userFloat with a         //
 //    specified label. If the "useError" option is used, the bin error is    //
 //    also stored, with the same label except with "Error" appended.         //
+//    Also available as the "ScaleFactor" step of a PATObjectEmbedderChain.  //
 //                                                                           //
 //    Nate Woods, U. Wisconsin                                               //
 //                                                                           //
@@ -18,6 +19,9 @@
 #include <string>
 #include <iostream>
 #include <fstream>
+#include <cctype>
+#include <cmath>
+#include <type_traits>
 
 // CMS includes
 #include "FWCore/Framework/interface/Frameworkfwd.h"
@@ -34,37 +38,136 @@
 #include "DataFormats/Common/interface/View.h"
 #include "CommonTools/Utils/interface/StringObjectFunction.h"
 
-// ROOT includes
-#include "TH2F.h"
-#include "TFile.h"
+// UWVV
+#include "UWVV/AnalysisTools/interface/EmbeddingStep.h"
+#include "UWVV/AnalysisTools/interface/PATObjectStepEmbedder.h"
+#include "UWVV/Utilities/interface/ScaleFactorTable.h"
+
+
+namespace
+{
+  // Check whether an object has a supercluster (electrons and photons)
+  template<class T>
+    class HasSuperCluster
+    {
+      template<class U> static auto
+        test(int) -> decltype(std::declval<const U&>().superCluster()->eta(),
+                              std::true_type());
+      template<class U> static std::false_type test(...);
+
+     public:
+      static const bool value = decltype(test<T>(0))::value;
+    };
+
+  template<class T>
+    typename std::enable_if<HasSuperCluster<T>::value, float>::type
+    superClusterEta(const T& obj) {return obj.superCluster()->eta();}
+
+  template<class T>
+    typename std::enable_if<!HasSuperCluster<T>::value, float>::type
+    superClusterEta(const T& obj)
+  {
+    throw cms::Exception("InvalidParams")
+      << "Object has no supercluster" << std::endl;
+  }
+
+
+  // One of the histogram axis variables. The common ones are computed
+  // directly, anything else goes through a StringObjectFunction.
+  template<typename T>
+    class ScaleFactorVariable
+    {
+     public:
+      ScaleFactorVariable(const std::string& expression) :
+        kind(parse(expression)),
+        function(expression)
+      {
+      }
+
+      float operator()(const T& obj) const
+      {
+        switch(kind)
+          {
+          case ETA:
+            return obj.eta();
+          case ABSETA:
+            return std::abs(obj.eta());
+          case PT:
+            return obj.pt();
+          case SCETA:
+            return superClusterEta(obj);
+          default:
+            return function(obj);
+          }
+      }
+
+     private:
+      enum Kind {EXPRESSION, ETA, ABSETA, PT, SCETA};
+
+      static Kind parse(const std::string& expression)
+      {
+        std::string expr;
+        for(char c : expression)
+          if(!std::isspace(c))
+            expr += c;
+
+        // "eta()" and "eta" mean the same thing
+        size_t pos;
+        while((pos = expr.find("()")) != std::string::npos)
+          expr.erase(pos, 2);
+
+        if(expr == "eta")
+          return ETA;
+        if(expr == "abs(eta)")
+          return ABSETA;
+        if(expr == "pt")
+          return PT;
+        if(expr == "superCluster.eta" && HasSuperCluster<T>::value)
+          return SCETA;
+
+        return EXPRESSION;
+      }
+
+      const Kind kind;
+      const StringObjectFunction<T> function;
+    };
+}
 
 
 template<typename T>
-class PATObjectScaleFactorEmbedder : public edm::stream::EDProducer<>
+class ScaleFactorEmbeddingStep : public uwvv::EmbeddingStep<T>
 {
 
 public:
-  explicit PATObjectScaleFactorEmbedder(const edm::ParameterSet& iConfig);
-  virtual ~PATObjectScaleFactorEmbedder() {};
+  ScaleFactorEmbeddingStep(const edm::ParameterSet& iConfig, edm::ConsumesCollector cc);
+  virtual ~ScaleFactorEmbeddingStep() {};
 
-private:
-  virtual void produce(edm::Event& iEvent, const edm::EventSetup& iSetup);
+  virtual void embed(T& obj, const edm::Ptr<T>& original) override;
+  virtual void embedAll(std::vector<T>& objs, const edm::View<T>& originals) override;
 
-  const edm::EDGetTokenT<edm::View<T> > srcToken;
-  std::unique_ptr<TFile> file;
-  std::unique_ptr<TH2F> h;
+private:
+  std::shared_ptr<const uwvv::ScaleFactorTable> table;
   const std::string label;
+  const std::string errorLabel;
   const bool useError;
 
-  StringObjectFunction<T> xFunction;
-  StringObjectFunction<T> yFunction;
+  const ScaleFactorVariable<T> xFunction;
+  const ScaleFactorVariable<T> yFunction;
+
+  // Reused for the whole-collection lookups
+  std::vector<float> xValues;
+  std::vector<float> yValues;
+  std::vector<float> values;
+  std::vector<float> errors;
 };
 
 
 template<typename T>
-PATObjectScaleFactorEmbedder<T>::PATObjectScaleFactorEmbedder(const edm::ParameterSet& iConfig) :
-  srcToken(consumes<edm::View<T> >(iConfig.getParameter<edm::InputTag>("src"))),
+ScaleFactorEmbeddingStep<T>::ScaleFactorEmbeddingStep(const edm::ParameterSet& iConfig,
+                                                      edm::ConsumesCollector cc) :
+  uwvv::EmbeddingStep<T>(iConfig, cc),
   label(iConfig.getParameter<std::string>("label")),
+  errorLabel(label+"Error"),
   useError(iConfig.exists("useError") && 
            iConfig.getParameter<bool>("useError")),
   xFunction(iConfig.exists("xValue") ?
@@ -75,88 +178,77 @@ PATObjectScaleFactorEmbedder<T>::PATObjectScaleFactorEmbedder(const edm::Paramet
             "pt")
 {
   std::string baseName = iConfig.getParameter<std::string>("fileName");
+  const std::string histName = iConfig.getParameter<std::string>("histName");
 
   // For crab submission, the data directory will be copied over without
   // the UWVV base directory. In this case we also check in this path
-  // if the original file path isn't found
+  // if the original file path isn't found. The ROOT file is needed even
+  // if there's a binary table, to check the table is up to date.
   std::ifstream checkfile(baseName);
   if (!checkfile.good())
     baseName = baseName.substr(baseName.find("UWVV/")+5);
-  file = std::unique_ptr<TFile>(new TFile(baseName.c_str()));
-  h = std::unique_ptr<TH2F>((file->IsOpen() && !file->IsZombie()) ? 
-      (TH2F*)(file->Get(iConfig.getParameter<std::string>("histName").c_str())->Clone()) :
-      new TH2F("h","h",1,0.,1.,1,0.,1.));
-  if(file->IsZombie())
-    throw cms::Exception("InvalidFile") 
-      << "Scale factor file "<< iConfig.getParameter<std::string>("fileName")
-      << " does not exist!" << std::endl;
-
-  produces<std::vector<T> >();
+
+  // Tables are shared by all modules and streams using the same histogram
+  table = uwvv::ScaleFactorTableCache::get(baseName, histName);
+}
+
+
+// Points outside the histogram get the value of the nearest bin instead of
+// 0 for under/overflow
+template<typename T>
+void ScaleFactorEmbeddingStep<T>::embed(T& obj, const edm::Ptr<T>& original)
+{
+  const size_t bin = table->bin(xFunction(obj), yFunction(obj));
+
+  obj.addUserFloat(label, table->value(bin));
+  if(useError)
+    obj.addUserFloat(errorLabel, table->error(bin));
 }
 
 
 template<typename T>
-void PATObjectScaleFactorEmbedder<T>::produce(edm::Event& iEvent,
-                                              const edm::EventSetup& iSetup)
+void ScaleFactorEmbeddingStep<T>::embedAll(std::vector<T>& objs,
+                                           const edm::View<T>& originals)
 {
-  edm::Handle<edm::View<T> > in;
-  std::unique_ptr<std::vector<T> > out(new std::vector<T>);
+  const size_t n = objs.size();
 
-  iEvent.getByToken(srcToken, in);
+  xValues.resize(n);
+  yValues.resize(n);
+  values.resize(n);
+  errors.resize(n);
 
-  for(size_t i = 0; i < in->size(); ++i)
+  for(size_t i = 0; i < n; ++i)
     {
-      const T& t = in->at(i);
-
-      float x = xFunction(t);
-      float y = yFunction(t);
-
-      // don't just give 0 for under/overflow
-      int bin = h->FindBin(x, y);
-      if(h->IsBinOverflow(bin))
-        {
-          int binx, biny, binz;
-          h->GetBinXYZ(bin, binx, biny, binz);
-          if(binx > h->GetNbinsX())
-            binx -= 1;
-          if(biny > h->GetNbinsY())
-            biny -= 1;
-          
-          bin = h->GetBin(binx, biny, binz);
-        }
-      if(h->IsBinUnderflow(bin))
-        {
-          int binx, biny, binz;
-          h->GetBinXYZ(bin, binx, biny, binz);
-          if(!binx)
-            binx += 1;
-          if(!biny)
-            biny += 1;
-          
-          bin = h->GetBin(binx, biny, binz);
-        }
-
-      float value = h->GetBinContent(bin);
-      float error = h->GetBinError(bin);
-
-      out->push_back(t); // copies with ownership
-      out->back().addUserFloat(label, value);
-      if(useError)
-        out->back().addUserFloat(label+"Error", error);
+      xValues[i] = xFunction(objs[i]);
+      yValues[i] = yFunction(objs[i]);
     }
 
-  iEvent.put(std::move(out));
+  table->lookup(n, xValues.data(), yValues.data(), values.data(),
+                useError ? errors.data() : nullptr);
+
+  for(size_t i = 0; i < n; ++i)
+    {
+      objs[i].addUserFloat(label, values[i]);
+      if(useError)
+        objs[i].addUserFloat(errorLabel, errors[i]);
+    }
 }
 
 
-typedef PATObjectScaleFactorEmbedder<pat::Electron> PATElectronScaleFactorEmbedder;
-typedef PATObjectScaleFactorEmbedder<pat::Muon> PATMuonScaleFactorEmbedder;
-typedef PATObjectScaleFactorEmbedder<pat::Tau> PATTauScaleFactorEmbedder;
-typedef PATObjectScaleFactorEmbedder<pat::Jet> PATJetScaleFactorEmbedder;
-typedef PATObjectScaleFactorEmbedder<pat::CompositeCandidate> PATCompositeCandidateScaleFactorEmbedder;
+typedef PATObjectStepEmbedder<ScaleFactorEmbeddingStep<pat::Electron> > PATElectronScaleFactorEmbedder;
+typedef PATObjectStepEmbedder<ScaleFactorEmbeddingStep<pat::Muon> > PATMuonScaleFactorEmbedder;
+typedef PATObjectStepEmbedder<ScaleFactorEmbeddingStep<pat::Tau> > PATTauScaleFactorEmbedder;
+typedef PATObjectStepEmbedder<ScaleFactorEmbeddingStep<pat::Jet> > PATJetScaleFactorEmbedder;
+typedef PATObjectStepEmbedder<ScaleFactorEmbeddingStep<pat::CompositeCandidate> > PATCompositeCandidateScaleFactorEmbedder;
 
 DEFINE_FWK_MODULE(PATElectronScaleFactorEmbedder);
 DEFINE_FWK_MODULE(PATMuonScaleFactorEmbedder);
 DEFINE_FWK_MODULE(PATTauScaleFactorEmbedder);
 DEFINE_FWK_MODULE(PATJetScaleFactorEmbedder);
 DEFINE_FWK_MODULE(PATCompositeCandidateScaleFactorEmbedder);
+
+DEFINE_EMBEDDING_STEP(pat::Electron, ScaleFactorEmbeddingStep<pat::Electron>, "ScaleFactor");
+DEFINE_EMBEDDING_STEP(pat::Muon, ScaleFactorEmbeddingStep<pat::Muon>, "ScaleFactor");
+DEFINE_EMBEDDING_STEP(pat::Tau, ScaleFactorEmbeddingStep<pat::Tau>, "ScaleFactor");
+DEFINE_EMBEDDING_STEP(pat::Jet, ScaleFactorEmbeddingStep<pat::Jet>, "ScaleFactor");
+DEFINE_EMBEDDING_STEP(pat::CompositeCandidate, ScaleFactorEmbeddingStep<pat::CompositeCandidate>, "ScaleFactor");
@@ -3,7 +3,8 @@
 //    PATObjectValueEmbedder                                                 //
 //                                                                           //
 //    Takes a collection of PAT objects and some ints, bools, float, and     //
-//    doubles, and embeds them as userInts/userFloats in the objects         //
+//    doubles, and embeds them as userInts/userFloats in the objects.        //
+//    Also available as the "Value" step of a PATObjectEmbedderChain.        //
 //                                                                           //
 //    Nate Woods and Kenneth Long, U. Wisconsin                              //
 //                                                                           //
@@ -30,23 +31,29 @@
 #include "DataFormats/Common/interface/View.h"
 #include "FWCore/Utilities/interface/transform.h"
 
+// UWVV
+#include "UWVV/AnalysisTools/interface/EmbeddingStep.h"
+#include "UWVV/AnalysisTools/interface/PATObjectStepEmbedder.h"
+
 
 template<class T>
-class PATObjectValueEmbedder : public edm::stream::EDProducer<>
+class ValueEmbeddingStep : public uwvv::EmbeddingStep<T>
 {
 
 public:
-  explicit PATObjectValueEmbedder(const edm::ParameterSet& iConfig);
-  virtual ~PATObjectValueEmbedder() {};
+  ValueEmbeddingStep(const edm::ParameterSet& iConfig, edm::ConsumesCollector cc);
+  virtual ~ValueEmbeddingStep() {};
+
+  virtual void setEvent(const edm::Event& iEvent) override;
+  virtual void embed(T& obj, const edm::Ptr<T>& original) override;
 
 private:
-  virtual void produce(edm::Event& iEvent, const edm::EventSetup& iSetup);
   void embedValue(T& object, const int value, const std::string& label) const;
   void embedValue(T& object, const bool value, const std::string& label) const;
   void embedValue(T& object, const double value, const std::string& label) const;
   void embedValue(T& object, const float value, const std::string& label) const;
   template<typename V>
-  void embedAll(std::vector<T>& objects, const std::vector<V>& values,
+  void embedAll(T& obj, const std::vector<V>& values,
                 const std::vector<std::string>& labels) const;
 
   template<typename V>
@@ -54,7 +61,6 @@ private:
                       const std::vector<edm::EDGetTokenT<V> >& tokens, 
                       const edm::Event& iEvent) const;
 
-  const edm::EDGetTokenT<edm::View<T> > srcToken_;
   const std::vector<edm::EDGetTokenT<int> > intTokens_;
   const std::vector<edm::EDGetTokenT<bool> > boolTokens_;
   const std::vector<edm::EDGetTokenT<double> > doubleTokens_;
@@ -63,28 +69,35 @@ private:
   const std::vector<std::string> boolLabels_;
   const std::vector<std::string> doubleLabels_;
   const std::vector<std::string> floatLabels_;
+
+  // this event's values
+  std::vector<int> ints_;
+  std::vector<bool> bools_;
+  std::vector<double> doubles_;
+  std::vector<float> floats_;
 };
 
 
 template<class T>
-PATObjectValueEmbedder<T>::PATObjectValueEmbedder(const edm::ParameterSet& iConfig) :
-  srcToken_(consumes<edm::View<T> >(iConfig.getParameter<edm::InputTag>("src"))),
+ValueEmbeddingStep<T>::ValueEmbeddingStep(const edm::ParameterSet& iConfig,
+                                          edm::ConsumesCollector cc) :
+  uwvv::EmbeddingStep<T>(iConfig, cc),
   intTokens_(edm::vector_transform(iConfig.exists("intSrc") ?
                                    iConfig.getParameter<std::vector<edm::InputTag> >("intSrc") :
                                    std::vector<edm::InputTag>(),
-                                   [this](edm::InputTag const& tag){return consumes<int>(tag);})),
+                                   [&cc](edm::InputTag const& tag){return cc.consumes<int>(tag);})),
   boolTokens_(edm::vector_transform(iConfig.exists("boolSrc") ?
                                     iConfig.getParameter<std::vector<edm::InputTag> >("boolSrc") : 
                                     std::vector<edm::InputTag>(),
-                                    [this](edm::InputTag const& tag){return consumes<bool>(tag);})),
+                                    [&cc](edm::InputTag const& tag){return cc.consumes<bool>(tag);})),
   doubleTokens_(edm::vector_transform(iConfig.exists("doubleSrc") ?
                                       iConfig.getParameter<std::vector<edm::InputTag> >("doubleSrc") :
                                       std::vector<edm::InputTag>(),
-                                      [this](edm::InputTag const& tag){return consumes<double>(tag);})),
+                                      [&cc](edm::InputTag const& tag){return cc.consumes<double>(tag);})),
   floatTokens_(edm::vector_transform(iConfig.exists("floatSrc") ?
                                      iConfig.getParameter<std::vector<edm::InputTag> >("floatSrc") :
                                      std::vector<edm::InputTag>(),
-                                     [this](edm::InputTag const& tag){return consumes<float>(tag);})),
+                                     [&cc](edm::InputTag const& tag){return cc.consumes<float>(tag);})),
   intLabels_(iConfig.exists("intLabels") ?
              iConfig.getParameter<std::vector<std::string> >("intLabels") :
              std::vector<std::string>()),
@@ -98,8 +111,6 @@ PATObjectValueEmbedder<T>::PATObjectValueEmbedder(const edm::ParameterSet& iConf
                iConfig.getParameter<std::vector<std::string> >("floatLabels") :
                std::vector<std::string>())
 {
-  produces<std::vector<T> >();
-
   if(intTokens_.size() != intLabels_.size())
     throw cms::Exception("InvalidParams")
       << "You must supply exactly one label for each int you want to embed" 
@@ -131,36 +142,26 @@ PATObjectValueEmbedder<T>::PATObjectValueEmbedder(const edm::ParameterSet& iConf
 
 
 template<class T>
-void PATObjectValueEmbedder<T>::produce(edm::Event& iEvent,
-                                        const edm::EventSetup& iSetup)
+void ValueEmbeddingStep<T>::setEvent(const edm::Event& iEvent)
+{
+  retrieveValues(ints_, intTokens_, iEvent);
+  retrieveValues(bools_, boolTokens_, iEvent);
+  retrieveValues(doubles_, doubleTokens_, iEvent);
+  retrieveValues(floats_, floatTokens_, iEvent);
+}
+
+
+template<class T>
+void ValueEmbeddingStep<T>::embed(T& obj, const edm::Ptr<T>& original)
 {
-  edm::Handle<edm::View<T> > in;
-  std::unique_ptr<std::vector<T> > out(new std::vector<T>);
-  iEvent.getByToken(srcToken_, in);
-  for(size_t i = 0; i < in->size(); ++i)
-    out->push_back(in->at(i));
-  
-  std::vector<int> ints;
-  retrieveValues(ints, intTokens_, iEvent);
-  embedAll(*out, ints, intLabels_);
-
-  std::vector<bool> bools;
-  retrieveValues(bools, boolTokens_, iEvent);
-  embedAll(*out, bools, boolLabels_);
-
-  std::vector<double> doubles;
-  retrieveValues(doubles, doubleTokens_, iEvent);
-  embedAll(*out, doubles, doubleLabels_);
-
-  std::vector<float> floats;
-  retrieveValues(floats, floatTokens_, iEvent);
-  embedAll(*out, floats, floatLabels_);
-
-  iEvent.put(std::move(out));
+  embedAll(obj, ints_, intLabels_);
+  embedAll(obj, bools_, boolLabels_);
+  embedAll(obj, doubles_, doubleLabels_);
+  embedAll(obj, floats_, floatLabels_);
 }
 
 template<class T>
-void PATObjectValueEmbedder<T>::embedValue(T& object,
+void ValueEmbeddingStep<T>::embedValue(T& object,
                                            const double value, 
                                            const std::string& label) const
 {
@@ -168,7 +169,7 @@ void PATObjectValueEmbedder<T>::embedValue(T& object,
 }
 
 template<class T>
-void PATObjectValueEmbedder<T>::embedValue(T& object,
+void ValueEmbeddingStep<T>::embedValue(T& object,
                                            const float value, 
                                            const std::string& label) const
 {
@@ -176,7 +177,7 @@ void PATObjectValueEmbedder<T>::embedValue(T& object,
 }
 
 template<class T>
-void PATObjectValueEmbedder<T>::embedValue(T& object,
+void ValueEmbeddingStep<T>::embedValue(T& object,
                                            const int value, 
                                            const std::string& label) const
 {
@@ -184,7 +185,7 @@ void PATObjectValueEmbedder<T>::embedValue(T& object,
 }
 
 template<class T>
-void PATObjectValueEmbedder<T>::embedValue(T& object,
+void ValueEmbeddingStep<T>::embedValue(T& object,
                                            const bool value, 
                                            const std::string& label) const
 {
@@ -193,7 +194,7 @@ void PATObjectValueEmbedder<T>::embedValue(T& object,
 
 template<class T>
 template<typename V>
-void PATObjectValueEmbedder<T>::retrieveValues(std::vector<V>& toFill,
+void ValueEmbeddingStep<T>::retrieveValues(std::vector<V>& toFill,
                                                const std::vector<edm::EDGetTokenT<V> >& tokens,
                                                const edm::Event& iEvent) const
 {
@@ -209,27 +210,30 @@ void PATObjectValueEmbedder<T>::retrieveValues(std::vector<V>& toFill,
 
 template<class T>
 template<typename V>
-void PATObjectValueEmbedder<T>::embedAll(std::vector<T>& objects, 
-                                         const std::vector<V>& values,
-                                         const std::vector<std::string>& labels) const
+void ValueEmbeddingStep<T>::embedAll(T& obj,
+                                     const std::vector<V>& values,
+                                     const std::vector<std::string>& labels) const
 {
-  for(auto& obj : objects)
+  for(size_t i = 0; i < values.size(); ++i)
     {
-      for(size_t i = 0; i < values.size(); ++i)
-        {
-          embedValue(obj, values.at(i), labels.at(i));
-        }
+      embedValue(obj, values.at(i), labels.at(i));
     }
 }
 
-typedef PATObjectValueEmbedder<pat::Electron> PATElectronValueEmbedder;
-typedef PATObjectValueEmbedder<pat::Muon> PATMuonValueEmbedder;
-typedef PATObjectValueEmbedder<pat::Tau> PATTauValueEmbedder;
-typedef PATObjectValueEmbedder<pat::Jet> PATJetValueEmbedder;
-typedef PATObjectValueEmbedder<pat::CompositeCandidate> PATCompositeCandidateValueEmbedder;
+typedef PATObjectStepEmbedder<ValueEmbeddingStep<pat::Electron> > PATElectronValueEmbedder;
+typedef PATObjectStepEmbedder<ValueEmbeddingStep<pat::Muon> > PATMuonValueEmbedder;
+typedef PATObjectStepEmbedder<ValueEmbeddingStep<pat::Tau> > PATTauValueEmbedder;
+typedef PATObjectStepEmbedder<ValueEmbeddingStep<pat::Jet> > PATJetValueEmbedder;
+typedef PATObjectStepEmbedder<ValueEmbeddingStep<pat::CompositeCandidate> > PATCompositeCandidateValueEmbedder;
 
 DEFINE_FWK_MODULE(PATElectronValueEmbedder);
 DEFINE_FWK_MODULE(PATMuonValueEmbedder);
 DEFINE_FWK_MODULE(PATTauValueEmbedder);
 DEFINE_FWK_MODULE(PATJetValueEmbedder);
 DEFINE_FWK_MODULE(PATCompositeCandidateValueEmbedder);
+
+DEFINE_EMBEDDING_STEP(pat::Electron, ValueEmbeddingStep<pat::Electron>, "Value");
+DEFINE_EMBEDDING_STEP(pat::Muon, ValueEmbeddingStep<pat::Muon>, "Value");
+DEFINE_EMBEDDING_STEP(pat::Tau, ValueEmbeddingStep<pat::Tau>, "Value");
+DEFINE_EMBEDDING_STEP(pat::Jet, ValueEmbeddingStep<pat::Jet>, "Value");
+DEFINE_EMBEDDING_STEP(pat::CompositeCandidate, ValueEmbeddingStep<pat::CompositeCandidate>, "Value");
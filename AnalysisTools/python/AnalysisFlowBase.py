@@ -13,10 +13,16 @@ class AnalysisFlowBase(object):
     def __init__(self, name, process=None, suffix='', *args, **initialInputs):
         '''
         Keyword arguments are interpreted as changes from the default
-        initial object input tags.
+        initial object input tags, except fuseEmbedders, which turns on
+        merging of consecutive embedder modules (see
+        AnalysisStep.fusedModules()), and jetVariationOverlay, which makes
+        jet systematic shifts JetVariations embedded in the nominal jets
+        instead of separate jet collections.
         '''
         self.name = name
         self.suffix = suffix
+        self.fuseEmbedders = initialInputs.pop('fuseEmbedders', False)
+        self.jetVariationOverlay = initialInputs.pop('jetVariationOverlay', False)
 
         self.inputs = self.getInitialInputs(**initialInputs)
         self.outputs = []
@@ -86,7 +92,10 @@ class AnalysisFlowBase(object):
         '''
         self.inheritGuard('makeAnalysisStep')
 
-        return AnalysisStep(self.name + step, self.suffix, **inputs)
+        step = AnalysisStep(self.name + step, self.suffix, **inputs)
+        step.fuseEmbedders = self.fuseEmbedders
+
+        return step
 
     
     def setupPath(self):
@@ -9,6 +9,15 @@ from UWVV.Utilities.helpers import getObjTypes, getObjName
 from collections import OrderedDict
 
 
+# Embedder modules that also exist as steps of a PAT<Type>EmbedderChain,
+# mapped to the object type and the name of the step
+_fusableEmbedders = {}
+for _t in ['Electron', 'Muon', 'Tau', 'Jet', 'CompositeCandidate']:
+    for _step in ['Expression', 'Value', 'ScaleFactor']:
+        _fusableEmbedders['PAT{}{}Embedder'.format(_t, _step)] = (_t, _step)
+_fusableEmbedders['PATElectronEAEmbedder'] = ('Electron', 'EA')
+
+
 
 class AnalysisStep(object):
     '''
@@ -21,6 +30,10 @@ class AnalysisStep(object):
         self.outputs = initialInputTags.copy()
 
         self.modules = OrderedDict()
+
+        # If True, runs of consecutive embedders on the same collection are
+        # replaced by a single embedder chain module in makeSequence()
+        self.fuseEmbedders = False
     
 
     def getObjTag(self, obj):
@@ -69,7 +82,11 @@ class AnalysisStep(object):
         seq = cms.Sequence()
         setattr(process, self.name+"Sequence", seq)
 
-        for name, mod in self.modules.iteritems():
+        modules = self.modules
+        if self.fuseEmbedders:
+            modules = self.fusedModules()
+
+        for name, mod in modules.iteritems():
             if not hasattr(process, name+self.suffix):
                 setattr(process, name+self.suffix, mod)
             if not isinstance(mod, cms.ESSource):
@@ -78,6 +95,86 @@ class AnalysisStep(object):
         return seq
 
 
+    def fusedModules(self):
+        '''
+        Get the modules of this step, with each run of two or more embedders
+        (see _fusableEmbedders) that work on the same type of object, each
+        taking the previous one's output as its src, replaced by a single
+        PAT<Type>EmbedderChain. The chain gets the name of the last module
+        in the run, so the collection tags are unchanged. A run is broken
+        wherever another module uses an intermediate collection.
+        '''
+        usedBy = {}
+        for name, mod in self.modules.iteritems():
+            if isinstance(mod, _ModuleSequenceType) or not hasattr(mod, 'parameterNames_'):
+                continue
+            for label in _inputLabels(mod):
+                usedBy.setdefault(label, set()).add(name)
+
+        out = OrderedDict()
+        run = []
+
+        def flush():
+            if len(run) > 1:
+                name, chain = self._makeEmbedderChain(run)
+                out[name] = chain
+            else:
+                for name, mod in run:
+                    out[name] = mod
+            del run[:]
+
+        for name, mod in self.modules.iteritems():
+            fusable = (not isinstance(mod, _ModuleSequenceType) and
+                       hasattr(mod, 'type_') and
+                       mod.type_() in _fusableEmbedders and
+                       isinstance(getattr(mod, 'src', None), cms.InputTag))
+
+            if run:
+                prevName, prevMod = run[-1]
+                prevLabel = prevName + self.suffix
+                if not (fusable and
+                        _fusableEmbedders[mod.type_()][0] == _fusableEmbedders[prevMod.type_()][0] and
+                        mod.src.getModuleLabel() == prevLabel and
+                        mod.src.getProductInstanceLabel() == '' and
+                        usedBy.get(prevLabel, set()) == set([name])):
+                    flush()
+
+            if fusable:
+                run.append((name, mod))
+            else:
+                out[name] = mod
+
+        flush()
+
+        return out
+
+
+    def _makeEmbedderChain(self, run):
+        '''
+        Make one embedder chain module equivalent to the list of
+        (name, module) pairs in run. Returns the name and the chain.
+        '''
+        objType = _fusableEmbedders[run[0][1].type_()][0]
+
+        steps = cms.VPSet()
+        for name, mod in run:
+            stepParams = cms.PSet(
+                type = cms.string(_fusableEmbedders[mod.type_()][1]),
+                )
+            for param in mod.parameterNames_():
+                if param != 'src':
+                    setattr(stepParams, param, getattr(mod, param))
+            steps.append(stepParams)
+
+        chain = cms.EDProducer(
+            'PAT{}EmbedderChain'.format(objType),
+            src = run[0][1].src,
+            steps = steps,
+            )
+
+        return run[-1][0], chain
+
+
     def addBasicSelector(self, obj, selection, name='', objectType='', 
                          newCollection=''):
         '''
@@ -153,3 +250,26 @@ class AnalysisStep(object):
 
         self.addModule(''.join([obj, name if name else 'crossCleaning', 
                                 self.name]).replace('_',''), mod, obj)
+
+
+
+def _inputLabels(pset):
+    '''
+    Module labels of all InputTags used by a module or PSet, including those
+    in nested PSets.
+    '''
+    labels = set()
+    for name in pset.parameterNames_():
+        param = getattr(pset, name)
+        if isinstance(param, cms.InputTag):
+            labels.add(param.getModuleLabel())
+        elif isinstance(param, cms.VInputTag):
+            for tag in param:
+                labels.add(str(tag).split(':')[0])
+        elif isinstance(param, cms.PSet):
+            labels |= _inputLabels(param)
+        elif isinstance(param, cms.VPSet):
+            for p in param:
+                labels |= _inputLabels(p)
+
+    return labels
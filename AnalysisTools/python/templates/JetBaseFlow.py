@@ -49,78 +49,102 @@ class JetBaseFlow(AnalysisFlowBase):
                            self.process.jecSequence,
                            'j')
 
-            if self.isMC:
-                # shift corrections up and down for systematics
+            if self.isMC and self.jetVariationOverlay:
+                # Systematic shifts are embedded in the nominal jets as
+                # JetVariations instead of being separate collections
                 jesShifts = cms.EDProducer(
                     "PATJetEnergyScaleShifter",
                     src = step.getObjTag('j'),
+                    makeVariations = cms.bool(True),
                     )
-                step.addModule('jesShifts', jesShifts, 'j_jesUp', 'j_jesDown',
-                               j_jesUp='jesUp', j_jesDown='jesDown')
+                step.addModule('jesShifts', jesShifts, 'j')
 
-            jetIDEmbedding = cms.EDProducer(
-                "PATJetIDEmbedder",
-                src = step.getObjTag('j'),
-                )
-            step.addModule('jetIDEmbedding', jetIDEmbedding, 'j')
-
-            if self.isMC:
-                jetIDEmbedding_jesUp = cms.EDProducer(
-                    "PATJetIDEmbedder",
-                    src = step.getObjTag('j_jesUp'),
-                    )
-                step.addModule('jetIDEmbeddingJESUp', jetIDEmbedding_jesUp, 'j_jesUp')
-                jetIDEmbedding_jesDown = cms.EDProducer(
+                jetIDEmbedding = cms.EDProducer(
                     "PATJetIDEmbedder",
-                    src = step.getObjTag('j_jesDown'),
+                    src = step.getObjTag('j'),
                     )
-                step.addModule('jetIDEmbeddingJESDown', jetIDEmbedding_jesDown, 'j_jesDown')
-
+                step.addModule('jetIDEmbedding', jetIDEmbedding, 'j')
 
                 jetSmearing = cms.EDProducer(
                     "PATJetSmearing",
                     src = step.getObjTag('j'),
                     rhoSrc = cms.InputTag("fixedGridRhoFastjetAll"),
-                    systematics = cms.bool(True),
-                    )
-                step.addModule("jetSmearing", jetSmearing, 'j', 'j_jerUp',
-                               'j_jerDown', j_jerUp='jerUp', j_jerDown='jerDown')
-
-                jetSmearing_jesUp = jetSmearing.clone(src = step.getObjTag('j_jesUp'),
-                                                      systematics = cms.bool(False))
-                step.addModule("jetSmearingJESUp", jetSmearing_jesUp, 'j_jesUp')
-                jetSmearing_jesDown = jetSmearing.clone(src = step.getObjTag('j_jesDown'),
-                                                      systematics = cms.bool(False))
-                step.addModule("jetSmearingJESDown", jetSmearing_jesDown, 'j_jesDown')
-
-                # need to re-sort now that we're calibrated
-                jSort_jesUp = cms.EDProducer(
-                    "PATJetCollectionSorter",
-                    src = step.getObjTag('j_jesUp'),
-                    function = cms.string('pt'),
-                    )
-                step.addModule('jetSortingJESUp', jSort_jesUp, 'j_jesUp')
-
-                jSort_jesDn = cms.EDProducer(
-                    "PATJetCollectionSorter",
-                    src = step.getObjTag('j_jesDown'),
-                    function = cms.string('pt'),
-                    )
-                step.addModule('jetSortingJESDn', jSort_jesDn, 'j_jesDown')
-
-                jSort_jerUp = cms.EDProducer(
-                    "PATJetCollectionSorter",
-                    src = step.getObjTag('j_jerUp'),
-                    function = cms.string('pt'),
+                    makeVariations = cms.bool(True),
                     )
-                step.addModule('jetSortingJERUp', jSort_jerUp, 'j_jerUp')
-
-                jSort_jerDn = cms.EDProducer(
-                    "PATJetCollectionSorter",
-                    src = step.getObjTag('j_jerDown'),
-                    function = cms.string('pt'),
+                step.addModule("jetSmearing", jetSmearing, 'j')
+            else:
+                if self.isMC:
+                    # shift corrections up and down for systematics
+                    jesShifts = cms.EDProducer(
+                        "PATJetEnergyScaleShifter",
+                        src = step.getObjTag('j'),
+                        )
+                    step.addModule('jesShifts', jesShifts, 'j_jesUp', 'j_jesDown',
+                                   j_jesUp='jesUp', j_jesDown='jesDown')
+
+                jetIDEmbedding = cms.EDProducer(
+                    "PATJetIDEmbedder",
+                    src = step.getObjTag('j'),
                     )
-                step.addModule('jetSortingJERDn', jSort_jerDn, 'j_jerDown')
+                step.addModule('jetIDEmbedding', jetIDEmbedding, 'j')
+
+                if self.isMC:
+                    jetIDEmbedding_jesUp = cms.EDProducer(
+                        "PATJetIDEmbedder",
+                        src = step.getObjTag('j_jesUp'),
+                        )
+                    step.addModule('jetIDEmbeddingJESUp', jetIDEmbedding_jesUp, 'j_jesUp')
+                    jetIDEmbedding_jesDown = cms.EDProducer(
+                        "PATJetIDEmbedder",
+                        src = step.getObjTag('j_jesDown'),
+                        )
+                    step.addModule('jetIDEmbeddingJESDown', jetIDEmbedding_jesDown, 'j_jesDown')
+
+
+                    jetSmearing = cms.EDProducer(
+                        "PATJetSmearing",
+                        src = step.getObjTag('j'),
+                        rhoSrc = cms.InputTag("fixedGridRhoFastjetAll"),
+                        systematics = cms.bool(True),
+                        )
+                    step.addModule("jetSmearing", jetSmearing, 'j', 'j_jerUp',
+                                   'j_jerDown', j_jerUp='jerUp', j_jerDown='jerDown')
+
+                    jetSmearing_jesUp = jetSmearing.clone(src = step.getObjTag('j_jesUp'),
+                                                          systematics = cms.bool(False))
+                    step.addModule("jetSmearingJESUp", jetSmearing_jesUp, 'j_jesUp')
+                    jetSmearing_jesDown = jetSmearing.clone(src = step.getObjTag('j_jesDown'),
+                                                          systematics = cms.bool(False))
+                    step.addModule("jetSmearingJESDown", jetSmearing_jesDown, 'j_jesDown')
+
+                    # need to re-sort now that we're calibrated
+                    jSort_jesUp = cms.EDProducer(
+                        "PATJetCollectionSorter",
+                        src = step.getObjTag('j_jesUp'),
+                        function = cms.string('pt'),
+                        )
+                    step.addModule('jetSortingJESUp', jSort_jesUp, 'j_jesUp')
+
+                    jSort_jesDn = cms.EDProducer(
+                        "PATJetCollectionSorter",
+                        src = step.getObjTag('j_jesDown'),
+                        function = cms.string('pt'),
+                        )
+                    step.addModule('jetSortingJESDn', jSort_jesDn, 'j_jesDown')
+
+                    jSort_jerUp = cms.EDProducer(
+                        "PATJetCollectionSorter",
+                        src = step.getObjTag('j_jerUp'),
+                        function = cms.string('pt'),
+                        )
+                    step.addModule('jetSortingJERUp', jSort_jerUp, 'j_jerUp')
+
+                    jSort_jerDn = cms.EDProducer(
+                        "PATJetCollectionSorter",
+                        src = step.getObjTag('j_jerDown'),
+                        function = cms.string('pt'),
+                        )
+                    step.addModule('jetSortingJERDn', jSort_jerDn, 'j_jerDown')
 
             # need to re-sort now that we're calibrated
             jSort = cms.EDProducer(
@@ -131,20 +155,33 @@ class JetBaseFlow(AnalysisFlowBase):
             step.addModule('jetSorting', jSort, 'j')
 
         if stepName == 'preselection':
+            # The pt cut is kept separate so the loose selection for jet
+            # variations can swap it out
+            ptCut = 30.
+
             # For now, we're not using the PU ID, but we'll store it in the
             # ntuples later
-            selectionString = ('pt > 30. && abs(eta) < 4.7 && '
-                               'userFloat("idLoose") > 0.5')
+            otherCuts = ('abs(eta) < 4.7 && '
+                         'userFloat("idLoose") > 0.5')
 
             # # use medium PU ID
             # # PU IDs are stored as a userInt where the first three digits are
             # # tight, medium, and loose PUID decisions (going right to left)
-            # selectionString = ('pt>30. && abs(eta) < 4.7 && '
-            #                    'userFloat("idLoose") > 0.5 && '
-            #                    'userInt("{}") >= 6').format(step.getObjTagString('puID'))
+            # otherCuts = ('abs(eta) < 4.7 && '
+            #              'userFloat("idLoose") > 0.5 && '
+            #              'userInt("{}") >= 6').format(step.getObjTagString('puID'))
+
+            selectionString = 'pt > {} && {}'.format(ptCut, otherCuts)
+
+            if self.isMC and self.jetVariationOverlay:
+                # Loose collection of jets that pass in any variation, for
+                # cleaning; the nominal selection below is the tight one
+                looseSelection = 'userFloat("jetVariationMaxPt") > {} && {}'.format(ptCut, otherCuts)
+                step.addBasicSelector('j', looseSelection,
+                                      newCollection='variations')
 
             step.addBasicSelector('j', selectionString)
-            if self.isMC:
+            if self.isMC and not self.jetVariationOverlay:
                 step.addBasicSelector('j_jesUp', selectionString)
                 step.addBasicSelector('j_jesDown', selectionString)
                 step.addBasicSelector('j_jerUp', selectionString)
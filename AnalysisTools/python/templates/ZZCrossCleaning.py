@@ -40,7 +40,24 @@ class ZZCrossCleaning(AnalysisFlowBase):
                     },
                 )
 
-            if self.isMC:
+            if self.isMC and self.jetVariationOverlay:
+                step.addCrossSelector(
+                    'j_variations',
+                    '', # no further basic selection here
+                    e={
+                        'deltaR' : 0.4,
+                        'selection' : ('userFloat("{}Tight") > 0.5 && '
+                                       'userFloat("{}") > 0.5').format(self.getZZIDLabel(),
+                                                                       self.getZZIsoLabel()),
+                        },
+                    m={
+                        'deltaR' : 0.4,
+                        'selection' : ('userFloat("{}Tight") > 0.5 && '
+                                       'userFloat("{}") > 0.5').format(self.getZZIDLabel(),
+                                                                       self.getZZIsoLabel()),
+                        },
+                    )
+            elif self.isMC:
                 step.addCrossSelector(
                     'j_jesUp',
                     '', # no further basic selection here
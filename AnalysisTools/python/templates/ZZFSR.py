@@ -48,7 +48,10 @@ class ZZFSR(AnalysisFlowBase):
                 )
             step.addModule('jetFSRCleaner', jetFSRCleaner, 'j')
             
-            if self.isMC:
+            if self.isMC and self.jetVariationOverlay:
+                jetFSRCleaner_variations = jetFSRCleaner.clone(src = step.getObjTag('j_variations'))
+                step.addModule('jetFSRCleanerVariations', jetFSRCleaner_variations, 'j_variations')
+            elif self.isMC:
                 jetFSRCleaner_jesUp = jetFSRCleaner.clone(src = step.getObjTag('j_jesUp'))
                 step.addModule('jetFSRCleanerJESUp', jetFSRCleaner_jesUp, 'j_jesUp')
                 jetFSRCleaner_jesDown = jetFSRCleaner.clone(src = step.getObjTag('j_jesDown'))
@@ -77,4 +77,9 @@ class ZZInitialStateBaseFlow(ZPlusXBaseFlow):
                     src = step.getObjTag(chan),
                     jetSrc = step.getObjTag('j'),
                 )
+                if 'j_variations' in step.outputs:
+                    mod.jetVariationSrc = step.getObjTag('j_variations')
+                    mod.variations = cms.vstring('jesUp', 'jesDown',
+                                                 'jerUp', 'jerDown')
+                    mod.variationPtCut = cms.double(30.)
             step.addModule(chan+'CleanedJetsEmbed', mod, chan)
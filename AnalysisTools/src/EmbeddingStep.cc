@@ -0,0 +1,14 @@
+#include "UWVV/AnalysisTools/interface/EmbeddingStep.h"
+
+#include "DataFormats/PatCandidates/interface/Electron.h"
+#include "DataFormats/PatCandidates/interface/Muon.h"
+#include "DataFormats/PatCandidates/interface/Tau.h"
+#include "DataFormats/PatCandidates/interface/Jet.h"
+#include "DataFormats/PatCandidates/interface/CompositeCandidate.h"
+
+
+EDM_REGISTER_PLUGINFACTORY(uwvv::EmbeddingStepFactory<pat::Electron>, "UWVVElectronEmbeddingStepFactory");
+EDM_REGISTER_PLUGINFACTORY(uwvv::EmbeddingStepFactory<pat::Muon>, "UWVVMuonEmbeddingStepFactory");
+EDM_REGISTER_PLUGINFACTORY(uwvv::EmbeddingStepFactory<pat::Tau>, "UWVVTauEmbeddingStepFactory");
+EDM_REGISTER_PLUGINFACTORY(uwvv::EmbeddingStepFactory<pat::Jet>, "UWVVJetEmbeddingStepFactory");
+EDM_REGISTER_PLUGINFACTORY(uwvv::EmbeddingStepFactory<pat::CompositeCandidate>, "UWVVCompositeCandidateEmbeddingStepFactory");
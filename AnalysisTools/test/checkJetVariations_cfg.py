@@ -0,0 +1,59 @@
+import FWCore.ParameterSet.Config as cms
+import FWCore.ParameterSet.VarParsing as VarParsing
+
+from UWVV.AnalysisTools.analysisFlowMaker import createFlow
+
+# Quick check of jet systematics embedded as JetVariations: runs the jet
+# part of the analysis flow with jetVariationOverlay=True and makes sure
+# each jet has exactly one set of variations, and that the JES and JER
+# shifts actually move the jet pt. cmsRun throws if they don't.
+
+process = cms.Process("CHECKJETS")
+
+options = VarParsing.VarParsing('analysis')
+
+options.inputFiles = '/store/mc/RunIIFall15MiniAODv2/GluGluHToZZTo4L_M2500_13TeV_powheg2_JHUgenV6_pythia8/MINIAODSIM/PU25nsData2015v1_76X_mcRun2_asymptotic_v12-v1/60000/02C0EC1D-F3E4-E511-ADCA-AC162DA603B4.root'
+options.maxEvents = 100
+
+options.register('globalTag', "",
+                 VarParsing.VarParsing.multiplicity.singleton,
+                 VarParsing.VarParsing.varType.string,
+                 "Global tag. If empty (default), auto:run2_mc is used")
+
+options.parseArguments()
+
+process.load("Configuration.StandardSequences.GeometryRecoDB_cff")
+
+process.load("Configuration.StandardSequences.FrontierConditions_GlobalTag_cff")
+from Configuration.AlCa.GlobalTag import GlobalTag
+process.GlobalTag = GlobalTag(process.GlobalTag,
+                              options.globalTag if options.globalTag else 'auto:run2_mc')
+
+process.load("FWCore.MessageLogger.MessageLogger_cfi")
+process.schedule = cms.Schedule()
+
+process.MessageLogger.cerr.FwkReport.reportEvery = 100
+
+process.source = cms.Source(
+    "PoolSource",
+    fileNames = cms.untracked.vstring(options.inputFiles),
+    )
+
+process.maxEvents = cms.untracked.PSet(
+    input=cms.untracked.int32(options.maxEvents)
+    )
+
+from UWVV.AnalysisTools.templates.VertexCleaning import VertexCleaning
+from UWVV.AnalysisTools.templates.JetBaseFlow import JetBaseFlow
+
+FlowClass = createFlow(VertexCleaning, JetBaseFlow)
+flow = FlowClass('flow', process, isMC=True, jetVariationOverlay=True)
+
+process.jetVariationChecker = cms.EDAnalyzer(
+    "JetVariationChecker",
+    src = cms.InputTag(flow.finalTags()['j']),
+    )
+process.checkPath = cms.Path(process.jetVariationChecker)
+
+process.schedule.append(flow.getPath())
+process.schedule.append(process.checkPath)
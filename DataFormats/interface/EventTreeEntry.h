@@ -0,0 +1,28 @@
+#ifndef EventTreeEntry_h
+#define EventTreeEntry_h
+
+#include <string>
+#include <vector>
+
+// Where an EventTreeGenerator wrote one event: the entry of its tree, and
+// a hash of the event-level branches it made, so candidate trees pointing
+// at it can check they left out the same branches it holds.
+class EventTreeEntry {
+    public:
+        EventTreeEntry() : entry_(0), branchesHash_(0) {}
+        EventTreeEntry(unsigned long long entry, unsigned long long branchesHash) :
+            entry_(entry), branchesHash_(branchesHash) {}
+        ~EventTreeEntry() {}
+
+        // Same for the same branches in the same order
+        static unsigned long long hashBranches(const std::vector<std::string>& branches);
+
+        unsigned long long entry() const { return entry_; }
+        unsigned long long branchesHash() const { return branchesHash_; }
+
+    private:
+        unsigned long long entry_;
+        unsigned long long branchesHash_;
+};
+
+#endif
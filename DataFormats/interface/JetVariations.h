@@ -0,0 +1,44 @@
+#ifndef JetVariations_h
+#define JetVariations_h
+
+#include <string>
+
+#include "DataFormats/Math/interface/LorentzVector.h"
+#include "DataFormats/Candidate/interface/Candidate.h"
+
+// Systematic variations of one jet's energy scale and resolution, stored as
+// scale factors relative to the jet itself instead of as whole shifted
+// copies of the jet collection. The momentum and energy are scaled
+// separately, so variations that keep the mass fixed can be represented.
+// Embedded in jets as user data (see PATJetEnergyScaleShifter and
+// PATJetSmearing), so it follows the jets through sorting and selection.
+class JetVariations {
+    public:
+        enum Variation {JES_UP = 0, JES_DOWN, JER_UP, JER_DOWN, N_VARIATIONS, NONE = -1};
+
+        JetVariations();
+        ~JetVariations() {}
+
+        // "jesUp" -> JES_UP etc., NONE for anything else (including "")
+        static Variation variation(const std::string& name);
+        static const char* name(Variation v);
+
+        bool has(Variation v) const;
+        void set(Variation v, float momentumScale, float energyScale);
+
+        float momentumScale(Variation v) const;
+        float energyScale(Variation v) const;
+
+        // Kinematics of the nominal jet with variation v applied. If v is
+        // NONE or this variation isn't set, the nominal kinematics are
+        // returned.
+        math::XYZTLorentzVector p4(const reco::Candidate& nominal, Variation v) const;
+        float pt(const reco::Candidate& nominal, Variation v) const;
+
+    private:
+        unsigned char set_; // bit v is set if variation v is filled
+        float momentumScales_[N_VARIATIONS];
+        float energyScales_[N_VARIATIONS];
+};
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef TriggerDecisions_h
+#define TriggerDecisions_h
+
+#include <string>
+#include <vector>
+
+// Decisions and prescales for a list of trigger (or filter) groups in one
+// event, each group being an OR of paths (see TriggerDecisionProducer).
+// The pass bits are packed 64 to a word. The groups are identified only by
+// their position in the configured list, so the product carries a hash of
+// the group names for consumers to check against their own list.
+class TriggerDecisions {
+    public:
+        TriggerDecisions() : namesHash_(0) {}
+        TriggerDecisions(const std::vector<std::string>& names);
+        ~TriggerDecisions() {}
+
+        // Same for the same names in the same order
+        static unsigned long long hashNames(const std::vector<std::string>& names);
+
+        size_t size() const { return prescales_.size(); }
+        unsigned long long namesHash() const { return namesHash_; }
+
+        bool pass(size_t i) const { return (pass_[i / 64] >> (i % 64)) & 1ULL; }
+        unsigned prescale(size_t i) const { return prescales_[i]; }
+
+        void set(size_t i, bool pass, unsigned prescale);
+
+    private:
+        unsigned long long namesHash_;
+        std::vector<unsigned long long> pass_;
+        std::vector<unsigned> prescales_;
+};
+
+#endif
@@ -24,8 +24,12 @@ DressedGenParticle::DressedGenParticle(const reco::GenParticle& cand,
     const reco::GenParticleCollection assocCollection, 
     const float dRmax) :
         reco::GenParticle(cand), p4_undressed(cand.p4()) {
+    const double eta = p4_undressed.eta();
+    const double phi = p4_undressed.phi();
+    const double dR2max = double(dRmax) * dRmax;
     for (const auto& associated : assocCollection) {
-        if (reco::deltaR(cand.p4(), associated.p4()) < dRmax) {
+        const auto assocP4 = associated.p4();
+        if (reco::deltaR2(eta, phi, assocP4.eta(), assocP4.phi()) < dR2max) {
             this->setP4(this->p4() + associated.p4());
             associates.push_back(associated);
         }
@@ -0,0 +1,7 @@
+#include "UWVV/DataFormats/interface/EventTreeEntry.h"
+#include "UWVV/DataFormats/interface/TriggerDecisions.h"
+
+unsigned long long EventTreeEntry::hashBranches(const std::vector<std::string>& branches) {
+    // same hash as the trigger group names
+    return TriggerDecisions::hashNames(branches);
+}
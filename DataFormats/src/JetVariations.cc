@@ -0,0 +1,60 @@
+#include "UWVV/DataFormats/interface/JetVariations.h"
+
+namespace {
+    const char* const variationNames[JetVariations::N_VARIATIONS] = {
+        "jesUp", "jesDown", "jerUp", "jerDown",
+    };
+}
+
+JetVariations::JetVariations() : set_(0) {
+    for (int i = 0; i < N_VARIATIONS; ++i) {
+        momentumScales_[i] = 1.;
+        energyScales_[i] = 1.;
+    }
+}
+
+JetVariations::Variation JetVariations::variation(const std::string& name) {
+    for (int i = 0; i < N_VARIATIONS; ++i) {
+        if (name == variationNames[i])
+            return Variation(i);
+    }
+    return NONE;
+}
+
+const char* JetVariations::name(Variation v) {
+    if (v < 0 || v >= N_VARIATIONS)
+        return "";
+    return variationNames[v];
+}
+
+bool JetVariations::has(Variation v) const {
+    return v >= 0 && v < N_VARIATIONS && (set_ & (1 << v));
+}
+
+void JetVariations::set(Variation v, float momentumScale, float energyScale) {
+    if (v < 0 || v >= N_VARIATIONS)
+        return;
+    momentumScales_[v] = momentumScale;
+    energyScales_[v] = energyScale;
+    set_ |= (1 << v);
+}
+
+float JetVariations::momentumScale(Variation v) const {
+    return has(v) ? momentumScales_[v] : 1.;
+}
+
+float JetVariations::energyScale(Variation v) const {
+    return has(v) ? energyScales_[v] : 1.;
+}
+
+math::XYZTLorentzVector JetVariations::p4(const reco::Candidate& nominal,
+                                          Variation v) const {
+    const float p = momentumScale(v);
+    return math::XYZTLorentzVector(nominal.px() * p, nominal.py() * p,
+                                   nominal.pz() * p,
+                                   nominal.energy() * energyScale(v));
+}
+
+float JetVariations::pt(const reco::Candidate& nominal, Variation v) const {
+    return nominal.pt() * momentumScale(v);
+}
@@ -0,0 +1,27 @@
+#include "UWVV/DataFormats/interface/TriggerDecisions.h"
+
+TriggerDecisions::TriggerDecisions(const std::vector<std::string>& names) :
+    namesHash_(hashNames(names)),
+    pass_((names.size() + 63) / 64, 0ULL),
+    prescales_(names.size(), 1) {
+}
+
+unsigned long long TriggerDecisions::hashNames(const std::vector<std::string>& names) {
+    // 64-bit FNV-1a, with a null character after each name
+    unsigned long long hash = 14695981039346656037ULL;
+    for (const auto& name : names) {
+        for (size_t i = 0; i <= name.size(); ++i) {
+            hash ^= (i < name.size() ? (unsigned char)name[i] : 0);
+            hash *= 1099511628211ULL;
+        }
+    }
+    return hash;
+}
+
+void TriggerDecisions::set(size_t i, bool pass, unsigned prescale) {
+    if (pass)
+        pass_[i / 64] |= (1ULL << (i % 64));
+    else
+        pass_[i / 64] &= ~(1ULL << (i % 64));
+    prescales_[i] = prescale;
+}
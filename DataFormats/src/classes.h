@@ -1,5 +1,8 @@
 #include "UWVV/DataFormats/interface/DressedGenParticleFwd.h"
 #include "UWVV/DataFormats/interface/DressedGenParticle.h"
+#include "UWVV/DataFormats/interface/JetVariations.h"
+#include "UWVV/DataFormats/interface/TriggerDecisions.h"
+#include "UWVV/DataFormats/interface/EventTreeEntry.h"
 
 #include "DataFormats/PatCandidates/interface/Jet.h"
 
@@ -17,5 +20,14 @@ namespace {
 
         edm::PtrVector<pat::Jet> dummyPtrVectorPatJet;
         pat::UserHolder<edm::PtrVector<pat::Jet>> dummyPtrUserHolderPtrVectorPatJet; 
+
+        JetVariations dummyJetVariations;
+        pat::UserHolder<JetVariations> dummyUserHolderJetVariations;
+
+        TriggerDecisions dummyTriggerDecisions;
+        edm::Wrapper<TriggerDecisions> dummyWrapperTriggerDecisions;
+
+        EventTreeEntry dummyEventTreeEntry;
+        edm::Wrapper<EventTreeEntry> dummyWrapperEventTreeEntry;
     };
 }
@@ -7,6 +7,7 @@
 #include <functional>
 #include <vector>
 #include <memory>
+#include <algorithm>
 
 // ROOT
 #include "TTree.h"
@@ -14,75 +15,143 @@
 
 // CMSSW
 #include "DataFormats/Common/interface/Ptr.h"
+#include "FWCore/Utilities/interface/Exception.h"
 
 // UWVV
 #include "UWVV/Ntuplizer/interface/EventInfo.h"
+#include "UWVV/Ntuplizer/interface/FunctionLibrary.h"
 
 
 namespace uwvv
 {
 
-  // Container to fill an ntuple branch (of type B) with values computed by a
-  // function specified either by a 
-  // std::function<B(const edm::Ptr<T>&, EventInfo&)>
+  // Container to fill all the ntuple branches of type B for one object.
+  // The values live in one contiguous block, and each branch is registered
+  // with the tree by the address of its slot. Branch i is filled with the
+  // value of function i.
+  //
+  // Usage: add() all the branches, then setup() once to allocate the block
+  // and register the branches. Nothing may be added after that.
+  //
+  // If the holder is cacheable and the event's branch cache is enabled, the
+  // values for each object (identified by its master Ptr) are computed once
+  // per event and copied for later candidates containing the same object.
   template<typename B, class T> class BranchHolder
   {
    public:
 
-    // Declare FType to be the type of the function pointer used here
-    typedef B (FType)(const edm::Ptr<T>&, EventInfo&);
-
-    // Default constuctor (null)
-    BranchHolder() {;}
-    // Construct with function passed as argument
-    BranchHolder(const std::string& name, TTree* const tree, 
-                 const std::function<FType> func);
-    BranchHolder(const std::string& name, TTree* const tree, 
-                 FType func);
+    BranchHolder(bool cacheable = false);
     virtual ~BranchHolder() {;}
 
-    // Compute value for this and set so that the next tree->Fill() will take it
+    void add(const std::string& name, const BranchFunction<B,T>& func);
+
+    void setup(TTree* const tree);
+
+    // Compute all values and set them so the next tree->Fill() will take them
     void fill(const edm::Ptr<T>& obj, EventInfo& evt);
 
-    const std::string& getName() const {return name;}
+    size_t size() const {return functions.size();}
 
-    const B& getValue() const {return value;}
+    const std::string& getName(size_t i) const {return names.at(i);}
 
-   private:
-    const std::string name;
-    const std::function<FType> f;
+    const B& getValue(size_t i) const {return values[i];}
 
-    B value;
+   private:
+    std::vector<std::string> names;
+    std::vector<BranchFunction<B,T> > functions;
+    std::unique_ptr<B[]> values;
+
+    bool isSetUp;
+    const bool cacheable;
+
+    // Values already computed this event, size() values per object. There
+    // are only ever a handful of distinct objects per event, so a linear
+    // search over the keys is fine
+    std::vector<edm::Ptr<T> > cacheKeys;
+    std::vector<B> cacheValues;
+    unsigned long long cacheGeneration;
   };
 
 
 
 
   template<typename B, class T>
-  BranchHolder<B,T>::BranchHolder(const std::string& name, TTree* const tree, 
-                                  BranchHolder<B, T>::FType func) :
-    name(name),
-    f(func)
+  BranchHolder<B,T>::BranchHolder(bool cacheable) :
+    isSetUp(false),
+    cacheable(cacheable),
+    cacheGeneration(0)
+  {
+  }
+
+
+  template<typename B, class T>
+  void
+  BranchHolder<B,T>::add(const std::string& name,
+                         const BranchFunction<B,T>& func)
   {
-    tree->Branch(name.c_str(), &value);
+    if(isSetUp)
+      throw cms::Exception("InvalidBranch")
+        << "Attempt to add branch " << name << " after branches were "
+        << "registered with the tree." << std::endl;
+
+    names.push_back(name);
+    functions.push_back(func);
   }
 
 
   template<typename B, class T>
-  BranchHolder<B,T>::BranchHolder(const std::string& name, TTree* const tree, 
-                                  const std::function<BranchHolder<B, T>::FType> func) :
-    name(name),
-    f(func)
+  void
+  BranchHolder<B,T>::setup(TTree* const tree)
   {
-    tree->Branch(name.c_str(), &value);
+    values.reset(new B[size()]());
+
+    for(size_t i = 0; i < size(); ++i)
+      tree->Branch(names[i].c_str(), &values[i]);
+
+    isSetUp = true;
   }
 
 
-  template<typename B, class T> 
+  template<typename B, class T>
   void
   BranchHolder<B,T>::fill(const edm::Ptr<T>& obj, EventInfo& evt)
   {
-    value = f(obj, evt);
+    const size_t n = size();
+
+    if(!(cacheable && evt.branchCache().enabled()))
+      {
+        for(size_t i = 0; i < n; ++i)
+          functions[i](obj, evt, values[i]);
+        return;
+      }
+
+    BranchCacheInfo& cacheInfo = evt.branchCache();
+
+    if(cacheGeneration != cacheInfo.generation())
+      {
+        cacheKeys.clear();
+        cacheValues.clear();
+        cacheGeneration = cacheInfo.generation();
+      }
+
+    for(size_t iKey = 0; iKey < cacheKeys.size(); ++iKey)
+      {
+        if(cacheKeys[iKey] == obj)
+          {
+            std::copy(cacheValues.begin() + iKey * n,
+                      cacheValues.begin() + (iKey + 1) * n,
+                      values.get());
+            cacheInfo.hit(n);
+            return;
+          }
+      }
+
+    for(size_t i = 0; i < n; ++i)
+      functions[i](obj, evt, values[i]);
+    cacheInfo.miss(n);
+
+    cacheKeys.push_back(obj);
+    cacheValues.insert(cacheValues.end(), values.get(), values.get() + n);
   }
 
 } // namespace
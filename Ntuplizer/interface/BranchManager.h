@@ -31,12 +31,27 @@ namespace uwvv
   template<class Obj1, class Obj2> struct CompositeDaughter {};
 
 
+  // What a BranchManager does with the top-level branches made only with
+  // event-level library functions (see FunctionRegistry::eventLevel)
+  enum class EventLevelBranches
+  {
+    keep, // make them like any other branch
+    skip, // leave them out, because they go in an event-level tree
+    only, // make only them, for the event-level tree itself
+  };
+
+
   template<class T> class BranchManager
   {
    public:
     BranchManager() {;}
+    // If cacheable is true, branch values are memoized per event for each
+    // object (when the event's branch cache is enabled). This is only useful
+    // for daughters, which may be shared by several candidates. Daughters
+    // always keep their event-level branches.
     BranchManager(const std::string& name, TTree* const tree,
-                  const edm::ParameterSet& config);
+                  const edm::ParameterSet& config, bool cacheable = false,
+                  EventLevelBranches eventLevel = EventLevelBranches::keep);
     virtual ~BranchManager(){;}
 
     void fill(const reco::Candidate* const obj, EventInfo& evt);
@@ -44,29 +59,41 @@ namespace uwvv
 
     const std::string& getName() const {return name;}
 
+    // The event-level branches made or left out (unless they're kept with
+    // the rest), as "name=function", in a fixed order
+    const std::vector<std::string>& getEventLevelBranches() const {return eventLevelBranches;}
+
    protected:
     edm::Ptr<T> extractMasterPtr(const reco::Candidate* const);
 
    private:
+    bool makesBranch(const std::string& branch, const std::string& function,
+                     bool isEventLevel);
+
     template<typename B> void
-      addBranchesFromPSet(std::vector<std::unique_ptr<BranchHolder<B, T> > >& addTo,
+      addBranchesFromPSet(BranchHolder<B, T>& addTo,
                           const edm::ParameterSet& toAdd,
                           TTree* const tree);
     template<typename B> void
-      addVectorBranchesFromPSet(std::vector<std::unique_ptr<BranchHolder<std::vector<B>, T> > >& addTo,
+      addVectorBranchesFromPSet(BranchHolder<std::vector<B>, T>& addTo,
                                 const edm::ParameterSet& toAdd,
                                 TTree* const tree);
 
     const std::string name;
 
-    std::vector<std::unique_ptr<BranchHolder<float, T> > >                  floatBranches;
-    std::vector<std::unique_ptr<BranchHolder<bool, T> > >                   boolBranches;
-    std::vector<std::unique_ptr<BranchHolder<int, T> > >                    intBranches;
-    std::vector<std::unique_ptr<BranchHolder<unsigned, T> > >               uintBranches;
-    std::vector<std::unique_ptr<BranchHolder<unsigned long long, T> > >     ullBranches;
-    std::vector<std::unique_ptr<BranchHolder<std::vector<float>, T> > >     vFloatBranches;
-    std::vector<std::unique_ptr<BranchHolder<std::vector<int>, T> > >       vIntBranches;
-    std::vector<std::unique_ptr<BranchHolder<std::vector<unsigned>, T> > >  vUIntBranches;
+    const EventLevelBranches eventLevel;
+    std::vector<std::string> eventLevelBranches;
+
+    // One contiguous block of values per branch type
+    BranchHolder<float, T>                  floatBranches;
+    BranchHolder<bool, T>                   boolBranches;
+    BranchHolder<int, T>                    intBranches;
+    BranchHolder<unsigned, T>               uintBranches;
+    BranchHolder<unsigned long long, T>     ullBranches;
+    BranchHolder<std::vector<float>, T>     vFloatBranches;
+    BranchHolder<std::vector<int>, T>       vIntBranches;
+    BranchHolder<std::vector<unsigned>, T>  vUIntBranches;
+    BranchHolder<std::vector<unsigned short>, T> vUShortBranches;
   };
 
 
@@ -78,7 +105,8 @@ namespace uwvv
    public:
     BranchManager() {;}
     BranchManager(const std::string& name, TTree* const tree,
-                  const edm::ParameterSet& config);
+                  const edm::ParameterSet& config, bool cacheable = false,
+                  EventLevelBranches eventLevel = EventLevelBranches::keep);
     virtual ~BranchManager() {;}
 
     void fill(const reco::Candidate* const obj, EventInfo& evt);
@@ -101,8 +129,20 @@ namespace uwvv
 
   template<class T>
   BranchManager<T>::BranchManager(const std::string& name, TTree* const tree,
-                                  const edm::ParameterSet& config) :
-    name(name)
+                                  const edm::ParameterSet& config,
+                                  bool cacheable,
+                                  EventLevelBranches eventLevel) :
+    name(name),
+    eventLevel(eventLevel),
+    floatBranches(cacheable),
+    boolBranches(cacheable),
+    intBranches(cacheable),
+    uintBranches(cacheable),
+    ullBranches(cacheable),
+    vFloatBranches(cacheable),
+    vIntBranches(cacheable),
+    vUIntBranches(cacheable),
+    vUShortBranches(cacheable)
   {
     if(config.exists("floats"))
       addBranchesFromPSet(floatBranches,
@@ -143,36 +183,73 @@ namespace uwvv
       addVectorBranchesFromPSet(vUIntBranches,
                                 config.getParameter<edm::ParameterSet>("vUInts"),
                                 tree);
+
+    if(config.exists("vUShorts"))
+      addVectorBranchesFromPSet(vUShortBranches,
+                                config.getParameter<edm::ParameterSet>("vUShorts"),
+                                tree);
   }
 
 
   template<class T>
   template<typename B> void
-  BranchManager<T>::addBranchesFromPSet(std::vector<std::unique_ptr<BranchHolder<B, T> > >& addTo,
+  BranchManager<T>::addBranchesFromPSet(BranchHolder<B, T>& addTo,
                                         const edm::ParameterSet& toAdd,
                                         TTree* const tree)
   {
     FunctionLibrary<B,T> fLib = FunctionLibrary<B,T>();
 
     for(const auto& b : toAdd.getParameterNames())
-      addTo.push_back(std::unique_ptr<BranchHolder<B, T> >(new BranchHolder<B, T>(getName()+b,
-                                                                                  tree,
-                                                                                  fLib.getFunction(toAdd.getParameter<std::string>(b)))));
+      {
+        const std::string f = toAdd.getParameter<std::string>(b);
+        if(makesBranch(getName()+b, f, fLib.isEventLevel(f)))
+          addTo.add(getName()+b, fLib.getFunction(f));
+      }
+
+    addTo.setup(tree);
   }
 
 
   template<class T>
   template<typename B> void
-  BranchManager<T>::addVectorBranchesFromPSet(std::vector<std::unique_ptr<BranchHolder<std::vector<B>, T> > >& addTo,
+  BranchManager<T>::addVectorBranchesFromPSet(BranchHolder<std::vector<B>, T>& addTo,
                                         const edm::ParameterSet& toAdd,
                                         TTree* const tree)
   {
     FunctionLibrary<std::vector<B>,T> fLib = FunctionLibrary<std::vector<B>,T>();
 
     for(const auto& b : toAdd.getParameterNames())
-      addTo.push_back(std::unique_ptr<BranchHolder<std::vector<B>, T> >(new BranchHolder<std::vector<B>, T>(getName()+b,
-                                                                                                            tree,
-                                                                                                            fLib.getFunction(toAdd.getParameter<std::vector<std::string> >(b)))));
+      {
+        const std::vector<std::string> fs = toAdd.getParameter<std::vector<std::string> >(b);
+        std::string joined;
+        for(const auto& f : fs)
+          joined += (joined.empty() ? "" : ",") + f;
+
+        if(!makesBranch(getName()+b, joined, fLib.isEventLevel(fs)))
+          continue;
+
+        addTo.add(getName()+b, fLib.getFunction(fs));
+
+        if(fs.size() == 1)
+          addBranchUserInfo(tree, getName()+b, fs.at(0));
+      }
+
+    addTo.setup(tree);
+  }
+
+
+  template<class T> bool
+  BranchManager<T>::makesBranch(const std::string& branch,
+                                const std::string& function,
+                                bool isEventLevel)
+  {
+    if(eventLevel == EventLevelBranches::keep)
+      return true;
+
+    if(isEventLevel)
+      eventLevelBranches.push_back(branch + "=" + function);
+
+    return isEventLevel == (eventLevel == EventLevelBranches::only);
   }
 
 
@@ -189,29 +266,15 @@ namespace uwvv
   template<class T> void
   BranchManager<T>::fill(const edm::Ptr<T>& obj, EventInfo& evt)
   {
-    for(auto&& b : floatBranches)
-      b->fill(obj, evt);
-
-    for(auto&& b : boolBranches)
-      b->fill(obj, evt);
-
-    for(auto&& b : intBranches)
-      b->fill(obj, evt);
-
-    for(auto&& b : uintBranches)
-      b->fill(obj, evt);
-
-    for(auto&& b : ullBranches)
-      b->fill(obj, evt);
-
-    for(auto&& b : vFloatBranches)
-      b->fill(obj, evt);
-
-    for(auto&& b : vIntBranches)
-      b->fill(obj, evt);
-
-    for(auto&& b : vUIntBranches)
-      b->fill(obj, evt);
+    floatBranches.fill(obj, evt);
+    boolBranches.fill(obj, evt);
+    intBranches.fill(obj, evt);
+    uintBranches.fill(obj, evt);
+    ullBranches.fill(obj, evt);
+    vFloatBranches.fill(obj, evt);
+    vIntBranches.fill(obj, evt);
+    vUIntBranches.fill(obj, evt);
+    vUShortBranches.fill(obj, evt);
   }
 
 
@@ -230,8 +293,10 @@ namespace uwvv
   template<class T1, class T2>
   BranchManager<CompositeDaughter<T1, T2> >::BranchManager(const std::string& name,
                                                            TTree* const tree,
-                                                           const edm::ParameterSet& config) :
-    BranchManager<pat::CompositeCandidate>(name, tree, config),
+                                                           const edm::ParameterSet& config,
+                                                           bool cacheable,
+                                                           EventLevelBranches eventLevel) :
+    BranchManager<pat::CompositeCandidate>(name, tree, config, cacheable, eventLevel),
     daughterName1(extractDaughterName(0,
                                       config.getParameter<std::vector<std::string> >("daughterNames"))),
     daughterName2(extractDaughterName(1,
@@ -245,14 +310,17 @@ namespace uwvv
         << "You must provide two sets of daughter parameters for a composite "
         << "candidate with two daughters." << std::endl;
 
+    // Daughters may be shared between candidates, so they can be cached
     daughterBranches1 =
       std::unique_ptr<BranchManager<T1> >(new BranchManager<T1>(daughterName1,
                                                                 tree,
-                                                                daughterParams.at(0)));
+                                                                daughterParams.at(0),
+                                                                true));
     daughterBranches2 =
       std::unique_ptr<BranchManager<T2> >(new BranchManager<T2>(daughterName2,
                                                                 tree,
-                                                                daughterParams.at(1)));
+                                                                daughterParams.at(1),
+                                                                true));
   }
 
 
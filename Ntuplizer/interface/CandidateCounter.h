@@ -0,0 +1,48 @@
+#ifndef UWVV_Ntuplizer_CandidateCounter_h
+#define UWVV_Ntuplizer_CandidateCounter_h
+
+// STL
+#include <string>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+
+
+namespace uwvv
+{
+
+  // Number of candidates a TreeGenerator looked at, and how many of them
+  // were rejected by its preselection
+  struct CandidateCounts
+  {
+    CandidateCounts() :
+      evaluated(0),
+      rejected(0)
+        {;}
+
+    std::atomic<unsigned long long> evaluated;
+    std::atomic<unsigned long long> rejected;
+  };
+
+
+  // Process-wide registry of candidate counts, keyed to the label of the
+  // module doing the counting, so the MetaTreeGenerator can store them in
+  // the metaInfo tree
+  class CandidateCounter
+  {
+   public:
+    // Get the counts for this label, creating them if needed
+    static std::shared_ptr<CandidateCounts> get(const std::string& label);
+
+    // All counts registered so far
+    static std::map<std::string, std::shared_ptr<CandidateCounts> > all();
+
+   private:
+    static std::mutex mutex_;
+    static std::map<std::string, std::shared_ptr<CandidateCounts> > counts_;
+  };
+
+} // namespace
+
+#endif // header guard
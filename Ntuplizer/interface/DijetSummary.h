@@ -0,0 +1,50 @@
+#ifndef UWVV_Ntuplizer_DijetSummary_h
+#define UWVV_Ntuplizer_DijetSummary_h
+
+
+// STL
+#include <string>
+#include <vector>
+
+// CMSSW
+#include "DataFormats/Math/interface/LorentzVector.h"
+#include "DataFormats/PatCandidates/interface/CompositeCandidate.h"
+
+
+namespace uwvv
+{
+
+  // Everything the jet branches need from the jets cleaned against an
+  // initial state (see helpers::getCleanedJetCollection) for one variation
+  // ("" for the nominal jets, "jesUp", "jerDown", etc.). Built once and
+  // read by all the jet branches.
+  struct DijetSummary
+  {
+    DijetSummary(const pat::CompositeCandidate& cand, const std::string& variation);
+
+    size_t nJets;
+
+    // The leading two jets and the dijet system, only meaningful if there
+    // are at least 2 jets (j3Rapidity needs 3)
+    math::XYZTLorentzVector j1P4;
+    math::XYZTLorentzVector j2P4;
+    math::XYZTLorentzVector dijetP4;
+    double j1Rapidity;
+    double j2Rapidity;
+    double j3Rapidity;
+
+    // Per-jet quantities, in the order of the cleaned collection
+    std::vector<float> pt;
+    std::vector<float> eta;
+    std::vector<float> phi;
+    std::vector<float> rapidity;
+    std::vector<float> qgLikelihood; // only jets that have it
+    std::vector<float> csvV2;
+    std::vector<float> cmvaV2;
+    std::vector<int> hadronFlavor;
+    std::vector<int> puID;
+  };
+
+} // namespace
+
+#endif // header guard
@@ -23,6 +23,13 @@
 #include "SimDataFormats/GeneratorProducts/interface/LHEEventProduct.h"
 #include "DataFormats/JetReco/interface/GenJet.h"
 #include "DataFormats/HepMCCandidate/interface/GenParticle.h"
+#include "DataFormats/Candidate/interface/Candidate.h"
+#include "UWVV/Ntuplizer/interface/DijetSummary.h"
+
+#include <map>
+#include <vector>
+#include <string>
+#include <utility>
 
 
 
@@ -85,6 +92,66 @@ namespace uwvv
   };
 
 
+  // Bookkeeping for memoized object-level branches. The values themselves
+  // live in the branches (see BranchHolder); this tells them when a new event
+  // has started, so everything they cached before is stale, and keeps
+  // statistics.
+  class BranchCacheInfo
+  {
+   public:
+    BranchCacheInfo() :
+      enabled_(false),
+      generation_(0),
+      hits_(0),
+      misses_(0)
+        {;}
+    ~BranchCacheInfo() {;}
+
+    void enable(bool enabled = true) {enabled_ = enabled;}
+    bool enabled() const {return enabled_;}
+
+    void newEvent() {++generation_;}
+    unsigned long long generation() const {return generation_;}
+
+    void hit(unsigned long long n = 1) {hits_ += n;}
+    void miss(unsigned long long n = 1) {misses_ += n;}
+    unsigned long long hits() const {return hits_;}
+    unsigned long long misses() const {return misses_;}
+
+   private:
+    bool enabled_;
+    unsigned long long generation_;
+    unsigned long long hits_;
+    unsigned long long misses_;
+  };
+
+
+  // One range [first, last) of an event's LHE weights, with everything the
+  // branches want from it, gathered in one pass over the weights. The
+  // vector's storage is reused from event to event.
+  struct LHEWeightSummary
+  {
+    LHEWeightSummary() :
+      nominal(1.),
+      min(999.),
+      max(-999.),
+      sum(0.),
+      generation(0)
+        {;}
+
+    std::vector<float> weights;
+    // the event's nominal weight (XWGTUP)
+    float nominal;
+    // min and max leave out scale weights 5 and 7, which don't count
+    float min;
+    float max;
+    double sum;
+
+    // event (see BranchCacheInfo) the summary was made for
+    unsigned long long generation;
+  };
+
+
   class EventInfo
   {
    public:
@@ -134,6 +201,23 @@ namespace uwvv
     const edm::Handle<edm::View<pat::CompositeCandidate> >& genInitialStates() {return genInitialStates_.get();}
     const edm::Handle<edm::View<pat::CompositeCandidate> >& genInitialStates(const std::string& collection) {return genInitialStates_.get(collection);}
 
+    // Gen jets from the given collection that don't overlap any final
+    // daughter of cand (deltaR < 0.4). The cleaning is done once per event
+    // for each candidate and collection, and shared by everything asking.
+    const std::vector<const reco::GenJet*>& cleanedGenJets(const reco::Candidate& cand,
+                                                           const std::string& collection = "");
+
+    // Summary of the jets cleaned against cand for one variation ("" for
+    // nominal), built once per event for each candidate and variation
+    const DijetSummary& dijetSummary(const pat::CompositeCandidate& cand,
+                                     const std::string& variation = "");
+
+    // Summary of LHE weights [first, last), built once per event for each
+    // range
+    const LHEWeightSummary& lheWeights(unsigned long first, unsigned long last);
+
+    BranchCacheInfo& branchCache() {return branchCache_;}
+
 
    private:
     const edm::Event* currentEvent_;
@@ -152,6 +236,17 @@ namespace uwvv
     EventInfoHolder<edm::View<reco::GenParticle> > genParticles_;
     EventInfoHolder<edm::View<pat::CompositeCandidate> > initialStates_;
     EventInfoHolder<edm::View<pat::CompositeCandidate> > genInitialStates_;
+
+    // keyed to the address of the candidate, which is fine within one event
+    std::map<std::pair<const reco::Candidate*, std::string>,
+             std::vector<const reco::GenJet*> > cleanedGenJets_;
+    std::map<std::pair<const pat::CompositeCandidate*, std::string>,
+             DijetSummary> dijetSummaries_;
+    // not cleared between events, so the weight vectors keep their storage
+    std::map<std::pair<unsigned long, unsigned long>,
+             LHEWeightSummary> lheWeightSummaries_;
+
+    BranchCacheInfo branchCache_;
   };
 
 } // namespace
@@ -2,14 +2,20 @@
 #define UWVV_Ntuplizer_FunctionLibrary_h
 
 
-#include <functional>
+#include <memory>
 #include <unordered_map>
+#include <unordered_set>
 #include <string>
 #include <vector>
+#include <cstdlib>
+#include <cctype>
+#include <cmath>
 
 #include "UWVV/Ntuplizer/interface/EventInfo.h"
 #include "UWVV/Ntuplizer/interface/StringFunctionMaker.h"
+#include "UWVV/Ntuplizer/interface/UserDataFunctionMaker.h"
 #include "UWVV/Utilities/interface/helpers.h"
+#include "UWVV/Utilities/interface/LHEWeightEncoding.h"
 #include "UWVV/DataFormats/interface/DressedGenParticle.h"
 
 #include "DataFormats/PatCandidates/interface/Electron.h"
@@ -20,6 +26,182 @@
 #include "DataFormats/Math/interface/LorentzVector.h"
 #include "DataFormats/JetReco/interface/GenJet.h"
 
+#include "TTree.h"
+#include "TParameter.h"
+
+
+namespace uwvv
+{
+
+  // Everything a branch function gets besides the object and the event.
+  // For library functions, that's the part after the '::' in
+  // "functionName::option", read once when the branch is built, so
+  // functions never have to parse the string while filling. Functions that
+  // aren't in the library (string functions, user data lookups, vectors of
+  // functions) keep what they need in the state.
+  struct FunctionOption
+  {
+    FunctionOption(const std::string& label = "") :
+      label(label),
+      first(0),
+      // Arbitrary choice, but 1000 weights would be pretty excessive
+      last(1000),
+      precision(0.)
+    {;}
+
+    // Read the label as an index range: "last" (starting at 0),
+    // "first,last", or "first,last,precision", with nothing else in it.
+    // An empty label keeps the default range. Returns false if the label
+    // isn't a range.
+    bool parseRange()
+    {
+      if(label.empty())
+        return true;
+
+      const size_t pos = label.find(",");
+      if(pos == std::string::npos)
+        return parseIndex(label, last);
+
+      const size_t pos2 = label.find(",", pos+1);
+      if(!(parseIndex(label.substr(0, pos), first) &&
+           parseIndex(label.substr(pos+1, pos2 - (pos+1)), last) &&
+           first <= last))
+        return false;
+
+      if(pos2 == std::string::npos)
+        return true;
+
+      const std::string p = label.substr(pos2+1);
+      char* end = 0;
+      precision = std::strtod(p.c_str(), &end);
+      return (!p.empty() && !std::isspace(p[0]) && *end == '\0' &&
+              std::isfinite(precision));
+    }
+
+    // Most functions use the option as a collection or variation label
+    operator const std::string&() const {return label;}
+
+    template<class S> const S& state() const {return *static_cast<const S*>(stateData.get());}
+
+    std::string label;
+
+    // Index range [first, last), for the functions in needsRangeOption
+    unsigned long first;
+    unsigned long last;
+    // Optional third number, for encodings with a precision (0 if not given)
+    double precision;
+
+    std::shared_ptr<const void> stateData;
+
+   private:
+    // Plain decimal digits only, so signs, spaces, and trailing junk are
+    // errors. Anything over 9 digits is far more weights than any sample
+    // has.
+    static bool parseIndex(const std::string& s, unsigned long& out)
+    {
+      if(s.empty() || s.size() > 9 ||
+         s.find_first_not_of("0123456789") != std::string::npos)
+        return false;
+
+      out = std::stoul(s);
+      return true;
+    }
+  };
+
+  // Library functions whose option has to be an index range, so a bad one
+  // is caught when the branch is built
+  inline bool needsRangeOption(const std::string& fname)
+  {
+    return (fname == "lheWeights" || fname == "minLHEWeight" ||
+            fname == "maxLHEWeight" || fname == "sumLHEWeight" ||
+            fname == "lheWeightsHalf" || fname == "lheWeightsFixed");
+  }
+
+  // Put anything a reader needs to decode branch b, made with library
+  // function string f ("functionName::option"), into the tree's user info.
+  // So far that's only the precision of fixed point LHE weights, as a
+  // TParameter<double> called [b]Precision.
+  inline void addBranchUserInfo(TTree* const tree, const std::string& b,
+                                const std::string& f)
+  {
+    size_t sepStart = f.find("::");
+    if(f.substr(0, sepStart) != "lheWeightsFixed" || sepStart == std::string::npos)
+      return;
+
+    FunctionOption parsed(f.substr(sepStart+2));
+    parsed.parseRange();
+    tree->GetUserInfo()->Add(new TParameter<double>((b+"Precision").c_str(),
+                                                    parsed.precision));
+  }
+
+  // Library functions are stored as plain function pointers (they are all
+  // captureless lambdas), so a fill is a single direct call. Functions for
+  // vector branches write into the branch's vector instead of returning a
+  // new one, so its memory is reused from one fill to the next.
+  template<typename B, class T>
+  struct LibraryFunctionType
+  {
+    typedef B (*type) (const edm::Ptr<T>&, EventInfo&, const FunctionOption&);
+
+    static void call(type f, const edm::Ptr<T>& obj, EventInfo& evt,
+                     const FunctionOption& option, B& out)
+    {
+      out = f(obj, evt, option);
+    }
+  };
+
+  template<typename B, class T>
+  struct LibraryFunctionType<std::vector<B>, T>
+  {
+    typedef void (*type) (const edm::Ptr<T>&, EventInfo&, const FunctionOption&,
+                          std::vector<B>&);
+
+    static void call(type f, const edm::Ptr<T>& obj, EventInfo& evt,
+                     const FunctionOption& option, std::vector<B>& out)
+    {
+      f(obj, evt, option, out);
+    }
+  };
+
+  template<typename B, class T> using LibraryFunction =
+    typename LibraryFunctionType<B,T>::type;
+
+  // Library functions by name. Functions registered with eventLevel() look
+  // only at the event, never at the candidate, so their branches can go in
+  // an event-level tree (see EventTreeGenerator), where they are called
+  // without a candidate.
+  template<typename B, class T>
+  class FunctionRegistry
+  {
+   public:
+    typedef typename std::unordered_map<std::string, LibraryFunction<B,T> >::const_iterator const_iterator;
+
+    LibraryFunction<B,T>& operator[](const std::string& name)
+    {
+      return functions[name];
+    }
+
+    LibraryFunction<B,T>& eventLevel(const std::string& name)
+    {
+      eventLevelNames.insert(name);
+      return functions[name];
+    }
+
+    const_iterator find(const std::string& name) const {return functions.find(name);}
+    const_iterator end() const {return functions.end();}
+
+    bool isEventLevel(const std::string& name) const
+    {
+      return eventLevelNames.count(name);
+    }
+
+   private:
+    std::unordered_map<std::string, LibraryFunction<B,T> > functions;
+    std::unordered_set<std::string> eventLevelNames;
+  };
+
+} // namespace uwvv
+
 
 namespace
 {
@@ -30,126 +212,85 @@ namespace
     {
       // Null version for types we don't specify anything
       template<class T> static void
-      addFunctions(std::unordered_map<std::string, std::function<B(const edm::Ptr<T>&,uwvv::EventInfo&,const std::string&)> >& addTo) {;}
+      addFunctions(uwvv::FunctionRegistry<B,T>& addTo) {;}
     };
 
   template<>
     struct GeneralFunctionList<std::vector<float> >
     {
       template<class T> static void
-      addFunctions(std::unordered_map<std::string, std::function<std::vector<float>(const edm::Ptr<T>&, uwvv::EventInfo&, const std::string&)> >& addTo)
+      addFunctions(uwvv::FunctionRegistry<std::vector<float>,T>& addTo)
       {
-        typedef std::vector<float> (FType) (const edm::Ptr<T>&, uwvv::EventInfo&, const std::string&);
+        typedef std::vector<float> B;
 
         addTo["genJetPt"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 std::vector<float> out;
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option, B& out)
+          {
+            out.clear();
+            for(const reco::GenJet* j : evt.cleanedGenJets(*obj, option))
+              out.push_back(j->pt());
+          };
 
-                                 for(size_t i = 0; i < evt.genJets(option)->size(); ++i)
-                                   {
-                                     if(!uwvv::helpers::overlapWithAnyDaughter(evt.genJets(option)->at(i), *obj, 0.4))
-                                       out.push_back(evt.genJets(option)->at(i).pt());
-                                   }
+        addTo["genJetEta"] =
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option, B& out)
+          {
+            out.clear();
+            for(const reco::GenJet* j : evt.cleanedGenJets(*obj, option))
+              out.push_back(j->eta());
+          };
 
-                                 return out;
-                               });
+        addTo["genJetPhi"] =
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option, B& out)
+          {
+            out.clear();
+            for(const reco::GenJet* j : evt.cleanedGenJets(*obj, option))
+              out.push_back(j->phi());
+          };
 
-        addTo["genJetEta"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 std::vector<float> out;
+        addTo["genJetRapidity"] =
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option, B& out)
+          {
+            out.clear();
+            for(const reco::GenJet* j : evt.cleanedGenJets(*obj, option))
+              out.push_back(j->rapidity());
+          };
 
-                                 for(size_t i = 0; i < evt.genJets(option)->size(); ++i)
-                                   {
-                                     if(!uwvv::helpers::overlapWithAnyDaughter(evt.genJets(option)->at(i), *obj, 0.4))
-                                       out.push_back(evt.genJets(option)->at(i).eta());
-                                   }
+        addTo.eventLevel("lheWeights") =
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option, B& out)
+          {
+            const std::vector<float>& weights = evt.lheWeights(option.first, option.last).weights;
+            out.assign(weights.begin(), weights.end());
+          };
+      }
+    };
 
-                                 return out;
-                               });
+  template<>
+    struct GeneralFunctionList<std::vector<unsigned short> >
+    {
+      template<class T> static void
+      addFunctions(uwvv::FunctionRegistry<std::vector<unsigned short>,T>& addTo)
+      {
+        typedef std::vector<unsigned short> B;
 
-        addTo["genJetPhi"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 std::vector<float> out;
+        // LHE weights relative to lheNominalWeight (absolute if that is
+        // zero), compressed to 16 bits each (see
+        // Utilities/interface/LHEWeightEncoding.h to decode)
+        addTo.eventLevel("lheWeightsHalf") =
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option, B& out)
+          {
+            const uwvv::LHEWeightSummary& lhe = evt.lheWeights(option.first, option.last);
 
-                                 for(size_t i = 0; i < evt.genJets(option)->size(); ++i)
-                                   {
-                                     if(!uwvv::helpers::overlapWithAnyDaughter(evt.genJets(option)->at(i), *obj, 0.4))
-                                       out.push_back(evt.genJets(option)->at(i).phi());
-                                   }
+            uwvv::lheWeightEncoding::encodeHalf(lhe.weights, lhe.nominal, out);
+          };
 
-                                 return out;
-                               });
+        addTo.eventLevel("lheWeightsFixed") =
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option, B& out)
+          {
+            const uwvv::LHEWeightSummary& lhe = evt.lheWeights(option.first, option.last);
 
-        addTo["genJetRapidity"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 std::vector<float> out;
-
-                                 for(size_t i = 0; i < evt.genJets(option)->size(); ++i)
-                                   {
-                                     if(!uwvv::helpers::overlapWithAnyDaughter(evt.genJets(option)->at(i), *obj, 0.4))
-                                       out.push_back(evt.genJets(option)->at(i).rapidity());
-                                   }
-
-                                 return out;
-                               });
-
-        addTo["lheWeights"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                  std::vector<float> out;
-
-                                  if (!evt.lheEventInfo().isValid())
-                                    throw cms::Exception("ProductNotFound")
-                                        << "Unable to open LHE event information";
-
-                                  unsigned long first_weight = 0;
-                                  // Arbitrary choice, but 1000 weights would be pretty excessive
-                                  unsigned long last_weight = 1000;
-                                  if (option != "")
-                                    {
-                                      size_t pos = option.find(",");
-                                      // If only 1 weight is specified, take it as the last weight (start at 0)
-                                      if (pos == std::string::npos)
-                                        try
-                                          {
-                                            last_weight = std::stoul(option);
-                                          }
-                                        catch (const std::exception& e)
-                                          {
-                                            std::string message = "Unable to parse option " + option +
-                                                " for LHE weights. Error from ";
-                                            throw std::runtime_error(message + e.what());
-                                          }
-                                      else
-                                        {
-                                          std::string begin = option.substr(0, pos);
-                                          std::string end = option.substr(pos+1);
-                                          try
-                                            {
-                                              first_weight = std::stoul(begin);
-                                              last_weight = std::stoul(end);
-                                            }
-                                          catch (const std::exception& e)
-                                            {
-                                              std::string message = "Unable to parse option " + option +
-                                                  " for LHE weights. Error from ";
-                                              throw std::runtime_error(message + e.what());
-                                            }
-                                        }
-                                    }
-                                  auto weights = evt.lheEventInfo()->weights();
-                                  for (unsigned long i = first_weight; i <  weights.size(); i++)
-                                    {
-                                      if (i == last_weight)
-                                        break;
-                                      out.push_back(weights[i].wgt);
-                                    }
-                                  return out;
-                                });
+            uwvv::lheWeightEncoding::encodeFixed(lhe.weights, lhe.nominal,
+                                                 option.precision, out);
+          };
       }
     };
 
@@ -157,443 +298,248 @@ namespace
     struct GeneralFunctionList<float>
     {
       template<class T> static void
-      addFunctions(std::unordered_map<std::string, std::function<float(const edm::Ptr<T>&, uwvv::EventInfo&, const std::string&)> >& addTo)
+      addFunctions(uwvv::FunctionRegistry<float,T>& addTo)
       {
-        typedef float (FType) (const edm::Ptr<T>&, uwvv::EventInfo&, const std::string&);
-
-        addTo["pvZ"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 return (evt.pv().isNonnull() ? evt.pv()->z() : -999.);
-                               });
-
-        addTo["pvndof"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 return (evt.pv().isNonnull() ? evt.pv()->ndof() : -999.);
-                               });
-
-        addTo["pvRho"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 return (evt.pv().isNonnull() ? evt.pv()->position().Rho() : -999.);
-                               });
-
-        addTo["nTruePU"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {return (evt.puInfo().isValid() && evt.puInfo()->size() > 0 ?
-                                        evt.puInfo()->at(1).getTrueNumInteractions() :
-                                        -1.);});
-
-        addTo["type1_pfMETEt"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {return evt.met(option).pt();});
-        addTo["type1_pfMETPhi"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {return evt.met(option).phi();});
-
-        addTo["type1_pfMETEt_jesUp"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {return evt.met(option).shiftedP4(pat::MET::JetEnUp).pt();});
-        addTo["type1_pfMETPhi_jesUp"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {return evt.met(option).shiftedP4(pat::MET::JetEnUp).phi();});
-
-        addTo["type1_pfMETEt_jesDown"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {return evt.met(option).shiftedP4(pat::MET::JetEnDown).pt();});
-        addTo["type1_pfMETPhi_jesDown"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {return evt.met(option).shiftedP4(pat::MET::JetEnDown).phi();});
-
-        addTo["type1_pfMETEt_jerUp"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {return evt.met(option).shiftedP4(pat::MET::JetResUp).pt();});
-        addTo["type1_pfMETPhi_jerUp"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {return evt.met(option).shiftedP4(pat::MET::JetResUp).phi();});
-
-        addTo["type1_pfMETEt_jerDown"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {return evt.met(option).shiftedP4(pat::MET::JetResDown).pt();});
-        addTo["type1_pfMETPhi_jerDown"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {return evt.met(option).shiftedP4(pat::MET::JetResDown).phi();});
-
-        addTo["type1_pfMETEt_unclusteredEnUp"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {return evt.met(option).shiftedP4(pat::MET::UnclusteredEnUp).pt();});
-        addTo["type1_pfMETPhi_unclusteredEnUp"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {return evt.met(option).shiftedP4(pat::MET::UnclusteredEnUp).phi();});
-
-        addTo["type1_pfMETEt_unclusteredEnDown"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {return evt.met(option).shiftedP4(pat::MET::UnclusteredEnDown).pt();});
-        addTo["type1_pfMETPhi_unclusteredEnDown"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {return evt.met(option).shiftedP4(pat::MET::UnclusteredEnDown).phi();});
-
-        addTo["uncorrected_pfMETEt"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {return evt.met(option).corP4(pat::MET::Raw).pt();});
-        addTo["uncorrected_pfMETPhi"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {return evt.met(option).corP4(pat::MET::Raw).phi();});
-
-        addTo["genWeight"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 return (evt.genEventInfo().isValid() ? evt.genEventInfo()->weight() : 0.);
-                               });
+        typedef float B;
+
+        addTo.eventLevel("pvZ") =
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            return (evt.pv().isNonnull() ? evt.pv()->z() : -999.);
+          };
+
+        addTo.eventLevel("pvndof") =
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            return (evt.pv().isNonnull() ? evt.pv()->ndof() : -999.);
+          };
+
+        addTo.eventLevel("pvRho") =
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            return (evt.pv().isNonnull() ? evt.pv()->position().Rho() : -999.);
+          };
+
+        addTo.eventLevel("nTruePU") =
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {return (evt.puInfo().isValid() && evt.puInfo()->size() > 0 ?
+                   evt.puInfo()->at(1).getTrueNumInteractions() :
+                   -1.);};
+
+        addTo.eventLevel("type1_pfMETEt") =
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {return evt.met(option).pt();};
+        addTo.eventLevel("type1_pfMETPhi") =
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {return evt.met(option).phi();};
+
+        addTo.eventLevel("type1_pfMETEt_jesUp") =
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {return evt.met(option).shiftedP4(pat::MET::JetEnUp).pt();};
+        addTo.eventLevel("type1_pfMETPhi_jesUp") =
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {return evt.met(option).shiftedP4(pat::MET::JetEnUp).phi();};
+
+        addTo.eventLevel("type1_pfMETEt_jesDown") =
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {return evt.met(option).shiftedP4(pat::MET::JetEnDown).pt();};
+        addTo.eventLevel("type1_pfMETPhi_jesDown") =
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {return evt.met(option).shiftedP4(pat::MET::JetEnDown).phi();};
+
+        addTo.eventLevel("type1_pfMETEt_jerUp") =
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {return evt.met(option).shiftedP4(pat::MET::JetResUp).pt();};
+        addTo.eventLevel("type1_pfMETPhi_jerUp") =
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {return evt.met(option).shiftedP4(pat::MET::JetResUp).phi();};
+
+        addTo.eventLevel("type1_pfMETEt_jerDown") =
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {return evt.met(option).shiftedP4(pat::MET::JetResDown).pt();};
+        addTo.eventLevel("type1_pfMETPhi_jerDown") =
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {return evt.met(option).shiftedP4(pat::MET::JetResDown).phi();};
+
+        addTo.eventLevel("type1_pfMETEt_unclusteredEnUp") =
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {return evt.met(option).shiftedP4(pat::MET::UnclusteredEnUp).pt();};
+        addTo.eventLevel("type1_pfMETPhi_unclusteredEnUp") =
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {return evt.met(option).shiftedP4(pat::MET::UnclusteredEnUp).phi();};
+
+        addTo.eventLevel("type1_pfMETEt_unclusteredEnDown") =
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {return evt.met(option).shiftedP4(pat::MET::UnclusteredEnDown).pt();};
+        addTo.eventLevel("type1_pfMETPhi_unclusteredEnDown") =
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {return evt.met(option).shiftedP4(pat::MET::UnclusteredEnDown).phi();};
+
+        addTo.eventLevel("uncorrected_pfMETEt") =
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {return evt.met(option).corP4(pat::MET::Raw).pt();};
+        addTo.eventLevel("uncorrected_pfMETPhi") =
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {return evt.met(option).corP4(pat::MET::Raw).phi();};
+
+        addTo.eventLevel("genWeight") =
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            return (evt.genEventInfo().isValid() ? evt.genEventInfo()->weight() : 0.);
+          };
 
         addTo["mtToMET"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 float totalEt = obj->et() + evt.met().et();
-                                 float totalPt = (obj->p4() + evt.met().p4()).pt();
-                                 float mtSqr = totalEt * totalEt - totalPt * totalPt;
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            float totalEt = obj->et() + evt.met().et();
+            float totalPt = (obj->p4() + evt.met().p4()).pt();
+            float mtSqr = totalEt * totalEt - totalPt * totalPt;
 
-                                 return std::sqrt(mtSqr);
-                               });
+            return std::sqrt(mtSqr);
+          };
 
         addTo["mjjGen"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 if(evt.genJets(option)->size() < 2)
-                                   return -999.;
-
-                                 const reco::GenJet* j1 = 0;
-                                 for(size_t i = 0; i < evt.genJets(option)->size(); ++i)
-                                   {
-                                     const reco::GenJet& j = evt.genJets(option)->at(i);
-                                     if(!uwvv::helpers::overlapWithAnyDaughter(j, *obj, 0.4))
-                                       {
-                                         if(j1)
-                                           return (j1->p4()+j.p4()).mass();
-                                         else
-                                           j1 = &j;
-                                       }
-                                   }
-
-                                 return -999.;
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            const std::vector<const reco::GenJet*>& jets = evt.cleanedGenJets(*obj, option);
+            if(jets.size() < 2)
+              return -999.;
+
+            return (jets[0]->p4() + jets[1]->p4()).mass();
+          };
 
         addTo["ptjjGen"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 if(evt.genJets(option)->size() < 2)
-                                   return -999.;
-
-                                 const reco::GenJet* j1 = 0;
-                                 for(size_t i = 0; i < evt.genJets(option)->size(); ++i)
-                                   {
-                                     const reco::GenJet& j = evt.genJets(option)->at(i);
-                                     if(!uwvv::helpers::overlapWithAnyDaughter(j, *obj, 0.4))
-                                       {
-                                         if(j1)
-                                           return (j1->p4()+j.p4()).pt();
-                                         else
-                                           j1 = &j;
-                                       }
-                                   }
-
-                                 return -999.;
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            const std::vector<const reco::GenJet*>& jets = evt.cleanedGenJets(*obj, option);
+            if(jets.size() < 2)
+              return -999.;
+
+            return (jets[0]->p4() + jets[1]->p4()).pt();
+          };
 
         addTo["etajjGen"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 if(evt.genJets(option)->size() < 2)
-                                   return -999.;
-
-                                 const reco::GenJet* j1 = 0;
-                                 for(size_t i = 0; i < evt.genJets(option)->size(); ++i)
-                                   {
-                                     const reco::GenJet& j = evt.genJets(option)->at(i);
-                                     if(!uwvv::helpers::overlapWithAnyDaughter(j, *obj, 0.4))
-                                       {
-                                         if(j1)
-                                           return (j1->p4()+j.p4()).eta();
-                                         else
-                                           j1 = &j;
-                                       }
-                                   }
-
-                                 return -999.;
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            const std::vector<const reco::GenJet*>& jets = evt.cleanedGenJets(*obj, option);
+            if(jets.size() < 2)
+              return -999.;
+
+            return (jets[0]->p4() + jets[1]->p4()).eta();
+          };
 
         addTo["phijjGen"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 if(evt.genJets(option)->size() < 2)
-                                   return -999.;
-
-                                 const reco::GenJet* j1 = 0;
-                                 for(size_t i = 0; i < evt.genJets(option)->size(); ++i)
-                                   {
-                                     const reco::GenJet& j = evt.genJets(option)->at(i);
-                                     if(!uwvv::helpers::overlapWithAnyDaughter(j, *obj, 0.4))
-                                       {
-                                         if(j1)
-                                           return (j1->p4()+j.p4()).phi();
-                                         else
-                                           j1 = &j;
-                                       }
-                                   }
-
-                                 return -999.;
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            const std::vector<const reco::GenJet*>& jets = evt.cleanedGenJets(*obj, option);
+            if(jets.size() < 2)
+              return -999.;
+
+            return (jets[0]->p4() + jets[1]->p4()).phi();
+          };
 
         addTo["deltaEtajjGen"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 if(evt.genJets(option)->size() < 2)
-                                   return -999.;
-
-                                 const reco::GenJet* j1 = 0;
-                                 for(size_t i = 0; i < evt.genJets(option)->size(); ++i)
-                                   {
-                                     const reco::GenJet& j = evt.genJets(option)->at(i);
-                                     if(!uwvv::helpers::overlapWithAnyDaughter(j, *obj, 0.4))
-                                       {
-                                         if(j1)
-                                           return std::abs(j1->eta() - j.eta());
-                                         else
-                                           j1 = &j;
-                                       }
-                                   }
-
-                                 return -999.;
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            const std::vector<const reco::GenJet*>& jets = evt.cleanedGenJets(*obj, option);
+            if(jets.size() < 2)
+              return -999.;
+
+            return std::abs(jets[0]->eta() - jets[1]->eta());
+          };
 
         addTo["zeppenfeldGen"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 if(evt.genJets(option)->size() < 2)
-                                   return -999.;
-
-                                 const reco::GenJet* j1 = 0;
-                                 for(size_t i = 0; i < evt.genJets(option)->size(); ++i)
-                                   {
-                                     const reco::GenJet& j = evt.genJets(option)->at(i);
-                                     if(!uwvv::helpers::overlapWithAnyDaughter(j, *obj, 0.4))
-                                       {
-                                         if(j1)
-                                           return std::abs(obj->rapidity() -
-                                                           (j1->rapidity() +
-                                                            j.rapidity()) / 2.
-                                                           );
-                                         else
-                                           j1 = &j;
-                                       }
-                                   }
-
-                                 return -999.;
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            const std::vector<const reco::GenJet*>& jets = evt.cleanedGenJets(*obj, option);
+            if(jets.size() < 2)
+              return -999.;
+
+            return std::abs(obj->rapidity() -
+                            (jets[0]->rapidity() +
+                             jets[1]->rapidity()) / 2.
+                            );
+          };
 
         addTo["zeppenfeldj3Gen"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 if(evt.genJets(option)->size() < 3)
-                                   return -999.;
-
-                                 const reco::GenJet* j1 = 0;
-                                 const reco::GenJet* j2 = 0;
-                                 for(size_t i = 0; i < evt.genJets(option)->size(); ++i)
-                                   {
-                                     const reco::GenJet& j = evt.genJets(option)->at(i);
-                                     if(!uwvv::helpers::overlapWithAnyDaughter(j, *obj, 0.4))
-                                       {
-                                         if(j2)
-                                           return std::abs(j.rapidity() -
-                                                           (j1->rapidity() +
-                                                            j2->rapidity()) / 2.
-                                                           );
-                                         else if(j1)
-                                           j2 = &j;
-                                         else
-                                           j1 = &j;
-                                       }
-                                   }
-
-                                 return -999.;
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            const std::vector<const reco::GenJet*>& jets = evt.cleanedGenJets(*obj, option);
+            if(jets.size() < 3)
+              return -999.;
+
+            return std::abs(jets[2]->rapidity() -
+                            (jets[0]->rapidity() +
+                             jets[1]->rapidity()) / 2.
+                            );
+          };
 
         addTo["deltaPhiTojjGen"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 if(evt.genJets(option)->size() < 2)
-                                   return -999.;
-
-                                 const reco::GenJet* j1 = 0;
-                                 for(size_t i = 0; i < evt.genJets(option)->size(); ++i)
-                                   {
-                                     const reco::GenJet& j = evt.genJets(option)->at(i);
-                                     if(!uwvv::helpers::overlapWithAnyDaughter(j, *obj, 0.4))
-                                       {
-                                         if(j1)
-                                           {
-                                             float phiJJ = (j1->p4() + j.p4()).phi();
-                                             return std::abs(deltaPhi(obj->phi(), phiJJ));
-                                           }
-                                         else
-                                           j1 = &j;
-                                       }
-                                   }
-
-                                 return -999.;
-                               });
-
-        addTo["minLHEWeight"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                  if (!evt.lheEventInfo().isValid())
-                                    throw cms::Exception("ProductNotFound")
-                                        << "Unable to open LHE event information";
-
-                                  unsigned long first_weight = 0;
-                                  // Arbitrary choice, but 1000 weights would be pretty excessive
-                                  unsigned long last_weight = 1000;
-                                  if (option != "")
-                                    {
-                                      size_t pos = option.find(",");
-                                      // If only 1 weight is specified, take it as the last weight (start at 0)
-                                      if (pos == std::string::npos)
-                                        try
-                                          {
-                                            last_weight = std::stoul(option);
-                                          }
-                                        catch (const std::exception& e)
-                                          {
-                                            std::string message = "Unable to parse option " + option +
-                                                " for LHE weights. Error from ";
-                                            throw std::runtime_error(message + e.what());
-                                          }
-                                      else
-                                        {
-                                          std::string begin = option.substr(0, pos);
-                                          std::string end = option.substr(pos+1);
-                                          try
-                                            {
-                                              first_weight = std::stoul(begin);
-                                              last_weight = std::stoul(end);
-                                            }
-                                          catch (const std::exception& e)
-                                            {
-                                              std::string message = "Unable to parse option " + option +
-                                                  " for LHE weights. Error from ";
-                                              throw std::runtime_error(message + e.what());
-                                            }
-                                        }
-                                    }
-
-                                  float minWeight = 999.;
-
-                                  auto weights = evt.lheEventInfo()->weights();
-                                  for (unsigned long i = first_weight; i <  weights.size(); i++)
-                                    {
-                                      if (i == last_weight)
-                                        break;
-                                      if(i == 5 || i == 7) // some scale weights don't count, apparently
-                                        continue;
-                                      if(weights[i].wgt < minWeight)
-                                        minWeight = weights[i].wgt;
-                                    }
-
-                                  return minWeight;
-                                });
-
-        addTo["maxLHEWeight"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                  if (!evt.lheEventInfo().isValid())
-                                    throw cms::Exception("ProductNotFound")
-                                        << "Unable to open LHE event information";
-
-                                  unsigned long first_weight = 0;
-                                  // Arbitrary choice, but 1000 weights would be pretty excessive
-                                  unsigned long last_weight = 1000;
-                                  if (option != "")
-                                    {
-                                      size_t pos = option.find(",");
-                                      // If only 1 weight is specified, take it as the last weight (start at 0)
-                                      if (pos == std::string::npos)
-                                        try
-                                          {
-                                            last_weight = std::stoul(option);
-                                          }
-                                        catch (const std::exception& e)
-                                          {
-                                            std::string message = "Unable to parse option " + option +
-                                                " for LHE weights. Error from ";
-                                            throw std::runtime_error(message + e.what());
-                                          }
-                                      else
-                                        {
-                                          std::string begin = option.substr(0, pos);
-                                          std::string end = option.substr(pos+1);
-                                          try
-                                            {
-                                              first_weight = std::stoul(begin);
-                                              last_weight = std::stoul(end);
-                                            }
-                                          catch (const std::exception& e)
-                                            {
-                                              std::string message = "Unable to parse option " + option +
-                                                  " for LHE weights. Error from ";
-                                              throw std::runtime_error(message + e.what());
-                                            }
-                                        }
-                                    }
-
-                                  float maxWeight = -999.;
-
-                                  auto weights = evt.lheEventInfo()->weights();
-                                  for (unsigned long i = first_weight; i <  weights.size(); i++)
-                                    {
-                                      if (i == last_weight)
-                                        break;
-                                      if(i == 5 || i == 7) // some scale weights don't count, apparently
-                                        continue;
-                                      if(weights[i].wgt > maxWeight)
-                                        maxWeight = weights[i].wgt;
-                                    }
-
-                                  return maxWeight;
-                                });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            const std::vector<const reco::GenJet*>& jets = evt.cleanedGenJets(*obj, option);
+            if(jets.size() < 2)
+              return -999.;
+
+            float phiJJ = (jets[0]->p4() + jets[1]->p4()).phi();
+            return std::abs(deltaPhi(obj->phi(), phiJJ));
+          };
+
+        addTo.eventLevel("minLHEWeight") =
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            return evt.lheWeights(option.first, option.last).min;
+          };
+
+        addTo.eventLevel("maxLHEWeight") =
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            return evt.lheWeights(option.first, option.last).max;
+          };
+
+        addTo.eventLevel("lheNominalWeight") =
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            return evt.lheWeights(0, 0).nominal;
+          };
+
+        addTo.eventLevel("sumLHEWeight") =
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            return evt.lheWeights(option.first, option.last).sum;
+          };
 
         addTo["genInitialStateMass"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 if(evt.initialStates()->size())
-                                   return evt.initialStates()->at(0).mass();
-                                 return -999.;
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            if(evt.initialStates()->size())
+              return evt.initialStates()->at(0).mass();
+            return -999.;
+          };
 
         addTo["genInitialStatePt"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 if(evt.initialStates()->size())
-                                   return evt.initialStates()->at(0).pt();
-                                 return -999.;
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            if(evt.initialStates()->size())
+              return evt.initialStates()->at(0).pt();
+            return -999.;
+          };
 
         addTo["genInitialStateEta"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 if(evt.initialStates()->size())
-                                   return evt.initialStates()->at(0).eta();
-                                 return -999.;
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            if(evt.initialStates()->size())
+              return evt.initialStates()->at(0).eta();
+            return -999.;
+          };
 
         addTo["genInitialStatePhi"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 if(evt.initialStates()->size())
-                                   return evt.initialStates()->at(0).phi();
-                                 return -999.;
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            if(evt.initialStates()->size())
+              return evt.initialStates()->at(0).phi();
+            return -999.;
+          };
       }
     };
 
@@ -601,21 +547,21 @@ namespace
     struct GeneralFunctionList<bool>
     {
       template<class T> static void
-      addFunctions(std::unordered_map<std::string, std::function<bool(const edm::Ptr<T>&, uwvv::EventInfo&, const std::string&)> >& addTo)
+      addFunctions(uwvv::FunctionRegistry<bool,T>& addTo)
       {
-        typedef bool (FType) (const edm::Ptr<T>&, uwvv::EventInfo&, const std::string&);
-
-        addTo["pvIsValid"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 return evt.pv().isNonnull() && evt.pv()->isValid();
-                               });
-
-        addTo["pvIsFake"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 return evt.pv().isNull() || evt.pv()->isFake();
-                               });
+        typedef bool B;
+
+        addTo.eventLevel("pvIsValid") =
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            return evt.pv().isNonnull() && evt.pv()->isValid();
+          };
+
+        addTo.eventLevel("pvIsFake") =
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            return evt.pv().isNull() || evt.pv()->isFake();
+          };
       }
     };
 
@@ -623,15 +569,15 @@ namespace
     struct GeneralFunctionList<int>
     {
       template<class T> static void
-      addFunctions(std::unordered_map<std::string, std::function<int(const edm::Ptr<T>&, uwvv::EventInfo&, const std::string&)> >& addTo)
+      addFunctions(uwvv::FunctionRegistry<int,T>& addTo)
       {
-        typedef int (FType) (const edm::Ptr<T>&, uwvv::EventInfo&, const std::string&);
+        typedef int B;
 
         addTo["Charge"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option) {return obj->charge();});
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B {return obj->charge();};
 
         addTo["PdgId"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option) {return obj->pdgId();});
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B {return obj->pdgId();};
       }
     };
 
@@ -639,34 +585,27 @@ namespace
     struct GeneralFunctionList<unsigned>
     {
       template<class T> static void
-      addFunctions(std::unordered_map<std::string, std::function<unsigned(const edm::Ptr<T>&, uwvv::EventInfo&, const std::string&)> >& addTo)
+      addFunctions(uwvv::FunctionRegistry<unsigned,T>& addTo)
       {
-        typedef unsigned (FType) (const edm::Ptr<T>&, uwvv::EventInfo&, const std::string&);
+        typedef unsigned B;
 
-        addTo["lumi"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {return evt.id().luminosityBlock();});
+        addTo.eventLevel("lumi") =
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {return evt.id().luminosityBlock();};
 
-        addTo["run"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {return evt.id().run();});
+        addTo.eventLevel("run") =
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {return evt.id().run();};
 
-        addTo["nvtx"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {return evt.nVertices();});
+        addTo.eventLevel("nvtx") =
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {return evt.nVertices();};
 
         addTo["nGenJets"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 unsigned out = 0;
-                                 for(size_t i = 0; i < evt.genJets(option)->size(); ++i)
-                                   {
-                                     if(!uwvv::helpers::overlapWithAnyDaughter(evt.genJets(option)->at(i), *obj, 0.4))
-                                       out++;
-                                   }
-
-                                 return out;
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            return evt.cleanedGenJets(*obj, option).size();
+          };
       }
     };
 
@@ -674,13 +613,13 @@ namespace
     struct GeneralFunctionList<unsigned long long>
     {
       template<class T> static void
-      addFunctions(std::unordered_map<std::string, std::function<unsigned long long(const edm::Ptr<T>&, uwvv::EventInfo&, const std::string&)> >& addTo)
+      addFunctions(uwvv::FunctionRegistry<unsigned long long,T>& addTo)
       {
-        typedef unsigned long long (FType) (const edm::Ptr<T>&, uwvv::EventInfo&, const std::string&);
+        typedef unsigned long long B;
 
-        addTo["evt"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {return evt.id().event();});
+        addTo.eventLevel("evt") =
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {return evt.id().event();};
       }
     };
 
@@ -692,8 +631,7 @@ namespace
   template<typename B, class T>
     struct ObjectFunctionList
     {
-      typedef B (FType) (const edm::Ptr<T>&, uwvv::EventInfo&, const std::string&);
-      static void addFunctions(std::unordered_map<std::string, std::function<FType> >& addTo) {;}
+      static void addFunctions(uwvv::FunctionRegistry<B,T>& addTo) {;}
     };
 
   template<>
@@ -702,16 +640,15 @@ namespace
       // cheating with typedefs for standardization
       typedef pat::Electron T;
       typedef unsigned B;
-      typedef B (FType) (const edm::Ptr<T>&, uwvv::EventInfo&, const std::string&);
 
       static void
-        addFunctions(std::unordered_map<std::string, std::function<FType> >& addTo)
+        addFunctions(uwvv::FunctionRegistry<B,T>& addTo)
       {
         addTo["MissingHits"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 return obj->gsfTrack()->hitPattern().numberOfHits(reco::HitPattern::MISSING_INNER_HITS);
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            return obj->gsfTrack()->hitPattern().numberOfHits(reco::HitPattern::MISSING_INNER_HITS);
+          };
       }
     };
 
@@ -721,58 +658,57 @@ namespace
       // cheating with typedefs for standardization
       typedef pat::Electron T;
       typedef float B;
-      typedef B (FType) (const edm::Ptr<T>&, uwvv::EventInfo&, const std::string&);
 
       static void
-        addFunctions(std::unordered_map<std::string, std::function<FType> >& addTo)
+        addFunctions(uwvv::FunctionRegistry<B,T>& addTo)
       {
         addTo["SIP3D"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 return fabs(obj->dB(T::PV3D)) / obj->edB(T::PV3D);
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            return fabs(obj->dB(T::PV3D)) / obj->edB(T::PV3D);
+          };
 
         addTo["IP3D"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 return fabs(obj->dB(T::PV3D));
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            return fabs(obj->dB(T::PV3D));
+          };
 
         addTo["IP3DUncertainty"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 return obj->edB(T::PV3D);
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            return obj->edB(T::PV3D);
+          };
 
         addTo["SIP2D"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 return fabs(obj->dB(T::PV2D)) / obj->edB(T::PV2D);
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            return fabs(obj->dB(T::PV2D)) / obj->edB(T::PV2D);
+          };
 
         addTo["IP2D"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 return fabs(obj->dB(T::PV2D));
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            return fabs(obj->dB(T::PV2D));
+          };
 
         addTo["IP2DUncertainty"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 return obj->edB(T::PV2D);
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            return obj->edB(T::PV2D);
+          };
 
         addTo["PVDZ"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 return obj->gsfTrack()->dz(evt.pv()->position());
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            return obj->gsfTrack()->dz(evt.pv()->position());
+          };
 
         addTo["PVDXY"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 return obj->gsfTrack()->dxy(evt.pv()->position());
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            return obj->gsfTrack()->dxy(evt.pv()->position());
+          };
       }
     };
 
@@ -782,58 +718,57 @@ namespace
       // cheating with typedefs for standardization
       typedef pat::Muon T;
       typedef float B;
-      typedef B (FType) (const edm::Ptr<T>&, uwvv::EventInfo&, const std::string&);
 
       static void
-        addFunctions(std::unordered_map<std::string, std::function<FType> >& addTo)
+        addFunctions(uwvv::FunctionRegistry<B,T>& addTo)
       {
         addTo["SIP3D"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 return fabs(obj->dB(T::PV3D)) / obj->edB(T::PV3D);
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            return fabs(obj->dB(T::PV3D)) / obj->edB(T::PV3D);
+          };
 
         addTo["IP3D"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 return fabs(obj->dB(T::PV3D));
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            return fabs(obj->dB(T::PV3D));
+          };
 
         addTo["IP3DUncertainty"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 return obj->edB(T::PV3D);
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            return obj->edB(T::PV3D);
+          };
 
         addTo["SIP2D"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 return fabs(obj->dB(T::PV2D)) / obj->edB(T::PV2D);
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            return fabs(obj->dB(T::PV2D)) / obj->edB(T::PV2D);
+          };
 
         addTo["IP2D"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 return fabs(obj->dB(T::PV2D));
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            return fabs(obj->dB(T::PV2D));
+          };
 
         addTo["IP2DUncertainty"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 return obj->edB(T::PV2D);
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            return obj->edB(T::PV2D);
+          };
 
         addTo["PVDZ"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 return obj->muonBestTrack()->dz(evt.pv()->position());
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            return obj->muonBestTrack()->dz(evt.pv()->position());
+          };
 
         addTo["PVDXY"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 return obj->muonBestTrack()->dxy(evt.pv()->position());
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            return obj->muonBestTrack()->dxy(evt.pv()->position());
+          };
       }
     };
 
@@ -843,16 +778,15 @@ namespace
       // cheating with typedefs for standardization
       typedef pat::Muon T;
       typedef unsigned B;
-      typedef B (FType) (const edm::Ptr<T>&, uwvv::EventInfo&, const std::string&);
 
       static void
-        addFunctions(std::unordered_map<std::string, std::function<FType> >& addTo)
+        addFunctions(uwvv::FunctionRegistry<B,T>& addTo)
       {
         addTo["BestTrackType"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option){return obj->muonBestTrackType();});
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B {return obj->muonBestTrackType();};
 
         addTo["MatchedStations"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option){return obj->numberOfMatchedStations();});
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B {return obj->numberOfMatchedStations();};
       }
     };
 
@@ -886,16 +820,15 @@ namespace
       // cheating with typedefs for standardization
       typedef pat::CompositeCandidate T;
       typedef unsigned int B;
-      typedef B (FType) (const edm::Ptr<T>&, uwvv::EventInfo&, const std::string&);
 
       static void
-        addFunctions(std::unordered_map<std::string, std::function<FType> >& addTo)
+        addFunctions(uwvv::FunctionRegistry<B,T>& addTo)
       {
         addTo["nJets"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                   return uwvv::helpers::getCleanedJetCollection(*obj, option)->size();
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            return evt.dijetSummary(*obj, option).nJets;
+          };
       }
     };
 
@@ -905,158 +838,152 @@ namespace
       // cheating with typedefs for standardization
       typedef pat::CompositeCandidate T;
       typedef float B;
-      typedef B (FType) (const edm::Ptr<T>&, uwvv::EventInfo&, const std::string&);
 
       static void
-        addFunctions(std::unordered_map<std::string, std::function<FType> >& addTo)
+        addFunctions(uwvv::FunctionRegistry<B,T>& addTo)
       {
         addTo["mjj"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 const edm::PtrVector<pat::Jet>* cleanedJets = uwvv::helpers::getCleanedJetCollection(*obj, option);
-                                 if(cleanedJets->size() < 2)
-                                   return -999.;
-                                    
-                                 return ((*cleanedJets)[0]->p4() + (*cleanedJets)[1]->p4()).mass();
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            const uwvv::DijetSummary& jets = evt.dijetSummary(*obj, option);
+            if(jets.nJets < 2)
+              return -999.;
+
+            return jets.dijetP4.mass();
+          };
         addTo["ptjj"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 const edm::PtrVector<pat::Jet>* cleanedJets = uwvv::helpers::getCleanedJetCollection(*obj, option);
-                                 if(cleanedJets->size() < 2)
-                                   return -999.;
-                                    
-                                 return ((*cleanedJets)[0]->p4() + (*cleanedJets)[1]->p4()).pt();
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            const uwvv::DijetSummary& jets = evt.dijetSummary(*obj, option);
+            if(jets.nJets < 2)
+              return -999.;
+
+            return jets.dijetP4.pt();
+          };
 
         addTo["etajj"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 const edm::PtrVector<pat::Jet>* cleanedJets = uwvv::helpers::getCleanedJetCollection(*obj, option);
-                                 if(cleanedJets->size() < 2)
-                                   return -999.;
-                                    
-                                 return ((*cleanedJets)[0]->p4() + (*cleanedJets)[1]->p4()).eta();
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            const uwvv::DijetSummary& jets = evt.dijetSummary(*obj, option);
+            if(jets.nJets < 2)
+              return -999.;
+
+            return jets.dijetP4.eta();
+          };
 
         addTo["phijj"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 const edm::PtrVector<pat::Jet>* cleanedJets = uwvv::helpers::getCleanedJetCollection(*obj, option);
-                                 if(cleanedJets->size() < 2)
-                                   return -999.;
-                                    
-                                 return ((*cleanedJets)[0]->p4() + (*cleanedJets)[1]->p4()).phi();
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            const uwvv::DijetSummary& jets = evt.dijetSummary(*obj, option);
+            if(jets.nJets < 2)
+              return -999.;
+
+            return jets.dijetP4.phi();
+          };
 
         addTo["deltaEtajj"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 const edm::PtrVector<pat::Jet>* cleanedJets = uwvv::helpers::getCleanedJetCollection(*obj, option);
-                                 if(cleanedJets->size() < 2)
-                                   return -999.;
-                                    
-                                 return std::abs((*cleanedJets)[0]->eta() - (*cleanedJets)[1]->eta());
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            const uwvv::DijetSummary& jets = evt.dijetSummary(*obj, option);
+            if(jets.nJets < 2)
+              return -999.;
+
+            return std::abs(jets.j1P4.eta() - jets.j2P4.eta());
+          };
 
         addTo["zeppenfeld"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 const edm::PtrVector<pat::Jet>* cleanedJets = uwvv::helpers::getCleanedJetCollection(*obj, option);
-                                 if(cleanedJets->size() < 2)
-                                   return -999.;
-                                    
-                                 return std::abs(obj->rapidity() -
-                                                           ((*cleanedJets)[0]->rapidity() +
-                                                            (*cleanedJets)[1]->rapidity()) / 2.
-                                                           );
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            const uwvv::DijetSummary& jets = evt.dijetSummary(*obj, option);
+            if(jets.nJets < 2)
+              return -999.;
+
+            return std::abs(obj->rapidity() -
+                            (jets.j1Rapidity + jets.j2Rapidity) / 2.);
+          };
 
         addTo["zeppenfeldj3"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 const edm::PtrVector<pat::Jet>* cleanedJets = uwvv::helpers::getCleanedJetCollection(*obj, option);
-                                 if(cleanedJets->size() < 3)
-                                   return -999.;
-                                    
-                                 return std::abs((*cleanedJets)[2]->rapidity() -
-                                                           ((*cleanedJets)[0]->rapidity() +
-                                                            (*cleanedJets)[1]->rapidity()) / 2.
-                                                           );
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            const uwvv::DijetSummary& jets = evt.dijetSummary(*obj, option);
+            if(jets.nJets < 3)
+              return -999.;
+
+            return std::abs(jets.j3Rapidity -
+                            (jets.j1Rapidity + jets.j2Rapidity) / 2.);
+          };
 
         addTo["deltaPhiTojj"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 const edm::PtrVector<pat::Jet>* cleanedJets = uwvv::helpers::getCleanedJetCollection(*obj, option);
-                                 if(cleanedJets->size() < 2)
-                                   return -999.;
-                                    
-                                 float phiJJ = ((*cleanedJets)[0]->p4() + (*cleanedJets)[1]->p4()).phi();
-                                 return std::abs(deltaPhi(obj->phi(), phiJJ));
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            const uwvv::DijetSummary& jets = evt.dijetSummary(*obj, option);
+            if(jets.nJets < 2)
+              return -999.;
+
+            return std::abs(deltaPhi(obj->phi(), jets.dijetP4.phi()));
+          };
 
 
         addTo["DR"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 return reco::deltaR(obj->daughter(0)->p4(),
-                                                     obj->daughter(1)->p4());
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            return reco::deltaR(obj->daughter(0)->p4(),
+                                obj->daughter(1)->p4());
+          };
 
         addTo["massNoFSR"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 return uwvv::helpers::p4WithoutFSR(obj).mass();
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            return uwvv::helpers::p4WithoutFSR(obj).mass();
+          };
 
         addTo["ptNoFSR"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 return uwvv::helpers::p4WithoutFSR(obj).pt();
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            return uwvv::helpers::p4WithoutFSR(obj).pt();
+          };
 
         addTo["etaNoFSR"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 return uwvv::helpers::p4WithoutFSR(obj).eta();
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            return uwvv::helpers::p4WithoutFSR(obj).eta();
+          };
 
         addTo["phiNoFSR"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 return uwvv::helpers::p4WithoutFSR(obj).phi();
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            return uwvv::helpers::p4WithoutFSR(obj).phi();
+          };
 
         addTo["energyNoFSR"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 return uwvv::helpers::p4WithoutFSR(obj).energy();
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            return uwvv::helpers::p4WithoutFSR(obj).energy();
+          };
 
         addTo["undressedMass"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 return ::getUndressedP4(obj).mass();
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            return ::getUndressedP4(obj).mass();
+          };
 
         addTo["undressedPt"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 return ::getUndressedP4(obj).pt();
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            return ::getUndressedP4(obj).pt();
+          };
 
         addTo["undressedEta"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 return ::getUndressedP4(obj).eta();
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            return ::getUndressedP4(obj).eta();
+          };
 
         addTo["undressedPhi"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 return ::getUndressedP4(obj).phi();
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            return ::getUndressedP4(obj).phi();
+          };
 
       }
     };
@@ -1067,41 +994,22 @@ namespace
       // cheating with typedefs for standardization
       typedef pat::CompositeCandidate T;
       typedef std::vector<int> B;
-      typedef B (FType) (const edm::Ptr<T>&, uwvv::EventInfo&, const std::string&);
 
       static void
-        addFunctions(std::unordered_map<std::string, std::function<FType> >& addTo)
+        addFunctions(uwvv::FunctionRegistry<B,T>& addTo)
       {
 
         addTo["jetHadronFlavor"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 std::vector<int> out;
-
-                                 for(auto& jet : *uwvv::helpers::getCleanedJetCollection(*obj, option))
-                                   {
-                                     out.push_back(jet->hadronFlavour());
-                                   }
-
-                                 return out;
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option, B& out)
+          {
+            out = evt.dijetSummary(*obj, option).hadronFlavor;
+          };
 
         addTo["jetPUID"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 std::vector<int> out;
-
-                                 for(auto& jet : *uwvv::helpers::getCleanedJetCollection(*obj, option))
-                                   {
-                                     int puID = -999;
-                                     if(jet->hasUserInt("pileupJetIdUpdated:fullId"))
-                                       puID = jet->userInt("pileupJetIdUpdated:fullId");
-
-                                     out.push_back(puID);
-                                   }
-
-                                 return out;
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option, B& out)
+          {
+            out = evt.dijetSummary(*obj, option).puID;
+          };
       }
     };
 
@@ -1111,100 +1019,49 @@ namespace
       // cheating with typedefs for standardization
       typedef pat::CompositeCandidate T;
       typedef std::vector<float> B;
-      typedef B (FType) (const edm::Ptr<T>&, uwvv::EventInfo&, const std::string&);
 
       static void
-        addFunctions(std::unordered_map<std::string, std::function<FType> >& addTo)
+        addFunctions(uwvv::FunctionRegistry<B,T>& addTo)
       {
         addTo["jetPt"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 std::vector<float> out;
-
-                                 for(auto& jet : *uwvv::helpers::getCleanedJetCollection(*obj, option))
-                                   {
-                                     out.push_back(jet->pt());
-                                   }
-
-                                 return out;
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option, B& out)
+          {
+            out = evt.dijetSummary(*obj, option).pt;
+          };
         addTo["jetEta"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 std::vector<float> out;
-
-                                 for(auto& jet : *uwvv::helpers::getCleanedJetCollection(*obj, option))
-                                   {
-                                     out.push_back(jet->eta());
-                                   }
-
-                                 return out;
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option, B& out)
+          {
+            out = evt.dijetSummary(*obj, option).eta;
+          };
         addTo["jetPhi"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 std::vector<float> out;
-
-                                 for(auto& jet : *uwvv::helpers::getCleanedJetCollection(*obj, option))
-                                   {
-                                     out.push_back(jet->phi());
-                                   }
-
-                                 return out;
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option, B& out)
+          {
+            out = evt.dijetSummary(*obj, option).phi;
+          };
 
         addTo["jetRapidity"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 std::vector<float> out;
-
-                                 for(auto& jet : *uwvv::helpers::getCleanedJetCollection(*obj, option))
-                                   {
-                                     out.push_back(jet->rapidity());
-                                   }
-
-                                 return out;
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option, B& out)
+          {
+            out = evt.dijetSummary(*obj, option).rapidity;
+          };
 
         addTo["jetQGLikelihood"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 std::vector<float> out;
-
-                                 for(auto& jet : *uwvv::helpers::getCleanedJetCollection(*obj, option))
-                                   {
-                                     if(jet->hasUserFloat("qgLikelihood"))
-                                       out.push_back(jet->userFloat("qgLikelihood"));
-                                   }
-
-                                 return out;
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option, B& out)
+          {
+            out = evt.dijetSummary(*obj, option).qgLikelihood;
+          };
 
         addTo["jetCSVv2"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 std::vector<float> out;
-
-                                 for(auto& jet : *uwvv::helpers::getCleanedJetCollection(*obj, option))
-                                   {
-                                     out.push_back(jet->bDiscriminator("pfCombinedInclusiveSecondaryVertexV2BJetTags"));
-                                   }
-
-                                 return out;
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option, B& out)
+          {
+            out = evt.dijetSummary(*obj, option).csvV2;
+          };
 
         addTo["jetCMVAv2"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 std::vector<float> out;
-
-                                 for(auto& jet : *uwvv::helpers::getCleanedJetCollection(*obj, option))
-                                   {
-                                     out.push_back(jet->bDiscriminator("pfCombinedMVAV2BJetTags"));
-                                   }
-
-                                 return out;
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option, B& out)
+          {
+            out = evt.dijetSummary(*obj, option).cmvaV2;
+          };
       }
     };
 
@@ -1214,16 +1071,15 @@ namespace
       // cheating with typedefs for standardization
       typedef pat::CompositeCandidate T;
       typedef bool B;
-      typedef B (FType) (const edm::Ptr<T>&, uwvv::EventInfo&, const std::string&);
 
       static void
-        addFunctions(std::unordered_map<std::string, std::function<FType> >& addTo)
+        addFunctions(uwvv::FunctionRegistry<B,T>& addTo)
       {
         addTo["SS"] =
-          std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
-                               {
-                                 return obj->daughter(0)->charge() == obj->daughter(1)->charge();
-                               });
+          [](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const uwvv::FunctionOption& option) -> B
+          {
+            return obj->daughter(0)->charge() == obj->daughter(1)->charge();
+          };
       }
     };
 
@@ -1233,16 +1089,89 @@ namespace
 namespace uwvv
 {
 
+  // A branch function ready to be called for each fill: a plain function
+  // pointer and its option. Every kind of branch function has this form
+  // (see NonLibraryFunctions for the ones that aren't in the library), so
+  // a fill is always a single direct call.
   template<typename B, class T>
-  class BasicFunctionLibrary
+  class BranchFunction
   {
    public:
+    BranchFunction(LibraryFunction<B,T> f, const FunctionOption& option) :
+      func(f),
+      option(option)
+    {;}
 
-    // Declare signature of these functions as FType
-    typedef B (FType) (const edm::Ptr<T>&, EventInfo&, const std::string&);
-    // Outward-facing signature doesn't include option argument
-    typedef B (FSig) (const edm::Ptr<T>&, EventInfo&);
+    // Put the value for this object in out
+    void operator()(const edm::Ptr<T>& obj, EventInfo& evt, B& out) const
+    {
+      LibraryFunctionType<B,T>::call(func, obj, evt, option, out);
+    }
 
+    B operator()(const edm::Ptr<T>& obj, EventInfo& evt) const
+    {
+      B out;
+      (*this)(obj, evt, out);
+      return out;
+    }
+
+   private:
+    LibraryFunction<B,T> func;
+    FunctionOption option;
+  };
+
+
+  // Branch functions that aren't in the library, made into the same form
+  // as library functions, with what they need in the option's state
+  template<typename B, class T>
+  struct NonLibraryFunctions
+  {
+    // Plain user data lookups are done natively, without going through the
+    // reflection-based string evaluation. If there's an option but the
+    // function is not in the library, something is probably wrong, but
+    // we'll just let the StringObjectFunction fail to compile.
+    static BranchFunction<B,T> make(const std::string& f)
+    {
+      FunctionOption option;
+      LibraryFunction<B,T> func = 0;
+      if(!UserDataFunctionMaker::makeUserDataFunction(f, func, option.stateData))
+        StringFunctionMaker::makeStringFunction(f, func, option.stateData);
+
+      return BranchFunction<B,T>(func, option);
+    }
+  };
+
+  template<typename B, class T>
+  struct NonLibraryFunctions<std::vector<B>, T>
+  {
+    typedef std::vector<BranchFunction<B,T> > Functions;
+
+    // A vector of the values of several scalar functions
+    static BranchFunction<std::vector<B>,T> make(const Functions& functions)
+    {
+      FunctionOption option;
+      option.stateData = std::make_shared<const Functions>(functions);
+
+      return BranchFunction<std::vector<B>,T>(&fill, option);
+    }
+
+   private:
+    static void fill(const edm::Ptr<T>& obj, EventInfo& evt,
+                     const FunctionOption& option, std::vector<B>& out)
+    {
+      const Functions& functions = option.state<Functions>();
+
+      out.resize(functions.size());
+      for(size_t i = 0; i < functions.size(); ++i)
+        functions[i](obj, evt, out[i]);
+    }
+  };
+
+
+  template<typename B, class T>
+  class BasicFunctionLibrary
+  {
+   public:
     BasicFunctionLibrary()
       {
         ::GeneralFunctionList<B>::addFunctions(functions);
@@ -1250,34 +1179,59 @@ namespace uwvv
       }
     ~BasicFunctionLibrary() {;}
 
-    std::function<FSig>
+    BranchFunction<B,T>
     getFunction(const std::string& f) const
       {
-        // option indicated by '::', i.e. f="functionName::option"
-        size_t sepStart = f.find("::");
-        std::string fname = f.substr(0, sepStart);
+        if(!isInLibrary(f))
+          return NonLibraryFunctions<B,T>::make(f);
 
-        // if there's an option but the function is not in the library,
-        // something is probably wrong, but we'll just let the
-        // StringObjectFunction fail to compile
-        if(functions.find(fname) == functions.end())
-          return StringFunctionMaker::makeStringFunction<B, T, uwvv::EventInfo&>(f);
-
-        std::string option = "";
-        if(sepStart != std::string::npos && sepStart+2 < f.size())
-          option = f.substr(sepStart+2);
+        return getLibraryFunction(f);
+      }
 
-        return std::bind(functions.at(fname), std::placeholders::_1,
-                         std::placeholders::_2, option);
+    // True if f ("functionName::option") is a library function that
+    // depends only on the event
+    bool isEventLevel(const std::string& f) const
+      {
+        return functions.isEventLevel(f.substr(0, f.find("::")));
       }
 
     // for testing purposes
-    // const std::unordered_map<std::string, std::function<FType> >&
-    //   getAllFunctions() const {return functions;}
+    // const FunctionRegistry<B,T>& getAllFunctions() const {return functions;}
 
    protected:
-    std::unordered_map<std::string,
-      std::function<FType> > functions;
+    bool isInLibrary(const std::string& f) const
+      {
+        // option indicated by '::', i.e. f="functionName::option"
+        return functions.find(f.substr(0, f.find("::"))) != functions.end();
+      }
+
+    // f must be in the library
+    BranchFunction<B,T>
+    getLibraryFunction(const std::string& f) const
+      {
+        size_t sepStart = f.find("::");
+        std::string fname = f.substr(0, sepStart);
+
+        FunctionOption option;
+        if(sepStart != std::string::npos)
+          option.label = f.substr(sepStart+2);
+
+        if(needsRangeOption(fname) && !option.parseRange())
+          throw cms::Exception("BadBranchOption")
+            << "Unable to parse option " << option.label << " for " << fname
+            << " as an index range (\"last\", \"first,last\", or "
+            << "\"first,last,precision\")." << std::endl;
+        if(fname == "lheWeightsFixed" &&
+           !(option.precision >= uwvv::lheWeightEncoding::minFixedPrecision))
+          throw cms::Exception("BadBranchOption")
+            << "lheWeightsFixed needs a precision of at least "
+            << uwvv::lheWeightEncoding::minFixedPrecision << ", as in "
+            << "\"lheWeightsFixed::first,last,precision\"." << std::endl;
+
+        return BranchFunction<B,T>(functions.find(fname)->second, option);
+      }
+
+    FunctionRegistry<B,T> functions;
   };
 
 
@@ -1291,38 +1245,41 @@ namespace uwvv
   class FunctionLibrary<std::vector<B>,T> : public BasicFunctionLibrary<std::vector<B>,T>
   {
    public:
-    typedef typename BasicFunctionLibrary<std::vector<B>,T>::FSig FSig;
-
-    using BasicFunctionLibrary<std::vector<B>,T>::getFunction;
+    BranchFunction<std::vector<B>,T>
+    getFunction(const std::string& f) const
+      {
+        return getFunction(std::vector<std::string>(1, f));
+      }
 
-    std::function<FSig>
+    BranchFunction<std::vector<B>,T>
     getFunction(const std::vector<std::string>& fs) const
       {
-        if(fs.size() == 1)
-          {
-            size_t sepStart = fs.at(0).find("::");
-            std::string fname = fs.at(0).substr(0,sepStart);
-
-            if(this->functions.find(fname) != this->functions.end())
-              return getFunction(fs.at(0));
-          }
+        if(fs.size() == 1 && this->isInLibrary(fs.at(0)))
+          return this->getLibraryFunction(fs.at(0));
 
         // Otherwise, make a new function that returns a vector
-        std::vector<std::function<typename FunctionLibrary<B,T>::FSig> > needed;
+        typename NonLibraryFunctions<std::vector<B>,T>::Functions needed;
         for(const auto& f : fs)
           needed.push_back(baseLib.getFunction(f));
 
-        auto out = std::function<FSig>([needed](const edm::Ptr<T>& obj,
-                                                uwvv::EventInfo& evt)
-                                       {
-                                         std::vector<B> out;
-                                         for(const auto& fun : needed)
-                                           out.push_back(fun(obj, evt));
+        return NonLibraryFunctions<std::vector<B>,T>::make(needed);
+      }
+
+    using BasicFunctionLibrary<std::vector<B>,T>::isEventLevel;
+
+    // A vector of functions depends only on the event if they all do
+    bool isEventLevel(const std::vector<std::string>& fs) const
+      {
+        if(fs.size() == 1 && this->isInLibrary(fs.at(0)))
+          return isEventLevel(fs.at(0));
 
-                                         return out;
-                                       });
+        for(const auto& f : fs)
+          {
+            if(!baseLib.isEventLevel(f))
+              return false;
+          }
 
-        return out;
+        return !fs.empty();
       }
 
    private:
@@ -2,7 +2,7 @@
 #define UWVV_Ntuplizer_StringFunctionMaker_h
 
 
-#include <functional>
+#include <memory>
 #include <string>
 
 // ROOT
@@ -31,6 +31,11 @@ namespace
       return TMath::Nint(fabs(x));
     }
 
+  template<> unsigned short convertFromFloat(float x)
+    {
+      return TMath::Nint(fabs(x));
+    }
+
   template<> unsigned long long convertFromFloat(float x)
     {
       return lrint(fabs(x));
@@ -44,15 +49,20 @@ namespace uwvv
   class StringFunctionMaker
   {
    public:
-    template<typename Return, class Obj, class... OtherArgs>
-      static std::function<Return(const edm::Ptr<Obj>, OtherArgs...)>
-      makeStringFunction(const std::string& fString)
+    // Make out a function evaluating fString with a StringObjectFunction,
+    // which is kept in state. The function gets it back from its option
+    // (see FunctionOption::state()).
+    template<typename Return, class Obj, class Evt, class Option>
+      static void
+      makeStringFunction(const std::string& fString,
+                         Return (*&out)(const edm::Ptr<Obj>&, Evt, const Option&),
+                         std::shared_ptr<const void>& state)
     {
-      StringObjectFunction<Obj, true> calculator(fString);
-      std::function<Return(const edm::Ptr<Obj>, OtherArgs...)> 
-        out([calculator](const edm::Ptr<Obj>& obj, OtherArgs... otherArgs)
-            {return ::convertFromFloat<Return>(calculator(*obj));});
-      return out;
+      state = std::make_shared<const StringObjectFunction<Obj, true> >(fString);
+      out = [](const edm::Ptr<Obj>& obj, Evt evt, const Option& option) -> Return
+        {
+          return ::convertFromFloat<Return>(option.template state<StringObjectFunction<Obj, true> >()(*obj));
+        };
     }
   };
 
@@ -0,0 +1,207 @@
+#ifndef UWVV_Ntuplizer_TreeFiller_h
+#define UWVV_Ntuplizer_TreeFiller_h
+
+
+// STL
+#include <string>
+#include <vector>
+#include <memory>
+#include <type_traits>
+
+// ROOT
+#include "TTree.h"
+
+// CMSSW
+#include "FWCore/Framework/interface/Event.h"
+#include "FWCore/Framework/interface/ConsumesCollector.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "DataFormats/Common/interface/View.h"
+#include "DataFormats/Common/interface/Ptr.h"
+#include "DataFormats/Candidate/interface/Candidate.h"
+#include "DataFormats/PatCandidates/interface/CompositeCandidate.h"
+
+// UWVV
+#include "UWVV/Ntuplizer/interface/BranchManager.h"
+#include "UWVV/Ntuplizer/interface/EventInfo.h"
+#include "UWVV/Ntuplizer/interface/TriggerBranches.h"
+#include "UWVV/Ntuplizer/interface/FunctionLibrary.h"
+#include "UWVV/Ntuplizer/interface/CandidateCounter.h"
+#include "UWVV/DataFormats/interface/EventTreeEntry.h"
+
+
+namespace uwvv
+{
+
+  // Everything needed to turn the candidates in one event into rows of an
+  // ntuple: the event info, the branches (object, trigger, and filter), and
+  // the preselection. Shared by the ntuplizer modules, which only decide
+  // which tree the rows go into. If eventTree is set to the label of an
+  // EventTreeGenerator, the event-level branches are left out, and each row
+  // gets an eventEntry branch with the index of its event in that module's
+  // tree instead, taken from the EventTreeEntry it puts in the event.
+  template<class T>
+  class TreeFiller
+  {
+   public:
+    // If this is a particle candidate, we can make branches directly from it
+    // Otherwise, assume it specifies and composite candidate
+    typedef typename std::conditional<std::is_base_of<reco::Candidate, T>::value,
+                                      T, pat::CompositeCandidate>::type Cand;
+
+    TreeFiller(const edm::ParameterSet& config, edm::ConsumesCollector cc,
+               TTree* const tree);
+    virtual ~TreeFiller() {;}
+
+    // Fill one row of the tree for each candidate in the event passing the
+    // preselection, and return the number of rows filled
+    size_t fill(const edm::Event& event);
+
+    const BranchCacheInfo& branchCache() const {return evtInfo.branchCache();}
+
+   private:
+    bool passPreselection(const edm::Ptr<Cand>& cand);
+
+    unsigned long long getEventEntry(const edm::Event& event);
+
+    const edm::EDGetTokenT<edm::View<Cand> > candToken;
+
+    TTree* const tree;
+    EventInfo evtInfo;
+
+    BranchManager<T> branches;
+    TriggerBranches triggerBranches;
+    TriggerBranches filterBranches;
+
+    // Candidates failing any of these are skipped before any branches are
+    // filled
+    std::vector<BranchFunction<bool, Cand> > preselection;
+    std::shared_ptr<CandidateCounts> counts;
+
+    const std::string eventTree;
+    edm::EDGetTokenT<EventTreeEntry> eventEntryToken;
+    unsigned long long eventBranchesHash;
+    ULong64_t eventEntry;
+  };
+
+
+
+
+  template<class T>
+  TreeFiller<T>::TreeFiller(const edm::ParameterSet& config,
+                            edm::ConsumesCollector cc,
+                            TTree* const tree) :
+    candToken(cc.consumes<edm::View<Cand> >(config.getParameter<edm::InputTag>("src"))),
+    tree(tree),
+    evtInfo(cc, config.getParameter<edm::ParameterSet>("eventParams")),
+    branches("", tree, config.getParameter<edm::ParameterSet>("branches"), false,
+             config.exists("eventTree") ? EventLevelBranches::skip : EventLevelBranches::keep),
+    triggerBranches(cc, config.getParameter<edm::ParameterSet>("triggers"), tree),
+    filterBranches(cc, config.getParameter<edm::ParameterSet>("filters"), tree),
+    eventTree(config.exists("eventTree") ?
+              config.getParameter<std::string>("eventTree") : ""),
+    eventBranchesHash(EventTreeEntry::hashBranches(branches.getEventLevelBranches())),
+    eventEntry(0)
+  {
+    if(!eventTree.empty())
+      {
+        eventEntryToken = cc.consumes<EventTreeEntry>(edm::InputTag(eventTree));
+        tree->Branch("eventEntry", &eventEntry);
+      }
+
+    // Memoize lepton- and Z-level branches for objects shared by several
+    // candidates in the same event
+    evtInfo.branchCache().enable(config.getUntrackedParameter<bool>("cacheObjectBranches", false));
+
+    if(config.exists("preselection"))
+      {
+        const edm::ParameterSet& cuts = config.getParameter<edm::ParameterSet>("preselection");
+        FunctionLibrary<bool, Cand> fLib;
+        for(const auto& name : cuts.getParameterNames())
+          preselection.push_back(fLib.getFunction(cuts.getParameter<std::string>(name)));
+
+        if(!preselection.empty())
+          counts = CandidateCounter::get(config.getParameter<std::string>("@module_label"));
+      }
+  }
+
+
+  template<class T>
+  bool
+  TreeFiller<T>::passPreselection(const edm::Ptr<Cand>& cand)
+  {
+    if(preselection.empty())
+      return true;
+
+    ++counts->evaluated;
+
+    for(const auto& cut : preselection)
+      {
+        if(!cut(cand, evtInfo))
+          {
+            ++counts->rejected;
+            return false;
+          }
+      }
+
+    return true;
+  }
+
+
+  template<class T>
+  unsigned long long
+  TreeFiller<T>::getEventEntry(const edm::Event& event)
+  {
+    edm::Handle<EventTreeEntry> entry;
+    event.getByToken(eventEntryToken, entry);
+
+    if(!entry.isValid())
+      throw cms::Exception("MissingEventTreeEntry")
+        << "Event " << event.id() << " has candidates but was not written "
+        << "to event tree " << eventTree << ". Its candSrcs must include "
+        << "every collection pointing at it." << std::endl;
+
+    if(entry->branchesHash() != eventBranchesHash)
+      throw cms::Exception("InvalidEventTree")
+        << "Event tree " << eventTree << " holds different event-level "
+        << "branches than the ones left out of this tree. Give it the same "
+        << "event-level branches as every tree pointing at it." << std::endl;
+
+    return entry->entry();
+  }
+
+
+  template<class T>
+  size_t
+  TreeFiller<T>::fill(const edm::Event& event)
+  {
+    edm::Handle<edm::View<Cand> > cands;
+    event.getByToken(candToken, cands);
+
+    evtInfo.setEvent(event);
+    // trigger and filter branches are filled here, once for all rows
+    triggerBranches.setEvent(event);
+    filterBranches.setEvent(event);
+
+    size_t nFilled = 0;
+    for(size_t i = 0; i < cands->size(); ++i)
+      {
+        edm::Ptr<Cand> cand = cands->ptrAt(i);
+
+        if(!passPreselection(cand))
+          continue;
+
+        branches.fill(cand, evtInfo);
+
+        if(!eventTree.empty() && !nFilled)
+          eventEntry = getEventEntry(event);
+
+        tree->Fill();
+        ++nFilled;
+      }
+
+    return nFilled;
+  }
+
+} // namespace
+
+#endif // header guard
@@ -4,7 +4,6 @@
 // STL
 #include <string>
 #include <vector>
-#include <unordered_map>
 #include <memory>
 
 // CMSSW
@@ -23,12 +22,13 @@
 
 // UWVV
 #include "UWVV/Ntuplizer/interface/TriggerPathInfo.h"
+#include "UWVV/DataFormats/interface/TriggerDecisions.h"
 
 
 namespace uwvv
 {
 
-  // Single Branch
+  // Single Branch (no branch is made if tree is null)
   class TriggerBranch
   {
   public:
@@ -44,6 +44,12 @@ namespace uwvv
     void fill(const edm::TriggerResults& results,
               const pat::PackedTriggerPrescales& prescales);
 
+    // Fill with a decision made elsewhere
+    void fill(bool passIn, unsigned prescaleIn) {pass = passIn; prescale = prescaleIn;}
+
+    bool passed() const {return pass;}
+    unsigned getPrescale() const {return prescale;}
+
   private:
     const std::string name;
     const bool checkPrescale;
@@ -56,7 +62,20 @@ namespace uwvv
   };
 
 
-  // Collection of branches
+  // Collection of branches. If the config has decisionSrc, the decisions
+  // are read from that TriggerDecisions product (made by a
+  // TriggerDecisionProducer with the same trigNames) instead of being
+  // worked out from the trigger results.
+  //
+  // If the config has packedBranch (a string), the decisions go into one
+  // array branch of that name instead of a [name]Pass branch for each name:
+  // trigNames[i] is bit i%64 of word i/64 (ULong64_t). The names are
+  // stored in bit order, comma separated, in a TNamed of the same name in
+  // the tree's user info. With checkPrescale, the prescales go into a
+  // separate tree, [packedBranch]Prescales, in the same directory, with a
+  // row only when any of them changes; firstRow is the first row of the
+  // ntuple they apply to. Trees not in a directory get a per-row
+  // [packedBranch]Prescales array branch instead.
   class TriggerBranches
   {
    public:
@@ -65,23 +84,55 @@ namespace uwvv
                     TTree* const tree);
     ~TriggerBranches() {;}
 
+    // Work out the decisions for this event and set the branch values.
+    // They don't depend on the candidate, so nothing needs to be done for
+    // each row.
     void setEvent(const edm::Event& event);
 
-    void fill();    
+    // Put the decisions for the current event in out (constructed with
+    // names())
+    void fillDecisions(TriggerDecisions& out) const;
+
+    const std::vector<std::string>& names() const {return names_;}
 
    private:
-    const edm::EDGetTokenT<edm::TriggerResults> resultsToken;
+    void evaluate();
+
+    // Set up and fill the packed branch and prescales
+    void setupPacked(const std::string& branchName);
+    void pack();
+
+    std::vector<std::string> names_;
+    const unsigned long long namesHash;
+
+    const bool useDecisions;
+    edm::EDGetTokenT<TriggerDecisions> decisionsToken;
+    edm::Handle<TriggerDecisions> decisions;
+
+    edm::EDGetTokenT<edm::TriggerResults> resultsToken;
     edm::Handle<edm::TriggerResults> results;
-    const edm::EDGetTokenT<pat::PackedTriggerPrescales> prescalesToken;
+    edm::EDGetTokenT<pat::PackedTriggerPrescales> prescalesToken;
     edm::Handle<pat::PackedTriggerPrescales> prescales;
 
     edm::ParameterSetID id;
 
-    std::unordered_map<std::string, std::unique_ptr<TriggerBranch> > branches;
+    // in the order of names_
+    std::vector<std::unique_ptr<TriggerBranch> > branches;
 
     bool isValid;
 
     const bool checkPrescale;
+
+    // Packed output
+    bool packed;
+    TTree* tree;
+    std::vector<ULong64_t> packedBits;
+    std::vector<UInt_t> packedPrescales;
+    TTree* prescaleTree; // owned by the tree's directory
+    bool prescalesWritten;
+    UInt_t run;
+    UInt_t lumi;
+    ULong64_t firstRow;
   };
 
 } // namespace
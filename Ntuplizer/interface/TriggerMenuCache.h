@@ -0,0 +1,50 @@
+#ifndef UWVV_Ntuplizer_TriggerMenuCache_h
+#define UWVV_Ntuplizer_TriggerMenuCache_h
+
+// STL
+#include <string>
+#include <unordered_map>
+#include <mutex>
+
+// CMSSW
+#include "FWCore/Common/interface/TriggerNames.h"
+
+// UWVV
+#include "UWVV/Ntuplizer/interface/TriggerPathMatcher.h"
+
+
+namespace uwvv
+{
+
+  // Process-wide cache of which bit each trigger path expression matches
+  // in each trigger menu (identified by the menu's ParameterSetID), so
+  // the menu is only scanned for an expression the first time any module
+  // needs it. Every TriggerBranches instance looks up the same expressions
+  // when the menu changes, so after the first one it's a hash lookup.
+  class TriggerMenuCache
+  {
+   public:
+    struct Match
+    {
+      // Matching bit, or names.size() if none matched
+      size_t bit;
+      // Another matching bit if the expression is ambiguous, otherwise
+      // names.size()
+      size_t duplicate;
+    };
+
+    static Match find(const edm::TriggerNames& names,
+                      const TriggerPathMatcher& matcher);
+
+   private:
+    static Match scan(const edm::TriggerNames& names,
+                      const TriggerPathMatcher& matcher);
+
+    static std::mutex mutex_;
+    // keyed to menu ID (compact form) + expression
+    static std::unordered_map<std::string, Match> matches_;
+  };
+
+} // namespace
+
+#endif // header guard
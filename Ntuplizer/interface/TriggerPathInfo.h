@@ -8,6 +8,8 @@
 #include "DataFormats/PatCandidates/interface/TriggerObjectStandAlone.h"
 #include "DataFormats/PatCandidates/interface/PackedTriggerPrescales.h"
 
+#include "UWVV/Ntuplizer/interface/TriggerPathMatcher.h"
+
 
 namespace uwvv
 {
@@ -18,7 +20,7 @@ namespace uwvv
     TriggerPathInfo(const std::string& nameExp, bool ignoreMissing);
     ~TriggerPathInfo() {;}
 
-    // Set bit, name
+    // Set bit, name (from the process-wide menu cache)
     void setup(const edm::TriggerNames& names);
 
     bool pass(const edm::TriggerResults& results) const;
@@ -39,6 +41,7 @@ namespace uwvv
 
     // reg exp for trigger name
     const std::string nameExp_;
+    TriggerPathMatcher matcher_;
     // name and bit of the actual trigger (may change)
     std::string name_;
     size_t bit_;
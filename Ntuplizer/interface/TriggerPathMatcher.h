@@ -0,0 +1,42 @@
+#ifndef UWVV_Ntuplizer_TriggerPathMatcher_h
+#define UWVV_Ntuplizer_TriggerPathMatcher_h
+
+#include <string>
+#include <memory>
+#include <regex>
+
+
+namespace uwvv
+{
+
+  // Trigger path expression, compiled once. Almost all expressions are a
+  // path name with the version number wildcarded ("HLT_IsoMu20_v[0-9]+"),
+  // or just a name, so those are matched as a literal prefix followed by
+  // digits (or anything, for ".*") without std::regex. Anything else falls
+  // back to a std::regex, constructed here instead of for every menu.
+  class TriggerPathMatcher
+  {
+   public:
+    TriggerPathMatcher(const std::string& expression);
+    ~TriggerPathMatcher() {;}
+
+    bool match(const std::string& name) const;
+
+    const std::string& expression() const {return expression_;}
+
+   private:
+    enum Kind {LITERAL, DIGITS, ANY, REGEX};
+
+    const std::string expression_;
+
+    Kind kind_;
+    std::string prefix_;
+    size_t minDigits_; // for DIGITS
+
+    std::shared_ptr<const std::regex> regex_; // only for REGEX
+  };
+
+} // namespace
+
+
+#endif // header guard
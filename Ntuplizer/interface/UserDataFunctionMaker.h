@@ -0,0 +1,225 @@
+#ifndef UWVV_Ntuplizer_UserDataFunctionMaker_h
+#define UWVV_Ntuplizer_UserDataFunctionMaker_h
+
+
+#include <memory>
+#include <string>
+#include <regex>
+#include <type_traits>
+#include <utility>
+
+// CMSSW
+#include "DataFormats/Common/interface/Ptr.h"
+#include "DataFormats/Candidate/interface/Candidate.h"
+#include "FWCore/Utilities/interface/Exception.h"
+
+// UWVV
+#include "UWVV/Ntuplizer/interface/StringFunctionMaker.h"
+
+
+namespace uwvv
+{
+
+  // A userFloat/userInt/userCand lookup, optionally guarded by the matching
+  // hasUserX() check with a default value, e.g.
+  //     userFloat("ZZIsoVal")
+  //     ? hasUserFloat("ZZIsoVal") ? userFloat("ZZIsoVal") : 999.
+  //     ? hasUserCand("fsr") ? userCand("fsr").et() : -999.
+  struct UserDataLookup
+  {
+    enum Kind {FLOAT, INT, CAND};
+    enum CandMember {NONE, PT, ETA, PHI, ET, MASS, ENERGY};
+
+    Kind kind;
+    std::string label;
+    CandMember member;
+    bool hasDefault;
+    float defaultValue;
+  };
+
+
+  class UserDataFunctionMaker
+  {
+   public:
+    // If fString is a simple user data lookup that can be done natively
+    // (for PAT objects), make out a function doing it, with the lookup
+    // kept in state, and return true. The function gets the lookup back
+    // from its option (see FunctionOption::state()). Otherwise, return
+    // false and leave out alone; the caller should fall back to a
+    // StringObjectFunction.
+    template<typename Return, class Obj, class Evt, class Option>
+      static bool
+      makeUserDataFunction(const std::string& fString,
+                           Return (*&out)(const edm::Ptr<Obj>&, Evt, const Option&),
+                           std::shared_ptr<const void>& state)
+    {
+      UserDataLookup lookup;
+      if(!parse(fString, lookup))
+        return false;
+
+      return Maker<std::is_arithmetic<Return>::value &&
+                   HasUserData<Obj>::value>::template make<Return, Obj, Evt, Option>(lookup, out, state);
+    }
+
+    static bool parse(const std::string& fString, UserDataLookup& lookup)
+    {
+      static const std::string label = "\"([^\"]+)\"";
+      static const std::string number = "([-+]?(?:[0-9]+\\.?[0-9]*|\\.[0-9]+)(?:[eE][-+]?[0-9]+)?)";
+      static const std::string member = "\\.(pt|eta|phi|et|mass|energy)(?:\\(\\))?";
+
+      static const std::regex plain("\\s*user(Float|Int)\\(" + label + "\\)\\s*");
+      static const std::regex guarded("\\s*\\?\\s*hasUser(Float|Int)\\(" + label + "\\)\\s*"
+                                      "\\?\\s*user\\1\\(\"\\2\"\\)\\s*:\\s*" + number + "\\s*");
+      static const std::regex plainCand("\\s*userCand\\(" + label + "\\)" + member + "\\s*");
+      static const std::regex guardedCand("\\s*\\?\\s*hasUserCand\\(" + label + "\\)\\s*"
+                                          "\\?\\s*userCand\\(\"\\1\"\\)" + member +
+                                          "\\s*:\\s*" + number + "\\s*");
+
+      std::smatch m;
+      if(std::regex_match(fString, m, plain))
+        {
+          lookup.kind = (m[1] == "Float" ? UserDataLookup::FLOAT : UserDataLookup::INT);
+          lookup.label = m[2].str();
+          lookup.member = UserDataLookup::NONE;
+          lookup.hasDefault = false;
+          lookup.defaultValue = 0.;
+          return true;
+        }
+      if(std::regex_match(fString, m, guarded))
+        {
+          lookup.kind = (m[1] == "Float" ? UserDataLookup::FLOAT : UserDataLookup::INT);
+          lookup.label = m[2].str();
+          lookup.member = UserDataLookup::NONE;
+          lookup.hasDefault = true;
+          lookup.defaultValue = std::stof(m[3].str());
+          return true;
+        }
+      if(std::regex_match(fString, m, plainCand))
+        {
+          lookup.kind = UserDataLookup::CAND;
+          lookup.label = m[1].str();
+          lookup.member = parseMember(m[2].str());
+          lookup.hasDefault = false;
+          lookup.defaultValue = 0.;
+          return true;
+        }
+      if(std::regex_match(fString, m, guardedCand))
+        {
+          lookup.kind = UserDataLookup::CAND;
+          lookup.label = m[1].str();
+          lookup.member = parseMember(m[2].str());
+          lookup.hasDefault = true;
+          lookup.defaultValue = std::stof(m[3].str());
+          return true;
+        }
+
+      return false;
+    }
+
+   private:
+    // Check whether an object has PAT user data (i.e. is a PATObject)
+    template<class Obj>
+      class HasUserData
+      {
+        template<class U> static auto
+          test(int) -> decltype(std::declval<const U&>().hasUserFloat(std::string()),
+                                std::true_type());
+        template<class U> static std::false_type test(...);
+
+       public:
+        static const bool value = decltype(test<Obj>(0))::value;
+      };
+
+    static UserDataLookup::CandMember parseMember(const std::string& m)
+    {
+      if(m == "pt") return UserDataLookup::PT;
+      if(m == "eta") return UserDataLookup::ETA;
+      if(m == "phi") return UserDataLookup::PHI;
+      if(m == "et") return UserDataLookup::ET;
+      if(m == "mass") return UserDataLookup::MASS;
+      if(m == "energy") return UserDataLookup::ENERGY;
+
+      throw cms::Exception("InvalidUserData")
+        << "Unknown user candidate member " << m << std::endl;
+    }
+
+    template<class Obj>
+      static float evaluate(const UserDataLookup& lookup, const Obj& obj)
+    {
+      switch(lookup.kind)
+        {
+        case UserDataLookup::FLOAT:
+          if(lookup.hasDefault && !obj.hasUserFloat(lookup.label))
+            return lookup.defaultValue;
+          return obj.userFloat(lookup.label);
+        case UserDataLookup::INT:
+          if(lookup.hasDefault && !obj.hasUserInt(lookup.label))
+            return lookup.defaultValue;
+          return obj.userInt(lookup.label);
+        case UserDataLookup::CAND:
+          break;
+        }
+
+      if(lookup.hasDefault && !obj.hasUserCand(lookup.label))
+        return lookup.defaultValue;
+
+      const reco::CandidatePtr cand = obj.userCand(lookup.label);
+      switch(lookup.member)
+        {
+        case UserDataLookup::PT:
+          return cand->pt();
+        case UserDataLookup::ETA:
+          return cand->eta();
+        case UserDataLookup::PHI:
+          return cand->phi();
+        case UserDataLookup::ET:
+          return cand->et();
+        case UserDataLookup::MASS:
+          return cand->mass();
+        case UserDataLookup::ENERGY:
+          return cand->energy();
+        default:
+          break;
+        }
+
+      throw cms::Exception("InvalidUserData")
+        << "No member requested for user candidate " << lookup.label << std::endl;
+    }
+
+    // Objects that aren't PATObjects (or non-numeric branches) always use
+    // the StringObjectFunction
+    template<bool canDo, class Dummy=void>
+      struct Maker
+      {
+        template<typename Return, class Obj, class Evt, class Option>
+          static bool
+          make(const UserDataLookup& lookup,
+               Return (*&out)(const edm::Ptr<Obj>&, Evt, const Option&),
+               std::shared_ptr<const void>& state)
+        {
+          return false;
+        }
+      };
+
+    template<class Dummy>
+      struct Maker<true, Dummy>
+      {
+        template<typename Return, class Obj, class Evt, class Option>
+          static bool
+          make(const UserDataLookup& lookup,
+               Return (*&out)(const edm::Ptr<Obj>&, Evt, const Option&),
+               std::shared_ptr<const void>& state)
+        {
+          state = std::make_shared<const UserDataLookup>(lookup);
+          out = [](const edm::Ptr<Obj>& obj, Evt evt, const Option& option) -> Return
+            {
+              return ::convertFromFloat<Return>(evaluate(option.template state<UserDataLookup>(), *obj));
+            };
+          return true;
+        }
+      };
+  };
+
+}
+
+#endif // header guard
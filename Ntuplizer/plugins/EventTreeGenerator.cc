@@ -0,0 +1,148 @@
+/////////////////////////////////////////////////////////////////////////////
+//                                                                         //
+//    EventTreeGenerator                                                   //
+//                                                                         //
+//    A builder of event-level ntuples, with one row per event instead     //
+//    of one per candidate. TreeGenerators with eventTree set to this      //
+//    module's label leave out their event-level branches and store the    //
+//    index of the event's row here instead, which this module puts in     //
+//    the event as an EventTreeEntry. If candSrcs is given, only events    //
+//    with at least one candidate in one of those collections are          //
+//    written (and get an EventTreeEntry).                                 //
+//                                                                         //
+//    Of the branches it is given, it makes only those whose library       //
+//    functions are registered as event-level, because they are called     //
+//    without a candidate. The rest are left out.                          //
+//                                                                         //
+/////////////////////////////////////////////////////////////////////////////
+
+
+//STL
+#include <memory>
+#include <string>
+#include <vector>
+
+// CMSSW
+#include "FWCore/Framework/interface/Frameworkfwd.h"
+#include "FWCore/Framework/interface/one/EDProducer.h"
+#include "FWCore/Framework/interface/Event.h"
+
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+
+#include "FWCore/ServiceRegistry/interface/Service.h"
+#include "CommonTools/UtilAlgos/interface/TFileService.h"
+
+#include "DataFormats/Common/interface/View.h"
+#include "DataFormats/Candidate/interface/Candidate.h"
+#include "DataFormats/PatCandidates/interface/CompositeCandidate.h"
+
+// ROOT
+#include "TTree.h"
+
+// UWVV
+#include "UWVV/Ntuplizer/interface/BranchManager.h"
+#include "UWVV/Ntuplizer/interface/EventInfo.h"
+#include "UWVV/Ntuplizer/interface/TriggerBranches.h"
+#include "UWVV/DataFormats/interface/EventTreeEntry.h"
+
+
+using namespace uwvv;
+
+class EventTreeGenerator : public edm::one::EDProducer<edm::one::SharedResources>
+{
+ public:
+  explicit EventTreeGenerator(const edm::ParameterSet&);
+  virtual ~EventTreeGenerator() {;}
+
+ private:
+  virtual void produce(edm::Event& iEvent, edm::EventSetup const& iConfig) override;
+
+  TTree* const makeTree(const edm::ParameterSet& config) const;
+
+  bool hasCandidates(const edm::Event& event);
+
+  TTree* const tree;
+  EventInfo evtInfo;
+
+  BranchManager<pat::CompositeCandidate> branches;
+  const unsigned long long branchesHash;
+  TriggerBranches triggerBranches;
+  TriggerBranches filterBranches;
+
+  std::vector<edm::EDGetTokenT<edm::View<reco::Candidate> > > candTokens;
+};
+
+
+EventTreeGenerator::EventTreeGenerator(const edm::ParameterSet& config) :
+  tree(makeTree(config)),
+  evtInfo(consumesCollector(), config.getParameter<edm::ParameterSet>("eventParams")),
+  branches("", tree, config.getParameter<edm::ParameterSet>("branches"), false,
+           EventLevelBranches::only),
+  branchesHash(EventTreeEntry::hashBranches(branches.getEventLevelBranches())),
+  triggerBranches(consumesCollector(), config.getParameter<edm::ParameterSet>("triggers"), tree),
+  filterBranches(consumesCollector(), config.getParameter<edm::ParameterSet>("filters"), tree)
+{
+  usesResource("TFileService");
+
+  produces<EventTreeEntry>();
+
+  if(config.exists("candSrcs"))
+    {
+      for(const auto& tag : config.getParameter<std::vector<edm::InputTag> >("candSrcs"))
+        candTokens.push_back(consumes<edm::View<reco::Candidate> >(tag));
+    }
+}
+
+
+TTree* const EventTreeGenerator::makeTree(const edm::ParameterSet& config) const
+{
+  edm::Service<TFileService> FS;
+
+  const std::string ntupleName = (config.exists("ntupleName") ?
+                                  config.getParameter<std::string>("ntupleName") :
+                                  "ntuple");
+
+  return FS->make<TTree>(ntupleName.c_str(), ntupleName.c_str());
+}
+
+
+bool EventTreeGenerator::hasCandidates(const edm::Event& event)
+{
+  if(candTokens.empty())
+    return true;
+
+  edm::Handle<edm::View<reco::Candidate> > cands;
+  for(const auto& token : candTokens)
+    {
+      event.getByToken(token, cands);
+      if(cands->size())
+        return true;
+    }
+
+  return false;
+}
+
+
+void EventTreeGenerator::produce(edm::Event &event,
+                                 const edm::EventSetup &setup)
+{
+  if(!hasCandidates(event))
+    return;
+
+  evtInfo.setEvent(event);
+  triggerBranches.setEvent(event);
+  filterBranches.setEvent(event);
+
+  // only event-level functions were made, and they don't look at the
+  // candidate
+  branches.fill(edm::Ptr<pat::CompositeCandidate>(), evtInfo);
+
+  event.put(std::unique_ptr<EventTreeEntry>(new EventTreeEntry(tree->GetEntries(),
+                                                               branchesHash)));
+  tree->Fill();
+}
+
+
+#include "FWCore/Framework/interface/MakerMacros.h"
+
+DEFINE_FWK_MODULE(EventTreeGenerator);
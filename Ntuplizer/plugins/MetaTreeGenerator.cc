@@ -11,6 +11,8 @@
 
 //STL
 #include <memory>
+#include <string>
+#include <vector>
 
 // CMSSW
 #include "FWCore/Framework/interface/Frameworkfwd.h"
@@ -30,6 +32,7 @@
 
 // UWVV
 #include "UWVV/Ntuplizer/interface/EventInfo.h"
+#include "UWVV/Ntuplizer/interface/CandidateCounter.h"
 
 
 using namespace uwvv;
@@ -51,6 +54,10 @@ class MetaTreeGenerator : public edm::one::EDAnalyzer<edm::one::SharedResources,
 
   TTree* const makeTree();
 
+  // Add branches for the candidate counts of any TreeGenerators using a
+  // preselection. They all exist by the time the first lumi ends
+  void addCandidateCountBranches();
+
   TTree* const tree;
   EventInfo evtInfo;
   const std::string datasetName;
@@ -59,6 +66,15 @@ class MetaTreeGenerator : public edm::one::EDAnalyzer<edm::one::SharedResources,
   unsigned lumiBranch;
   unsigned neventsBranch;
   float summedWeightsBranch;
+
+  bool candidateCountBranchesAdded;
+  std::vector<std::shared_ptr<CandidateCounts> > candidateCounts;
+  // totals at the start of this lumi, to get the number in this lumi
+  std::vector<unsigned long long> evaluatedAtLumiStart;
+  std::vector<unsigned long long> rejectedAtLumiStart;
+  // branch values, never resized after the branches are made
+  std::vector<unsigned long long> evaluatedBranches;
+  std::vector<unsigned long long> rejectedBranches;
 };
 
 
@@ -70,7 +86,8 @@ MetaTreeGenerator::MetaTreeGenerator(const edm::ParameterSet& config) :
   runBranch(0),
   lumiBranch(0),
   neventsBranch(0),
-  summedWeightsBranch(0.)
+  summedWeightsBranch(0.),
+  candidateCountBranchesAdded(false)
 {
   usesResource("TFileService");
   edm::Service<TFileService> FS;
@@ -94,6 +111,33 @@ TTree* const MetaTreeGenerator::makeTree()
 }
 
 
+void MetaTreeGenerator::addCandidateCountBranches()
+{
+  std::map<std::string, std::shared_ptr<CandidateCounts> > allCounts =
+    CandidateCounter::all();
+
+  for(auto& c : allCounts)
+    candidateCounts.push_back(c.second);
+
+  // nothing was counted before the first lumi
+  evaluatedAtLumiStart.assign(candidateCounts.size(), 0);
+  rejectedAtLumiStart.assign(candidateCounts.size(), 0);
+
+  evaluatedBranches.assign(candidateCounts.size(), 0);
+  rejectedBranches.assign(candidateCounts.size(), 0);
+
+  size_t i = 0;
+  for(auto& c : allCounts)
+    {
+      tree->Branch((c.first+"_candidatesEvaluated").c_str(), &evaluatedBranches[i]);
+      tree->Branch((c.first+"_candidatesRejected").c_str(), &rejectedBranches[i]);
+      ++i;
+    }
+
+  candidateCountBranchesAdded = true;
+}
+
+
 void
 MetaTreeGenerator::beginLuminosityBlock(const edm::LuminosityBlock& iLumi,
                                         const edm::EventSetup& iSetup)
@@ -102,6 +146,12 @@ MetaTreeGenerator::beginLuminosityBlock(const edm::LuminosityBlock& iLumi,
   lumiBranch = iLumi.luminosityBlock();
   neventsBranch = 0;
   summedWeightsBranch = 0.;
+
+  for(size_t i = 0; i < candidateCounts.size(); ++i)
+    {
+      evaluatedAtLumiStart[i] = candidateCounts[i]->evaluated;
+      rejectedAtLumiStart[i] = candidateCounts[i]->rejected;
+    }
 }
 
 
@@ -109,6 +159,15 @@ void
 MetaTreeGenerator::endLuminosityBlock(const edm::LuminosityBlock& iLumi,
                                       const edm::EventSetup& iSetup)
 {
+  if(!candidateCountBranchesAdded)
+    addCandidateCountBranches();
+
+  for(size_t i = 0; i < candidateCounts.size(); ++i)
+    {
+      evaluatedBranches[i] = candidateCounts[i]->evaluated - evaluatedAtLumiStart[i];
+      rejectedBranches[i] = candidateCounts[i]->rejected - rejectedAtLumiStart[i];
+    }
+
   tree->Fill();
 }
 
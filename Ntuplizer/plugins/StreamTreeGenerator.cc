@@ -0,0 +1,381 @@
+/////////////////////////////////////////////////////////////////////////////
+//                                                                         //
+//    StreamTreeGenerator                                                  //
+//                                                                         //
+//    Multithreaded version of the TreeGenerator. Each stream fills its    //
+//    own in-memory tree, and at the end of each luminosity block the      //
+//    stream trees are merged into the output tree and emptied.            //
+//                                                                         //
+/////////////////////////////////////////////////////////////////////////////
+
+
+//STL
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <map>
+#include <string>
+#include <algorithm>
+
+// CMSSW
+#include "FWCore/Framework/interface/Frameworkfwd.h"
+#include "FWCore/Framework/interface/stream/EDAnalyzer.h"
+#include "FWCore/Framework/interface/Event.h"
+#include "FWCore/Framework/interface/LuminosityBlock.h"
+
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/MessageLogger/interface/MessageLogger.h"
+
+#include "FWCore/ServiceRegistry/interface/Service.h"
+#include "CommonTools/UtilAlgos/interface/TFileService.h"
+
+#include "DataFormats/Provenance/interface/EventID.h"
+#include "DataFormats/Candidate/interface/Candidate.h"
+#include "DataFormats/HepMCCandidate/interface/GenParticle.h"
+
+// ROOT
+#include "TTree.h"
+#include "TBranch.h"
+#include "TBranchElement.h"
+
+// UWVV
+#include "UWVV/Ntuplizer/interface/TreeFiller.h"
+#include "UWVV/DataFormats/interface/DressedGenParticle.h"
+
+
+using namespace uwvv;
+
+namespace
+{
+  // The rows one event put into one of the stream trees
+  struct EventRows
+  {
+    edm::EventID id;
+    TTree* tree;
+    Long64_t first;
+    Long64_t n;
+  };
+
+  // The output tree's branches, each paired with the same branch of one
+  // stream tree, so the output can be pointed at that tree's values
+  // without looking every branch up by name again
+  class BranchAddresses
+  {
+   public:
+    BranchAddresses(TTree* from, TTree* to)
+    {
+      std::map<std::string, TBranch*> toBranches;
+      TObjArray* toList = to->GetListOfBranches();
+      for(int i = 0; i < toList->GetEntriesFast(); ++i)
+        {
+          TBranch* b = static_cast<TBranch*>(toList->UncheckedAt(i));
+          toBranches[b->GetName()] = b;
+        }
+
+      TObjArray* fromList = from->GetListOfBranches();
+      for(int i = 0; i < fromList->GetEntriesFast(); ++i)
+        {
+          TBranch* b = static_cast<TBranch*>(fromList->UncheckedAt(i));
+          auto found = toBranches.find(b->GetName());
+          if(found != toBranches.end())
+            pairs.push_back(std::make_pair(b, found->second));
+        }
+    }
+
+    // Same as from->CopyAddresses(to) for trees whose branches all have
+    // addresses, as the stream trees' branches do
+    void copy() const
+    {
+      for(const auto& p : pairs)
+        {
+          p.second->SetAddress(p.first->GetAddress());
+          // the output doesn't own the stream's values
+          if(p.second->InheritsFrom(TBranchElement::Class()))
+            static_cast<TBranchElement*>(p.second)->ResetDeleteObject();
+        }
+    }
+
+   private:
+    std::vector<std::pair<TBranch*, TBranch*> > pairs;
+  };
+
+  // The output trees of all StreamTreeGenerators are in the TFileService
+  // file, so only one of them writes at a time
+  std::mutex outputFileMutex;
+
+  // Shared by all the streams of one module. Owns the output tree (through
+  // the TFileService)
+  struct StreamTreeMerger
+  {
+    StreamTreeMerger(const edm::ParameterSet& config) :
+      sortEvents(config.getUntrackedParameter<bool>("sortEvents", true)),
+      output(0)
+    {;}
+
+    // If true, the output is in (run, lumi, event) order, so it doesn't
+    // depend on how the events were spread among the streams
+    const bool sortEvents;
+
+    mutable std::mutex mutex;
+    mutable TTree* output;
+    mutable std::map<TTree*, BranchAddresses> addresses;
+  };
+
+  // The rows the streams filled in one luminosity block, handed over at
+  // the end of the block
+  struct LumiRows
+  {
+    mutable std::mutex mutex;
+    mutable std::vector<EventRows> rows;
+  };
+}
+
+
+template<class T>
+class StreamTreeGenerator : public edm::stream::EDAnalyzer<edm::GlobalCache<StreamTreeMerger>,
+                                                           edm::LuminosityBlockCache<LumiRows> >
+{
+ public:
+  StreamTreeGenerator(const edm::ParameterSet&, const StreamTreeMerger*);
+  virtual ~StreamTreeGenerator() {;}
+
+  static std::unique_ptr<StreamTreeMerger>
+    initializeGlobalCache(const edm::ParameterSet& config);
+  static void globalEndJob(const StreamTreeMerger* merger);
+
+  static std::shared_ptr<LumiRows>
+    globalBeginLuminosityBlock(const edm::LuminosityBlock&, const edm::EventSetup&,
+                               const LuminosityBlockContext*);
+  static void globalEndLuminosityBlock(const edm::LuminosityBlock&, const edm::EventSetup&,
+                                       const LuminosityBlockContext* context);
+
+ private:
+  virtual void analyze(edm::Event const& iEvent, edm::EventSetup const& iConfig) override;
+  virtual void endLuminosityBlock(edm::LuminosityBlock const&, edm::EventSetup const&) override;
+  virtual void endStream() override;
+
+  TTree* makeTree() const;
+
+  const std::string ntupleName;
+
+  // Not attached to any file, so filling it doesn't touch the TFileService.
+  // Emptied at the end of each luminosity block, once its rows are merged.
+  std::unique_ptr<TTree> tree;
+  TreeFiller<T> filler;
+
+  std::vector<EventRows> rows;
+};
+
+
+template<class T>
+StreamTreeGenerator<T>::StreamTreeGenerator(const edm::ParameterSet& config,
+                                            const StreamTreeMerger* merger) :
+  ntupleName(config.exists("ntupleName") ?
+             config.getParameter<std::string>("ntupleName") : "ntuple"),
+  tree(makeTree()),
+  filler(config, consumesCollector(), tree.get())
+{
+  // Modules are constructed one at a time, but lock anyway. The first
+  // stream makes the (empty) output tree with the same branches as its own
+  std::lock_guard<std::mutex> lock(merger->mutex);
+  if(!merger->output)
+    {
+      edm::Service<TFileService> FS;
+
+      merger->output = tree->CloneTree(0);
+      merger->output->SetDirectory(FS->getBareDirectory());
+    }
+
+  merger->addresses.emplace(tree.get(), BranchAddresses(tree.get(), merger->output));
+}
+
+
+template<class T>
+std::unique_ptr<StreamTreeMerger>
+StreamTreeGenerator<T>::initializeGlobalCache(const edm::ParameterSet& config)
+{
+  return std::unique_ptr<StreamTreeMerger>(new StreamTreeMerger(config));
+}
+
+
+template<class T>
+std::shared_ptr<LumiRows>
+StreamTreeGenerator<T>::globalBeginLuminosityBlock(const edm::LuminosityBlock&,
+                                                   const edm::EventSetup&,
+                                                   const LuminosityBlockContext*)
+{
+  return std::make_shared<LumiRows>();
+}
+
+
+template<class T>
+TTree* StreamTreeGenerator<T>::makeTree() const
+{
+  TTree* out = new TTree(ntupleName.c_str(), ntupleName.c_str());
+  out->SetDirectory(0);
+
+  return out;
+}
+
+
+template<class T> void
+StreamTreeGenerator<T>::analyze(const edm::Event &event,
+                                const edm::EventSetup &setup)
+{
+  Long64_t first = tree->GetEntries();
+  size_t n = filler.fill(event);
+
+  if(n)
+    rows.push_back(EventRows{event.id(), tree.get(), first, Long64_t(n)});
+}
+
+
+template<class T> void
+StreamTreeGenerator<T>::endLuminosityBlock(const edm::LuminosityBlock&,
+                                           const edm::EventSetup&)
+{
+  const LumiRows* lumiRows = luminosityBlockCache();
+
+  std::lock_guard<std::mutex> lock(lumiRows->mutex);
+  lumiRows->rows.insert(lumiRows->rows.end(), rows.begin(), rows.end());
+  rows.clear();
+}
+
+
+template<class T> void
+StreamTreeGenerator<T>::endStream()
+{
+  const BranchCacheInfo& cache = filler.branchCache();
+  if(cache.enabled())
+    {
+      unsigned long long total = cache.hits() + cache.misses();
+      edm::LogInfo("StreamTreeGenerator")
+        << ntupleName << ": object branch cache for this stream had "
+        << cache.hits() << " hits and " << cache.misses() << " misses ("
+        << (total ? 100. * cache.hits() / total : 0.) << "% hit rate)";
+    }
+}
+
+
+template<class T> void
+StreamTreeGenerator<T>::globalEndLuminosityBlock(const edm::LuminosityBlock&,
+                                                 const edm::EventSetup&,
+                                                 const LuminosityBlockContext* context)
+{
+  const StreamTreeMerger* merger = context->global();
+  std::vector<EventRows>& rows = context->luminosityBlock()->rows;
+
+  if(merger->sortEvents)
+    std::stable_sort(rows.begin(), rows.end(),
+                     [](const EventRows& a, const EventRows& b)
+                     {return a.id < b.id;});
+
+  // All streams are done with this luminosity block and haven't started
+  // the next one, so their trees can be read here. Reading a row puts its
+  // values back where the stream's filler keeps them, so the output is
+  // pointed at those whenever the rows switch to another stream's tree.
+  std::lock_guard<std::mutex> lock(merger->mutex);
+  std::lock_guard<std::mutex> fileLock(outputFileMutex);
+
+  TTree* current = 0;
+  for(const auto& r : rows)
+    {
+      if(r.tree != current)
+        {
+          merger->addresses.at(r.tree).copy();
+          current = r.tree;
+        }
+
+      for(Long64_t i = r.first; i < r.first + r.n; ++i)
+        {
+          r.tree->GetEntry(i);
+          merger->output->Fill();
+        }
+    }
+
+  // Free the rows; the trees keep their branches and addresses
+  for(auto& a : merger->addresses)
+    a.first->Reset();
+
+  rows.clear();
+}
+
+
+template<class T> void
+StreamTreeGenerator<T>::globalEndJob(const StreamTreeMerger* merger)
+{
+  std::lock_guard<std::mutex> lock(merger->mutex);
+
+  merger->output->ResetBranchAddresses();
+}
+
+
+typedef StreamTreeGenerator<CompositeDaughter<CompositeDaughter<pat::Electron, pat::Electron>,
+                                              CompositeDaughter<pat::Electron, pat::Electron>
+                                              >
+                            > StreamTreeGeneratorEEEE;
+typedef StreamTreeGenerator<CompositeDaughter<CompositeDaughter<pat::Electron, pat::Electron>,
+                                              CompositeDaughter<pat::Muon, pat::Muon>
+                                              >
+                            > StreamTreeGeneratorEEMuMu;
+typedef StreamTreeGenerator<CompositeDaughter<CompositeDaughter<pat::Muon, pat::Muon>,
+                                              CompositeDaughter<pat::Muon, pat::Muon>
+                                              >
+                            > StreamTreeGeneratorMuMuMuMu;
+typedef StreamTreeGenerator<CompositeDaughter<CompositeDaughter<pat::Electron, pat::Electron>,
+                                              pat::Electron
+                                              >
+                            > StreamTreeGeneratorEEE;
+typedef StreamTreeGenerator<CompositeDaughter<CompositeDaughter<pat::Muon, pat::Muon>,
+                                              pat::Muon
+                                              >
+                            > StreamTreeGeneratorMuMuMu;
+typedef StreamTreeGenerator<CompositeDaughter<CompositeDaughter<pat::Electron, pat::Electron>,
+                                              pat::Muon
+                                              >
+                            > StreamTreeGeneratorEEMu;
+typedef StreamTreeGenerator<CompositeDaughter<CompositeDaughter<pat::Muon, pat::Muon>,
+                                              pat::Electron
+                                              >
+                            > StreamTreeGeneratorEMuMu;
+typedef StreamTreeGenerator<CompositeDaughter<pat::Electron, pat::Electron> > StreamTreeGeneratorEE;
+typedef StreamTreeGenerator<CompositeDaughter<pat::Muon, pat::Muon> > StreamTreeGeneratorMuMu;
+typedef StreamTreeGenerator<pat::Electron> StreamTreeGeneratorE;
+typedef StreamTreeGenerator<pat::Muon> StreamTreeGeneratorMu;
+
+typedef StreamTreeGenerator<CompositeDaughter<CompositeDaughter<reco::GenParticle, reco::GenParticle>,
+                                              CompositeDaughter<reco::GenParticle, reco::GenParticle>
+                                              >
+                            > StreamGenTreeGeneratorZZ;
+typedef StreamTreeGenerator<CompositeDaughter<CompositeDaughter<reco::GenParticle, reco::GenParticle>,
+                                              reco::GenParticle
+                                              >
+                            > StreamGenTreeGeneratorWZ;
+typedef StreamTreeGenerator<CompositeDaughter<CompositeDaughter<DressedGenParticle, DressedGenParticle>,
+                                              CompositeDaughter<DressedGenParticle, DressedGenParticle>
+                                              >
+                            > StreamGenDressedTreeGeneratorZZ;
+typedef StreamTreeGenerator<CompositeDaughter<CompositeDaughter<DressedGenParticle, DressedGenParticle>,
+                                              DressedGenParticle
+                                              >
+                            > StreamGenDressedTreeGeneratorWZ;
+
+
+#include "FWCore/Framework/interface/MakerMacros.h"
+
+DEFINE_FWK_MODULE(StreamTreeGeneratorEEEE);
+DEFINE_FWK_MODULE(StreamTreeGeneratorEEMuMu);
+DEFINE_FWK_MODULE(StreamTreeGeneratorMuMuMuMu);
+DEFINE_FWK_MODULE(StreamTreeGeneratorEEE);
+DEFINE_FWK_MODULE(StreamTreeGeneratorMuMuMu);
+DEFINE_FWK_MODULE(StreamTreeGeneratorEEMu);
+DEFINE_FWK_MODULE(StreamTreeGeneratorEMuMu);
+DEFINE_FWK_MODULE(StreamTreeGeneratorEE);
+DEFINE_FWK_MODULE(StreamTreeGeneratorMuMu);
+DEFINE_FWK_MODULE(StreamTreeGeneratorE);
+DEFINE_FWK_MODULE(StreamTreeGeneratorMu);
+
+DEFINE_FWK_MODULE(StreamGenTreeGeneratorZZ);
+DEFINE_FWK_MODULE(StreamGenDressedTreeGeneratorWZ);
+DEFINE_FWK_MODULE(StreamGenDressedTreeGeneratorZZ);
+DEFINE_FWK_MODULE(StreamGenTreeGeneratorWZ);
@@ -19,6 +19,7 @@
 #include "FWCore/Framework/interface/Event.h"
 
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/MessageLogger/interface/MessageLogger.h"
 
 #include "FWCore/ServiceRegistry/interface/Service.h"
 #include "CommonTools/UtilAlgos/interface/TFileService.h"
@@ -30,9 +31,7 @@
 #include "TTree.h"
 
 // UWVV
-#include "UWVV/Ntuplizer/interface/BranchManager.h"
-#include "UWVV/Ntuplizer/interface/EventInfo.h"
-#include "UWVV/Ntuplizer/interface/TriggerBranches.h"
+#include "UWVV/Ntuplizer/interface/TreeFiller.h"
 #include "UWVV/DataFormats/interface/DressedGenParticle.h"
 
 
@@ -41,53 +40,31 @@ using namespace uwvv;
 template<class T>
 class TreeGenerator : public edm::one::EDAnalyzer<edm::one::SharedResources>
 {
-  // If this is a particle candidate, we can make branches directly from it
-  // Otherwise, assume it specifies and composite candidate
-  typedef typename std::conditional<std::is_base_of<reco::Candidate, T>::value,
-                                    T, pat::CompositeCandidate>::type Cand;
-
  public:
   explicit TreeGenerator(const edm::ParameterSet&);
   virtual ~TreeGenerator() {;}
 
  private:
   virtual void analyze(edm::Event const& iEvent, edm::EventSetup const& iConfig) override;
+  virtual void endJob() override;
 
   TTree* const makeTree() const;
 
-  const edm::EDGetTokenT<edm::View<Cand> > candToken;
-
   const std::string ntupleName;
 
   TTree* const tree;
-  EventInfo evtInfo;
-
-  std::unique_ptr<BranchManager<T> > branches;
-  std::unique_ptr<TriggerBranches> filterBranches;
-  std::unique_ptr<TriggerBranches> triggerBranches;
+  TreeFiller<T> filler;
 };
 
 
 template<class T>
 TreeGenerator<T>::TreeGenerator(const edm::ParameterSet& config) :
-  candToken(consumes<edm::View<Cand> >(config.getParameter<edm::InputTag>("src"))),
   ntupleName(config.exists("ntupleName") ?
              config.getParameter<std::string>("ntupleName") : "ntuple"),
   tree(makeTree()),
-  evtInfo(consumesCollector(), config.getParameter<edm::ParameterSet>("eventParams"))
+  filler(config, consumesCollector(), tree)
 {
   usesResource("TFileService");
-
-  const edm::ParameterSet& branchParams = config.getParameter<edm::ParameterSet>("branches");
-  branches =
-    std::unique_ptr<BranchManager<T> >(new BranchManager<T>("", tree, branchParams));
-
-  const edm::ParameterSet& triggers = config.getParameter<edm::ParameterSet>("triggers");
-  triggerBranches = std::unique_ptr<TriggerBranches>(new TriggerBranches(consumesCollector(),
-                                                                         triggers, tree));
-  const edm::ParameterSet& filters = config.getParameter<edm::ParameterSet>("filters");
-  filterBranches = std::unique_ptr<TriggerBranches>(new TriggerBranches(consumesCollector(),
-                                                                         filters, tree));
 }
 
 
@@ -104,21 +81,22 @@ template<class T> void
 TreeGenerator<T>::analyze(const edm::Event &event,
                           const edm::EventSetup &setup)
 {
-  edm::Handle<edm::View<Cand> > cands;
-  event.getByToken(candToken, cands);
-
-  evtInfo.setEvent(event);
-  triggerBranches->setEvent(event);
-  filterBranches->setEvent(event);
+  filler.fill(event);
+}
 
-  for(size_t i = 0; i < cands->size(); ++i)
-    {
-      branches->fill(cands->ptrAt(i), evtInfo);
-      triggerBranches->fill();
-      filterBranches->fill();
 
-      tree->Fill();
-    }
+template<class T> void
+TreeGenerator<T>::endJob()
+{
+  const BranchCacheInfo& cache = filler.branchCache();
+  if(!cache.enabled())
+    return;
+
+  unsigned long long total = cache.hits() + cache.misses();
+  edm::LogInfo("TreeGenerator")
+    << ntupleName << ": object branch cache had " << cache.hits()
+    << " hits and " << cache.misses() << " misses ("
+    << (total ? 100. * cache.hits() / total : 0.) << "% hit rate)";
 }
 
 
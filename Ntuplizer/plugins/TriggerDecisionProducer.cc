@@ -0,0 +1,69 @@
+/////////////////////////////////////////////////////////////////////////////
+//                                                                         //
+//    TriggerDecisionProducer                                              //
+//                                                                         //
+//    Works out the trigger (or filter) decisions for one event and puts   //
+//    them in the event as a TriggerDecisions product, so the              //
+//    TreeGenerators don't all have to do it themselves. Configured the    //
+//    same way as their triggers and filters PSets; give the TreeGenerator //
+//    the same PSet with decisionSrc pointing at this module.              //
+//                                                                         //
+/////////////////////////////////////////////////////////////////////////////
+
+
+//STL
+#include <memory>
+
+// CMSSW
+#include "FWCore/Framework/interface/Frameworkfwd.h"
+#include "FWCore/Framework/interface/stream/EDProducer.h"
+#include "FWCore/Framework/interface/Event.h"
+#include "FWCore/Framework/interface/MakerMacros.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+
+// UWVV
+#include "UWVV/Ntuplizer/interface/TriggerBranches.h"
+#include "UWVV/DataFormats/interface/TriggerDecisions.h"
+
+
+using namespace uwvv;
+
+class TriggerDecisionProducer : public edm::stream::EDProducer<>
+{
+ public:
+  explicit TriggerDecisionProducer(const edm::ParameterSet& config);
+  virtual ~TriggerDecisionProducer() {;}
+
+ private:
+  virtual void produce(edm::Event& iEvent, const edm::EventSetup& iSetup);
+
+  // Evaluates the decisions without making any branches
+  TriggerBranches triggers;
+};
+
+
+TriggerDecisionProducer::TriggerDecisionProducer(const edm::ParameterSet& config) :
+  triggers(consumesCollector(), config, 0)
+{
+  if(config.exists("decisionSrc"))
+    throw cms::Exception("BadConfig")
+      << "TriggerDecisionProducer can't take its decisions from another "
+      << "TriggerDecisionProducer (decisionSrc is set)." << std::endl;
+
+  produces<TriggerDecisions>();
+}
+
+
+void TriggerDecisionProducer::produce(edm::Event& iEvent,
+                                      const edm::EventSetup& iSetup)
+{
+  std::unique_ptr<TriggerDecisions> out(new TriggerDecisions(triggers.names()));
+
+  triggers.setEvent(iEvent);
+  triggers.fillDecisions(*out);
+
+  iEvent.put(std::move(out));
+}
+
+
+DEFINE_FWK_MODULE(TriggerDecisionProducer);
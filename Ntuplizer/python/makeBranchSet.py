@@ -192,3 +192,46 @@ def makeGenBranchSet(channel, extraInitialStateBranches=[],
     branchSet.daughterParams = cms.VPSet(z1BranchSet,z2BranchSet)
 
     return branchSet
+
+
+def encodeLHEWeights(lheBranches, encoding, precision=1e-4):
+    '''
+    Return a copy of lheBranches with the raw LHE weight vectors replaced by
+    16-bit encodings of the weights relative to the nominal weight, which
+    is added as lheNominalWeight (weights of events with a zero nominal
+    weight are stored as absolute values). encoding is 'half' (half-precision
+    floats) or 'fixed' (fixed point, with relative weights off by at most
+    precision, which must be at least 1e-6, and is stored in the tree's user
+    info). See UWVV/Utilities/interface/LHEWeightEncoding.h to decode.
+    '''
+    if encoding not in ['half', 'fixed']:
+        raise ValueError("Unknown LHE weight encoding {}".format(encoding))
+
+    out = lheBranches.clone()
+    if not hasattr(out, 'vFloats'):
+        return out
+
+    encoded = {}
+    for name in out.vFloats.parameterNames_():
+        f = getattr(out.vFloats, name).value()
+        if len(f) != 1 or f[0].split('::')[0] != 'lheWeights':
+            continue
+
+        option = f[0].split('::')[1] if '::' in f[0] else '0,1000'
+        if encoding == 'half':
+            encoded[name] = cms.vstring('lheWeightsHalf::' + option)
+        else:
+            if ',' not in option:
+                option = '0,' + option
+            encoded[name] = cms.vstring('lheWeightsFixed::{},{}'.format(option, precision))
+
+    for name in encoded:
+        delattr(out.vFloats, name)
+
+    if encoded:
+        out.vUShorts = cms.PSet(**encoded)
+        if not hasattr(out, 'floats'):
+            out.floats = cms.PSet()
+        out.floats.lheNominalWeight = cms.string('lheNominalWeight')
+
+    return out
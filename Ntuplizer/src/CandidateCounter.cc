@@ -0,0 +1,30 @@
+#include "UWVV/Ntuplizer/interface/CandidateCounter.h"
+
+
+using namespace uwvv;
+
+
+std::mutex CandidateCounter::mutex_;
+std::map<std::string, std::shared_ptr<CandidateCounts> > CandidateCounter::counts_;
+
+
+std::shared_ptr<CandidateCounts>
+CandidateCounter::get(const std::string& label)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  std::shared_ptr<CandidateCounts>& out = counts_[label];
+  if(!out)
+    out = std::make_shared<CandidateCounts>();
+
+  return out;
+}
+
+
+std::map<std::string, std::shared_ptr<CandidateCounts> >
+CandidateCounter::all()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  return counts_;
+}
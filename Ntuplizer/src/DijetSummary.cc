@@ -0,0 +1,71 @@
+#include "UWVV/Ntuplizer/interface/DijetSummary.h"
+#include "UWVV/Utilities/interface/helpers.h"
+#include "UWVV/DataFormats/interface/JetVariations.h"
+
+
+using namespace uwvv;
+
+DijetSummary::DijetSummary(const pat::CompositeCandidate& cand,
+                           const std::string& variation) :
+  nJets(0),
+  j1Rapidity(-999.),
+  j2Rapidity(-999.),
+  j3Rapidity(-999.)
+{
+  const edm::PtrVector<pat::Jet>* jets = helpers::getCleanedJetCollection(cand, variation);
+
+  nJets = jets->size();
+
+  pt.reserve(nJets);
+  eta.reserve(nJets);
+  phi.reserve(nJets);
+  rapidity.reserve(nJets);
+  csvV2.reserve(nJets);
+  cmvaV2.reserve(nJets);
+  hadronFlavor.reserve(nJets);
+  puID.reserve(nJets);
+
+  // Jets from the overlay format (see PATJetSmearing) are nominal and
+  // carry their variations with them; shifted jet collections are already
+  // varied
+  const JetVariations::Variation v = JetVariations::variation(variation);
+  std::vector<math::XYZTLorentzVector> p4s;
+  p4s.reserve(nJets);
+
+  for(const auto& jet : *jets)
+    {
+      if(v != JetVariations::NONE && jet->hasUserData("jetVariations"))
+        p4s.push_back(jet->userData<JetVariations>("jetVariations")->p4(*jet, v));
+      else
+        p4s.push_back(jet->p4());
+
+      const math::XYZTLorentzVector& p4 = p4s.back();
+      pt.push_back(p4.pt());
+      eta.push_back(p4.eta());
+      phi.push_back(p4.phi());
+      rapidity.push_back(p4.Rapidity());
+
+      if(jet->hasUserFloat("qgLikelihood"))
+        qgLikelihood.push_back(jet->userFloat("qgLikelihood"));
+
+      csvV2.push_back(jet->bDiscriminator("pfCombinedInclusiveSecondaryVertexV2BJetTags"));
+      cmvaV2.push_back(jet->bDiscriminator("pfCombinedMVAV2BJetTags"));
+      hadronFlavor.push_back(jet->hadronFlavour());
+
+      int id = -999;
+      if(jet->hasUserInt("pileupJetIdUpdated:fullId"))
+        id = jet->userInt("pileupJetIdUpdated:fullId");
+      puID.push_back(id);
+    }
+
+  if(nJets >= 2)
+    {
+      j1P4 = p4s[0];
+      j2P4 = p4s[1];
+      dijetP4 = j1P4 + j2P4;
+      j1Rapidity = p4s[0].Rapidity();
+      j2Rapidity = p4s[1].Rapidity();
+    }
+  if(nJets >= 3)
+    j3Rapidity = p4s[2].Rapidity();
+}
@@ -1,4 +1,7 @@
 #include "UWVV/Ntuplizer/interface/EventInfo.h"
+#include "UWVV/Utilities/interface/helpers.h"
+
+#include <algorithm>
 
 
 using namespace uwvv;
@@ -120,5 +123,85 @@ void EventInfo::setEvent(const edm::Event& event)
   initialStates_.setEvent(event);
   genInitialStates_.setEvent(event);
 
+  // invalidate memoized branch values and cleaned jets from the last event
+  branchCache_.newEvent();
+  cleanedGenJets_.clear();
+  dijetSummaries_.clear();
+
   currentEvent_ = &event;
 }
+
+
+const std::vector<const reco::GenJet*>&
+EventInfo::cleanedGenJets(const reco::Candidate& cand,
+                          const std::string& collection)
+{
+  auto key = std::make_pair(&cand, collection);
+  auto found = cleanedGenJets_.find(key);
+  if(found != cleanedGenJets_.end())
+    return found->second;
+
+  std::vector<const reco::GenJet*>& out = cleanedGenJets_[key];
+
+  const edm::Handle<edm::View<reco::GenJet> >& jets = genJets(collection);
+  for(size_t i = 0; i < jets->size(); ++i)
+    {
+      if(!helpers::overlapWithAnyDaughter(jets->at(i), cand, 0.4))
+        out.push_back(&jets->at(i));
+    }
+
+  return out;
+}
+
+
+const DijetSummary&
+EventInfo::dijetSummary(const pat::CompositeCandidate& cand,
+                        const std::string& variation)
+{
+  auto key = std::make_pair(&cand, variation);
+  auto found = dijetSummaries_.find(key);
+  if(found != dijetSummaries_.end())
+    return found->second;
+
+  return dijetSummaries_.emplace(key, DijetSummary(cand, variation)).first->second;
+}
+
+
+const LHEWeightSummary&
+EventInfo::lheWeights(unsigned long first, unsigned long last)
+{
+  LHEWeightSummary& out = lheWeightSummaries_[std::make_pair(first, last)];
+  if(out.generation == branchCache_.generation())
+    return out;
+
+  const edm::Handle<LHEEventProduct>& lhe = lheEventInfo();
+  if(!lhe.isValid())
+    throw cms::Exception("ProductNotFound")
+      << "Unable to open LHE event information";
+
+  const auto& weights = lhe->weights();
+
+  out.weights.clear();
+  out.nominal = lhe->originalXWGTUP();
+  out.min = 999.;
+  out.max = -999.;
+  out.sum = 0.;
+
+  const unsigned long end = std::min<unsigned long>(last, weights.size());
+  for(unsigned long i = first; i < end; ++i)
+    {
+      const float w = weights[i].wgt;
+      out.weights.push_back(w);
+      out.sum += w;
+
+      if(i == 5 || i == 7) // some scale weights don't count, apparently
+        continue;
+
+      out.min = std::min(out.min, w);
+      out.max = std::max(out.max, w);
+    }
+
+  out.generation = branchCache_.generation();
+
+  return out;
+}
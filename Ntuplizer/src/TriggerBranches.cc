@@ -1,5 +1,10 @@
 #include "UWVV/Ntuplizer/interface/TriggerBranches.h"
 
+#include <algorithm>
+
+#include "TDirectory.h"
+#include "TNamed.h"
+#include "TList.h"
 
 
 using namespace uwvv;
@@ -13,7 +18,9 @@ TriggerBranch::TriggerBranch(const std::string& name,
                              bool ignoreMissing) :
   name(name),
   checkPrescale(checkPrescale),
-  ignoreMissing(ignoreMissing)
+  ignoreMissing(ignoreMissing),
+  pass(false),
+  prescale(1)
 {
   if(!pathExps.size())
     throw cms::Exception("BadTriggerPath")
@@ -22,6 +29,9 @@ TriggerBranch::TriggerBranch(const std::string& name,
   for(auto& expr : pathExps)
     paths.push_back(TriggerPathInfo(expr, ignoreMissing));
   
+  if(!tree)
+    return;
+
   tree->Branch((name+"Pass").c_str(), &pass);
   if(checkPrescale)
     tree->Branch((name+"Prescale").c_str(), &prescale);
@@ -74,31 +84,108 @@ void TriggerBranch::fill(const edm::TriggerResults& results,
 TriggerBranches::TriggerBranches(edm::ConsumesCollector cc, 
                                  const edm::ParameterSet& config,
                                  TTree* const tree) :
-  resultsToken(cc.consumes<edm::TriggerResults>(config.getParameter<edm::InputTag>("trigResultsSrc"))),
-  prescalesToken(cc.consumes<pat::PackedTriggerPrescales>(config.exists("trigPrescaleSrc") ?
-                                                          config.getParameter<edm::InputTag>("trigPrescaleSrc") :
-                                                          edm::InputTag("patTrigger"))),
+  names_(config.getParameter<std::vector<std::string> >("trigNames")),
+  namesHash(TriggerDecisions::hashNames(names_)),
+  useDecisions(config.existsAs<edm::InputTag>("decisionSrc")),
   isValid(false),
   checkPrescale(config.exists("checkPrescale") ?
                 config.getParameter<bool>("checkPrescale") :
-                true)
+                true),
+  packed(tree && config.existsAs<std::string>("packedBranch") &&
+         !names_.empty()),
+  tree(tree),
+  prescaleTree(0),
+  prescalesWritten(false),
+  run(0),
+  lumi(0),
+  firstRow(0)
 {
-  std::vector<std::string> names = 
-    config.getParameter<std::vector<std::string> >("trigNames");
+  if(useDecisions)
+    decisionsToken = cc.consumes<TriggerDecisions>(config.getParameter<edm::InputTag>("decisionSrc"));
+  else
+    {
+      resultsToken = cc.consumes<edm::TriggerResults>(config.getParameter<edm::InputTag>("trigResultsSrc"));
+      prescalesToken = cc.consumes<pat::PackedTriggerPrescales>(config.exists("trigPrescaleSrc") ?
+                                                                config.getParameter<edm::InputTag>("trigPrescaleSrc") :
+                                                                edm::InputTag("patTrigger"));
+    }
+
   bool ignoreMissing(config.getUntrackedParameter<bool>("ignoreMissing", false));
   
-  for(auto& name : names)
+  for(auto& name : names_)
     {
       std::vector<std::string> paths = 
         config.getParameter<std::vector<std::string> >(name + "Paths");
       
-      branches[name] = std::unique_ptr<TriggerBranch>(new TriggerBranch(name, paths, tree, checkPrescale, ignoreMissing));
+      branches.push_back(std::unique_ptr<TriggerBranch>(new TriggerBranch(name, paths, packed ? 0 : tree, checkPrescale, ignoreMissing)));
+    }
+
+  if(packed)
+    setupPacked(config.getParameter<std::string>("packedBranch"));
+}
+
+
+void TriggerBranches::setupPacked(const std::string& branchName)
+{
+  // sized once, so the branch addresses stay put
+  packedBits.assign((names_.size() + 63) / 64, 0);
+  tree->Branch(branchName.c_str(), packedBits.data(),
+               (branchName + "[" + std::to_string(packedBits.size()) + "]/l").c_str());
+
+  std::string dictionary;
+  for(const auto& name : names_)
+    dictionary += (dictionary.empty() ? "" : ",") + name;
+  tree->GetUserInfo()->Add(new TNamed(branchName.c_str(), dictionary.c_str()));
+
+  if(!checkPrescale)
+    return;
+
+  packedPrescales.assign(names_.size(), 1);
+  const std::string prescaleName = branchName + "Prescales";
+  const std::string prescaleLeaves = prescaleName + "[" + std::to_string(names_.size()) + "]/i";
+
+  TDirectory* dir = tree->GetDirectory();
+  if(!dir)
+    {
+      tree->Branch(prescaleName.c_str(), packedPrescales.data(),
+                   prescaleLeaves.c_str());
+      return;
     }
+
+  TDirectory::TContext context(dir);
+  prescaleTree = new TTree(prescaleName.c_str(), prescaleName.c_str());
+  prescaleTree->Branch("run", &run);
+  prescaleTree->Branch("lumi", &lumi);
+  prescaleTree->Branch("firstRow", &firstRow);
+  prescaleTree->Branch(prescaleName.c_str(), packedPrescales.data(),
+                       prescaleLeaves.c_str());
 }
 
 
 void TriggerBranches::setEvent(const edm::Event& event)
 {
+  if(prescaleTree)
+    {
+      run = event.id().run();
+      lumi = event.id().luminosityBlock();
+      firstRow = tree->GetEntries();
+    }
+
+  if(useDecisions)
+    {
+      event.getByToken(decisionsToken, decisions);
+
+      if(decisions->size() != names_.size() ||
+         decisions->namesHash() != namesHash)
+        throw cms::Exception("InvalidTriggerDecisions")
+          << "ERROR: trigger decisions were made for a different list of "
+          << "trigger names." << std::endl;
+
+      isValid = true;
+      evaluate();
+      return;
+    }
+
   event.getByToken(resultsToken, results);
   if(checkPrescale)
     event.getByToken(prescalesToken, prescales);
@@ -110,20 +197,65 @@ void TriggerBranches::setEvent(const edm::Event& event)
       id = names.parameterSetID();
 
       for(auto& b : branches)
-        b.second->setup(names);
+        b->setup(names);
 
       isValid = true;
     }
+
+  evaluate();
 }
 
 
-void TriggerBranches::fill()
+void TriggerBranches::evaluate()
 {
   if(!isValid)
     throw cms::Exception("UninitializedTriggerBranches")
       << "ERROR: attempt to use uninitialized TriggerBranches object."
       << std::endl;
 
-  for(auto& b : branches)
-    b.second->fill(*results, *prescales);
+  if(useDecisions)
+    {
+      for(size_t i = 0; i < branches.size(); ++i)
+        branches[i]->fill(decisions->pass(i), decisions->prescale(i));
+    }
+  else
+    {
+      for(auto& b : branches)
+        b->fill(*results, *prescales);
+    }
+
+  if(packed)
+    pack();
+}
+
+
+void TriggerBranches::pack()
+{
+  std::fill(packedBits.begin(), packedBits.end(), 0);
+
+  bool prescalesChanged = !prescalesWritten;
+  for(size_t i = 0; i < branches.size(); ++i)
+    {
+      if(branches[i]->passed())
+        packedBits[i / 64] |= (ULong64_t(1) << (i % 64));
+
+      if(checkPrescale && packedPrescales[i] != branches[i]->getPrescale())
+        {
+          packedPrescales[i] = branches[i]->getPrescale();
+          prescalesChanged = true;
+        }
+    }
+
+  if(prescaleTree && prescalesChanged)
+    {
+      prescaleTree->Fill();
+      prescalesWritten = true;
+    }
+}
+
+
+void TriggerBranches::fillDecisions(TriggerDecisions& out) const
+{
+  for(size_t i = 0; i < branches.size(); ++i)
+    out.set(i, branches[i]->passed(), branches[i]->getPrescale());
 }
@@ -0,0 +1,51 @@
+#include "UWVV/Ntuplizer/interface/TriggerMenuCache.h"
+
+
+using namespace uwvv;
+
+
+std::mutex TriggerMenuCache::mutex_;
+std::unordered_map<std::string, TriggerMenuCache::Match> TriggerMenuCache::matches_;
+
+
+TriggerMenuCache::Match
+TriggerMenuCache::find(const edm::TriggerNames& names,
+                       const TriggerPathMatcher& matcher)
+{
+  // compact form is fixed-length, so no separator is needed
+  const std::string key = names.parameterSetID().compactForm() + matcher.expression();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto found = matches_.find(key);
+  if(found != matches_.end())
+    return found->second;
+
+  Match match = scan(names, matcher);
+  matches_.insert(std::make_pair(key, match));
+
+  return match;
+}
+
+
+TriggerMenuCache::Match
+TriggerMenuCache::scan(const edm::TriggerNames& names,
+                       const TriggerPathMatcher& matcher)
+{
+  Match match = {names.size(), names.size()};
+
+  for(size_t i = 0; i < names.size(); ++i)
+    {
+      if(matcher.match(names.triggerName(i)))
+        {
+          if(match.bit != names.size())
+            {
+              match.duplicate = i;
+              break;
+            }
+          match.bit = i;
+        }
+    }
+
+  return match;
+}
@@ -1,12 +1,13 @@
 #include "UWVV/Ntuplizer/interface/TriggerPathInfo.h"
 
-#include <regex>
+#include "UWVV/Ntuplizer/interface/TriggerMenuCache.h"
 
 using namespace uwvv;
 
 
 TriggerPathInfo::TriggerPathInfo(const std::string& nameExp, bool ignoreMissing) : 
   nameExp_(nameExp),
+  matcher_(nameExp),
   name_(nameExp),
   bit_(999),
   isValid_(false),
@@ -17,23 +18,19 @@ TriggerPathInfo::TriggerPathInfo(const std::string& nameExp, bool ignoreMissing)
 void TriggerPathInfo::setup(const edm::TriggerNames& names)
 {
   isValid_ = false;
-  std::regex re(nameExp_);
-  bit_ = names.size();
-  for(size_t i = 0; i < names.size(); ++i)
-    {
-      if(std::regex_match(names.triggerName(i), re))
-        {
-          // There can be only one
-          if(bit_ != names.size())
-            throw cms::Exception("BadTriggerExpression")
-              << "Two path matched trigger path expression \""
-              << nameExp_ << "\" (\"" << names.triggerName(bit_)
-              << "\" and \"" << names.triggerName(i) << "\")" 
-              << std::endl;
-          bit_ = i;
-          name_ = names.triggerName(i);
-        }
-    }
+  const TriggerMenuCache::Match match = TriggerMenuCache::find(names, matcher_);
+
+  // There can be only one
+  if(match.duplicate != names.size())
+    throw cms::Exception("BadTriggerExpression")
+      << "Two path matched trigger path expression \""
+      << nameExp_ << "\" (\"" << names.triggerName(match.bit)
+      << "\" and \"" << names.triggerName(match.duplicate) << "\")" 
+      << std::endl;
+
+  bit_ = match.bit;
+  if(bit_ != names.size())
+    name_ = names.triggerName(bit_);
 
   // No match!
   if(bit_ == names.size())
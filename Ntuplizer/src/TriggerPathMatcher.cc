@@ -0,0 +1,91 @@
+#include "UWVV/Ntuplizer/interface/TriggerPathMatcher.h"
+
+#include <cstring>
+
+using namespace uwvv;
+
+
+namespace
+{
+  // Trailing version wildcards we can handle without a regex
+  struct Wildcard
+  {
+    const char* pattern;
+    bool digits;
+    size_t minDigits;
+  };
+
+  const Wildcard wildcards[] = {
+    {"[0-9]+", true, 1},
+    {"\\d+", true, 1},
+    {"[0-9]*", true, 0},
+    {"\\d*", true, 0},
+    {".*", false, 0},
+  };
+
+  bool isLiteral(const std::string& str)
+  {
+    return str.find_first_of("\\^$.|?*+()[]{}") == std::string::npos;
+  }
+
+  bool endsWith(const std::string& str, const char* suffix)
+  {
+    const size_t len = std::strlen(suffix);
+    return str.size() >= len && !str.compare(str.size() - len, len, suffix);
+  }
+}
+
+
+TriggerPathMatcher::TriggerPathMatcher(const std::string& expression) :
+  expression_(expression),
+  kind_(LITERAL),
+  prefix_(expression),
+  minDigits_(0)
+{
+  for(const auto& w : wildcards)
+    {
+      if(endsWith(expression_, w.pattern))
+        {
+          kind_ = w.digits ? DIGITS : ANY;
+          minDigits_ = w.minDigits;
+          prefix_ = expression_.substr(0, expression_.size() - std::strlen(w.pattern));
+          break;
+        }
+    }
+
+  if(!isLiteral(prefix_))
+    {
+      kind_ = REGEX;
+      prefix_.clear();
+      regex_ = std::make_shared<const std::regex>(expression_);
+    }
+}
+
+
+bool TriggerPathMatcher::match(const std::string& name) const
+{
+  switch(kind_)
+    {
+    case LITERAL:
+      return name == prefix_;
+    case REGEX:
+      return std::regex_match(name, *regex_);
+    default:
+      break;
+    }
+
+  if(name.size() < prefix_.size() + minDigits_ ||
+     name.compare(0, prefix_.size(), prefix_))
+    return false;
+
+  if(kind_ == ANY)
+    return true;
+
+  for(size_t i = prefix_.size(); i < name.size(); ++i)
+    {
+      if(name[i] < '0' || name[i] > '9')
+        return false;
+    }
+
+  return true;
+}
@@ -6,7 +6,8 @@ import FWCore.ParameterSet.Types as CfgTypes
 from UWVV.AnalysisTools.analysisFlowMaker import createFlow
 
 from UWVV.Utilities.helpers import parseChannels, expandChannelName, pset2Dict, dict2PSet 
-from UWVV.Ntuplizer.makeBranchSet import makeBranchSet, makeGenBranchSet
+from UWVV.Ntuplizer.makeBranchSet import makeBranchSet, makeGenBranchSet, \
+    encodeLHEWeights
 from UWVV.Ntuplizer.eventParams import makeEventParams, makeGenEventParams
 
 import os
@@ -96,6 +97,60 @@ options.register('datasetName', '',
                  VarParsing.VarParsing.multiplicity.singleton,
                  VarParsing.VarParsing.varType.string,
                  "dataset name")
+options.register('cacheObjectBranches', 0,
+                 VarParsing.VarParsing.multiplicity.singleton,
+                 VarParsing.VarParsing.varType.int,
+                 "Set nonzero to compute lepton and Z branches once per "
+                 "event instead of once per candidate.")
+options.register('nThreads', 1,
+                 VarParsing.VarParsing.multiplicity.singleton,
+                 VarParsing.VarParsing.varType.int,
+                 "Number of threads. If more than 1, the ntuples are made "
+                 "with the multithreaded StreamTreeGenerators.")
+options.register('fuseEmbedders', 0,
+                 VarParsing.VarParsing.multiplicity.singleton,
+                 VarParsing.VarParsing.varType.int,
+                 "Set nonzero to merge consecutive embedder modules into "
+                 "one embedder chain module, so the collection is copied "
+                 "once instead of once per embedder.")
+options.register('jetVariationOverlay', 0,
+                 VarParsing.VarParsing.multiplicity.singleton,
+                 VarParsing.VarParsing.varType.int,
+                 "Set nonzero to store jet energy scale and resolution "
+                 "shifts as scale factors embedded in the nominal jets "
+                 "instead of as four extra jet collections.")
+options.register('shareTriggerDecisions', 0,
+                 VarParsing.VarParsing.multiplicity.singleton,
+                 VarParsing.VarParsing.varType.int,
+                 "Set nonzero to work out the trigger and filter decisions "
+                 "once per event in a TriggerDecisionProducer instead of "
+                 "in every channel's tree generator.")
+options.register('packTriggerBits', 0,
+                 VarParsing.VarParsing.multiplicity.singleton,
+                 VarParsing.VarParsing.varType.int,
+                 "Set nonzero to write the trigger and filter decisions as "
+                 "packed bits (triggerBits and filterBits branches) instead "
+                 "of one branch per trigger, with prescales in a separate "
+                 "tree only when they change.")
+options.register('eventTree', 0,
+                 VarParsing.VarParsing.multiplicity.singleton,
+                 VarParsing.VarParsing.varType.int,
+                 "Set nonzero to write event-level branches (event ID, "
+                 "vertex, MET, weights, triggers and filters) once per "
+                 "event in a shared events tree, with only an index into it "
+                 "in each channel's ntuple.")
+options.register('lheWeightEncoding', '',
+                 VarParsing.VarParsing.multiplicity.singleton,
+                 VarParsing.VarParsing.varType.string,
+                 "If 'half' or 'fixed', store LHE weights as 16-bit "
+                 "half floats or fixed point numbers relative to the "
+                 "nominal weight (lheNominalWeight branch) instead of as "
+                 "floats.")
+options.register('lheWeightPrecision', 1e-4,
+                 VarParsing.VarParsing.multiplicity.singleton,
+                 VarParsing.VarParsing.varType.float,
+                 "Largest error on the relative LHE weights with "
+                 "lheWeightEncoding=fixed. Default 1e-4.")
 
 options.parseArguments()
 
@@ -118,6 +173,14 @@ if options.genLeptonType not in genLepChoices:
     exit(1)
 
 channels = parseChannels(options.channels)
+
+# Multithreaded ntuplizers fill one tree per stream and merge them at the end
+# of each luminosity block
+treeGeneratorPrefix = ''
+if options.nThreads > 1:
+    process.options.numberOfThreads = cms.untracked.uint32(options.nThreads)
+    treeGeneratorPrefix = 'Stream'
+
 zz = any(len(c) == 4 for c in channels)
 zl = any(len(c) == 3 for c in channels)
 wz = "wz" in options.channels 
@@ -262,15 +325,23 @@ if options.isMC:
     from UWVV.Ntuplizer.templates.eventBranches import jetSystematicBranches
     extraInitialStateBranches.append(jetSystematicBranches)
 
+    lheBranches = None
     if options.lheWeights == 1:
         from UWVV.Ntuplizer.templates.eventBranches import lheScaleWeightBranches
-        extraInitialStateBranches.append(lheScaleWeightBranches)
+        lheBranches = lheScaleWeightBranches
     elif options.lheWeights == 2:
         from UWVV.Ntuplizer.templates.eventBranches import lheScaleAndPDFWeightBranches
-        extraInitialStateBranches.append(lheScaleAndPDFWeightBranches)
+        lheBranches = lheScaleAndPDFWeightBranches
     elif options.lheWeights >= 3:
         from UWVV.Ntuplizer.templates.eventBranches import lheAllWeightBranches
-        extraInitialStateBranches.append(lheAllWeightBranches)
+        lheBranches = lheAllWeightBranches
+
+    if lheBranches is not None:
+        if options.lheWeightEncoding:
+            lheBranches = encodeLHEWeights(lheBranches,
+                                           options.lheWeightEncoding,
+                                           options.lheWeightPrecision)
+        extraInitialStateBranches.append(lheBranches)
 
     from UWVV.Ntuplizer.templates.eventBranches import eventGenBranches
     extraInitialStateBranches.append(eventGenBranches)
@@ -366,6 +437,9 @@ flowOpts = {
     'electronRhoResShift' : options.eRhoResShift,
     'electronPhiResShift' : options.ePhiResShift,
     'muonClosureShift' : options.mClosureShift,
+
+    'fuseEmbedders' : bool(options.fuseEmbedders),
+    'jetVariationOverlay' : bool(options.jetVariationOverlay),
     }
 
 # Turn all these into a single flow class
@@ -415,24 +489,77 @@ else:
     from UWVV.Ntuplizer.templates.filterBranches import metAndBadMuonFilters
     filterBranches = metAndBadMuonFilters
 
+if options.packTriggerBits:
+    trgBranches = trgBranches.clone(packedBranch=cms.string('triggerBits'))
+    filterBranches = filterBranches.clone(packedBranch=cms.string('filterBits'))
+
 process.treeSequence = cms.Sequence()
+
+# Trigger and filter decisions, once for all the ntuples if desired
+if options.shareTriggerDecisions:
+    process.triggerDecisions = cms.EDProducer('TriggerDecisionProducer',
+                                              trgBranches)
+    process.filterDecisions = cms.EDProducer('TriggerDecisionProducer',
+                                             filterBranches)
+    process.treeSequence += process.triggerDecisions
+    process.treeSequence += process.filterDecisions
+
+    trgBranches = trgBranches.clone(decisionSrc=cms.InputTag('triggerDecisions'))
+    filterBranches = filterBranches.clone(decisionSrc=cms.InputTag('filterDecisions'))
+
+def withoutTriggers(trg):
+    out = trg.clone(trigNames=cms.vstring())
+    if hasattr(out, 'decisionSrc'):
+        del out.decisionSrc
+    return out
+
+metSrc = 'slimmedMETs::PAT' if options.isMC else 'slimmedMETsMuEGClean::PAT'
+
+chanBranches = {}
+for chan in channels:
+    chanBranches[chan] = makeBranchSet(chan, extraInitialStateBranches,
+                                       extraIntermediateStateBranches,
+                                       **extraFinalObjectBranches)
+
+# event-level branches, triggers, and filters once per event if desired
+chanTrg = trgBranches
+chanFilters = filterBranches
+if options.eventTree:
+    # The events tree keeps only the event-level branches of what it's
+    # given, and the channel trees leave theirs out. The event-level
+    # branches should be the same for all channels; each channel's tree
+    # checks its own against the events tree's on every event.
+    eventTreeBranches = chanBranches[channels[0]].clone()
+    for daughterParam in ['daughterParams', 'daughterNames']:
+        if hasattr(eventTreeBranches, daughterParam):
+            delattr(eventTreeBranches, daughterParam)
+
+    process.events = cms.EDProducer(
+        'EventTreeGenerator',
+        branches = eventTreeBranches,
+        eventParams = makeEventParams(flow.finalTags(), metSrc=metSrc),
+        triggers = trgBranches,
+        filters = filterBranches,
+        candSrcs = cms.VInputTag(*[flow.finalObjTag(chan) for chan in channels]),
+        )
+    process.treeSequence += process.events
+
+    chanTrg = withoutTriggers(trgBranches)
+    chanFilters = withoutTriggers(filterBranches)
+
 # then the ntuples
 for chan in channels:
     mod = cms.EDAnalyzer(
-        'TreeGenerator{}'.format(expandChannelName(chan)),
+        '{}TreeGenerator{}'.format(treeGeneratorPrefix, expandChannelName(chan)),
         src = flow.finalObjTag(chan),
-        branches = makeBranchSet(chan, extraInitialStateBranches,
-                                 extraIntermediateStateBranches,
-                                 **extraFinalObjectBranches),
-        eventParams = makeEventParams(flow.finalTags(), chan, 
-            metSrc='slimmedMETsMuEGClean::PAT',
-            ) if not options.isMC else \
-            makeEventParams(flow.finalTags(), chan,
-                metSrc='slimmedMETs::PAT',
-            ),
-        triggers = trgBranches,
-        filters = filterBranches,
+        branches = chanBranches[chan],
+        eventParams = makeEventParams(flow.finalTags(), chan, metSrc=metSrc),
+        triggers = chanTrg,
+        filters = chanFilters,
+        cacheObjectBranches = cms.untracked.bool(bool(options.cacheObjectBranches)),
     )
+    if options.eventTree:
+        mod.eventTree = cms.string('events')
 
     setattr(process, chan, mod)
     process.treeSequence += mod
@@ -456,15 +583,11 @@ if zz and options.isMC and options.genInfo:
                     pfCands='packedGenParticles',
                     leptonStatusFlag=genLepChoices[options.genLeptonType])
 
-    genTrg = trgBranches.clone(trigNames=cms.vstring())
+    genTrg = withoutTriggers(trgBranches)
 
     extraInitialStateBranchesGen = [vbsGenBranches]
-    if options.lheWeights == 1:
-        extraInitialStateBranchesGen.append(lheScaleWeightBranches)
-    elif options.lheWeights == 2:
-        extraInitialStateBranchesGen.append(lheScaleAndPDFWeightBranches)
-    elif options.lheWeights >= 3:
-        extraInitialStateBranchesGen.append(lheAllWeightBranches)
+    if options.lheWeights:
+        extraInitialStateBranchesGen.append(lheBranches)
 
     extraIntermediateStateBranchesGen = []
 
@@ -485,7 +608,7 @@ if zz and options.isMC and options.genInfo:
                                            extraInitialStateBranches=extraInitialStateBranchesGen,
                                            extraIntermediateStateBranches=extraIntermediateStateBranchesGen)
         genMod = cms.EDAnalyzer(
-            'GenTreeGeneratorZZ',
+            treeGeneratorPrefix+'GenTreeGeneratorZZ',
             src = genFlow.finalObjTag(chan),
             branches = genBranches,
             eventParams = makeGenEventParams(genFlow.finalTags()),
@@ -0,0 +1,85 @@
+#ifndef UWVV_Utilities_EtaPhiGrid_h
+#define UWVV_Utilities_EtaPhiGrid_h
+
+
+#include <vector>
+#include <cstddef>
+
+
+namespace uwvv
+{
+
+  // Uniform grid of object indices binned in eta and phi, for finding the
+  // objects near a point without looping over all of them. Phi wraps
+  // around; objects beyond +/-maxEta go in the outermost eta bins.
+  //
+  // Usage: clear() at the start of each event, add() the objects (by their
+  // index in whatever collection they come from), then forEachNear() calls
+  // a function on the index of every object that might be within dR of the
+  // point. The caller still has to check the actual deltaR.
+  class EtaPhiGrid
+  {
+   public:
+    // Cells are at least cellSize wide in both directions
+    EtaPhiGrid(float cellSize, float maxEta = 5.);
+    ~EtaPhiGrid() {;}
+
+    // Remove all objects (the memory is kept for the next event)
+    void clear();
+
+    void add(size_t index, float eta, float phi);
+
+    size_t size() const {return nObjects;}
+
+    template<class F>
+      void forEachNear(float eta, float phi, float dR, F f) const;
+
+   private:
+    int etaBin(float eta) const;
+    int phiBin(float phi) const; // not wrapped
+
+    const float maxEta;
+    const int nEta;
+    const float etaWidth;
+    const int nPhi;
+    const float phiWidth;
+
+    std::vector<std::vector<size_t> > cells;
+    size_t nObjects;
+  };
+
+
+  template<class F>
+  void
+  EtaPhiGrid::forEachNear(float eta, float phi, float dR, F f) const
+  {
+    if(!nObjects)
+      return;
+
+    const int etaLow = etaBin(eta - dR);
+    const int etaHigh = etaBin(eta + dR);
+
+    int phiLow = phiBin(phi - dR);
+    int phiHigh = phiBin(phi + dR);
+    // don't visit any column twice
+    if(phiHigh - phiLow >= nPhi)
+      {
+        phiLow = 0;
+        phiHigh = nPhi - 1;
+      }
+
+    for(int iPhi = phiLow; iPhi <= phiHigh; ++iPhi)
+      {
+        const int wrapped = ((iPhi % nPhi) + nPhi) % nPhi;
+
+        for(int iEta = etaLow; iEta <= etaHigh; ++iEta)
+          {
+            for(size_t index : cells[wrapped * nEta + iEta])
+              f(index);
+          }
+      }
+  }
+
+} // namespace uwvv
+
+#endif // header guard
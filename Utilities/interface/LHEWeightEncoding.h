@@ -0,0 +1,209 @@
+#ifndef UWVV_Utilities_LHEWeightEncoding_h
+#define UWVV_Utilities_LHEWeightEncoding_h
+
+
+#include <vector>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+
+
+namespace uwvv
+{
+
+  // Compact 16-bit encodings of LHE weights relative to the nominal weight,
+  // as written by the lheWeightsHalf and lheWeightsFixed library functions.
+  // No CMSSW dependencies, so readers can include this in ROOT macros to
+  // decode the branches (weight = nominal * relative weight, with the
+  // nominal weight from the lheNominalWeight branch). Events whose nominal
+  // weight is zero (or not finite) have no relative weights, so theirs are
+  // stored as absolute weights instead; referenceWeight() gives the scale
+  // either way, and the whole-branch functions below use it.
+  namespace lheWeightEncoding
+  {
+    // IEEE 754 half precision, rounded to nearest even. The relative error
+    // is at most 2^-11 for magnitudes between 2^-14 and 65504. Larger ones
+    // become infinite, smaller ones lose precision gradually.
+    inline unsigned short toHalf(float f)
+    {
+      uint32_t x;
+      std::memcpy(&x, &f, sizeof(x));
+
+      const uint32_t sign = (x >> 16) & 0x8000;
+      const uint32_t absX = x & 0x7fffffff;
+
+      // inf or nan
+      if(absX >= 0x7f800000)
+        return sign | 0x7c00 | (absX > 0x7f800000 ? 0x200 : 0);
+
+      // rounds to 65520 or more
+      if(absX >= 0x477ff000)
+        return sign | 0x7c00;
+
+      // subnormal half (2^-25 and below round to zero)
+      if(absX < 0x38800000)
+        {
+          if(absX <= 0x33000000)
+            return sign;
+
+          const uint32_t mantissa = (absX & 0x7fffff) | 0x800000;
+          const uint32_t shift = 126 - (absX >> 23);
+          uint32_t out = mantissa >> shift;
+          const uint32_t rem = mantissa & ((1u << shift) - 1);
+          const uint32_t halfway = 1u << (shift - 1);
+          if(rem > halfway || (rem == halfway && (out & 1)))
+            ++out;
+
+          return sign | out;
+        }
+
+      // normal: rebias the exponent and round off 13 bits of mantissa (a
+      // carry into the exponent is still correct)
+      uint32_t out = (absX >> 13) - ((127 - 15) << 10);
+      const uint32_t rem = absX & 0x1fff;
+      if(rem > 0x1000 || (rem == 0x1000 && (out & 1)))
+        ++out;
+
+      return sign | out;
+    }
+
+
+    inline float fromHalf(unsigned short h)
+    {
+      const uint32_t sign = uint32_t(h & 0x8000) << 16;
+      const uint32_t exponent = (h >> 10) & 0x1f;
+      const uint32_t mantissa = h & 0x3ff;
+
+      if(exponent == 0)
+        {
+          const float out = std::ldexp(float(mantissa), -24);
+          return sign ? -out : out;
+        }
+
+      uint32_t x;
+      if(exponent == 31)
+        x = sign | 0x7f800000 | (mantissa << 13);
+      else
+        x = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+
+      float out;
+      std::memcpy(&out, &x, sizeof(out));
+      return out;
+    }
+
+
+    // Half precision from a double, rounded only once. The intermediate
+    // float is rounded to odd (an inexact result goes to the neighbor with
+    // an odd last bit), and float has enough extra bits that rounding it
+    // to half then gives the correctly rounded result.
+    inline unsigned short toHalf(double d)
+    {
+      float f = float(d);
+      if(double(f) != d && !std::isnan(d))
+        {
+          uint32_t x;
+          std::memcpy(&x, &f, sizeof(x));
+          if(!(x & 1))
+            f = std::nextafter(f, d > f ? HUGE_VALF : -HUGE_VALF);
+        }
+
+      return toHalf(f);
+    }
+
+
+    // Fixed point: (relative weight - 1) in steps of 2 * fixedHalfStep(),
+    // zigzag encoded (0, -1, 1, -2, 2...) to fit the sign in 16 bits. The
+    // half step is a little less than precision, so even after the decoded
+    // relative weight is rounded to float it is off by at most precision,
+    // as long as it is within 1 +/- 65534 * fixedHalfStep(precision).
+    // Anything outside that, or not finite, is stored as overflowFixed and
+    // decoded as NaN. precision must be at least minFixedPrecision.
+    const unsigned short overflowFixed = 0xffff;
+    const double minFixedPrecision = 1e-6;
+
+    inline double fixedHalfStep(double precision)
+    {
+      // float rounding of the largest decoded value, 1 + 65534 * half step,
+      // is at most 2^-24 of it; twice that leaves room for the double
+      // arithmetic
+      const double slack = std::ldexp(1., -23);
+      return (precision - slack) / (1. + 65534. * slack);
+    }
+
+    inline unsigned short toFixed(double relWeight, double precision)
+    {
+      const double steps = std::floor((relWeight - 1.) / (2. * fixedHalfStep(precision)) + 0.5);
+      if(!(std::abs(steps) <= 32767.))
+        return overflowFixed;
+
+      const int i = int(steps);
+      return i >= 0 ? 2 * i : -2 * i - 1;
+    }
+
+
+    inline double fromFixed(unsigned short q, double precision)
+    {
+      if(q == overflowFixed)
+        return std::nan("");
+
+      const int i = (q & 1) ? -int(q >> 1) - 1 : int(q >> 1);
+      return 1. + 2. * fixedHalfStep(precision) * i;
+    }
+
+
+    // What the weights are stored relative to: the nominal weight, or 1 if
+    // that is zero or not finite
+    inline double referenceWeight(double nominal)
+    {
+      return (nominal != 0. && std::isfinite(nominal)) ? nominal : 1.;
+    }
+
+
+    // Whole branches from raw weights
+    template<class W>
+    inline void encodeHalf(const std::vector<W>& in, double nominal,
+                           std::vector<unsigned short>& out)
+    {
+      const double ref = referenceWeight(nominal);
+      out.resize(in.size());
+      for(size_t i = 0; i < in.size(); ++i)
+        out[i] = toHalf(double(in[i]) / ref);
+    }
+
+
+    template<class W>
+    inline void encodeFixed(const std::vector<W>& in, double nominal,
+                            double precision, std::vector<unsigned short>& out)
+    {
+      const double ref = referenceWeight(nominal);
+      out.resize(in.size());
+      for(size_t i = 0; i < in.size(); ++i)
+        out[i] = toFixed(double(in[i]) / ref, precision);
+    }
+
+
+    // Whole branches to absolute weights
+    inline void decodeHalf(const std::vector<unsigned short>& in, float nominal,
+                           std::vector<float>& out)
+    {
+      const float ref = referenceWeight(nominal);
+      out.resize(in.size());
+      for(size_t i = 0; i < in.size(); ++i)
+        out[i] = ref * fromHalf(in[i]);
+    }
+
+
+    inline void decodeFixed(const std::vector<unsigned short>& in, float nominal,
+                            double precision, std::vector<float>& out)
+    {
+      const float ref = referenceWeight(nominal);
+      out.resize(in.size());
+      for(size_t i = 0; i < in.size(); ++i)
+        out[i] = ref * fromFixed(in[i], precision);
+    }
+
+  } // namespace lheWeightEncoding
+
+} // namespace uwvv
+
+#endif // header guard
@@ -0,0 +1,84 @@
+#ifndef UWVV_Utilities_Philox_h
+#define UWVV_Utilities_Philox_h
+
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+
+
+namespace uwvv
+{
+
+  // Philox4x32-10 counter-based random number generator (Salmon et al.,
+  // "Parallel Random Numbers: As Easy as 1, 2, 3", SC11). Each (counter,
+  // key) pair maps to four independent random 32-bit words, with no state,
+  // so the same numbers come out no matter which thread asks for them or in
+  // what order. Use the key for something fixed for a whole batch (e.g. the
+  // event) and the counter for the item in the batch.
+  class Philox4x32
+  {
+   public:
+    typedef std::array<uint32_t, 4> Counter;
+    typedef std::array<uint32_t, 2> Key;
+
+    static Counter generate(Counter ctr, Key key)
+    {
+      for(unsigned iRound = 0; iRound < 10; ++iRound)
+        {
+          if(iRound)
+            {
+              key[0] += W0;
+              key[1] += W1;
+            }
+
+          const uint64_t prod0 = uint64_t(M0) * ctr[0];
+          const uint64_t prod1 = uint64_t(M1) * ctr[2];
+
+          ctr = {{uint32_t(prod1 >> 32) ^ ctr[1] ^ key[0],
+                  uint32_t(prod1),
+                  uint32_t(prod0 >> 32) ^ ctr[3] ^ key[1],
+                  uint32_t(prod0)}};
+        }
+
+      return ctr;
+    }
+
+    // Uniform double in (0,1) (never exactly 0 or 1) from two random words.
+    // 52 bits, so the half-step offset still fits in the mantissa
+    static double uniform(uint32_t hi, uint32_t lo)
+    {
+      const uint64_t bits = (uint64_t(hi >> 6) << 26) | (lo >> 6); // 52 bits
+      return (bits + 0.5) * (1. / 4503599627370496.); // 2^-52
+    }
+
+    // Unit Gaussian for this counter and key (Box-Muller)
+    static double gaussian(const Counter& ctr, const Key& key)
+    {
+      const Counter r = generate(ctr, key);
+
+      const double u1 = uniform(r[0], r[1]);
+      const double u2 = uniform(r[2], r[3]);
+
+      return std::sqrt(-2. * std::log(u1)) * std::cos(2. * M_PI * u2);
+    }
+
+    // Fill out[i] with the Gaussian for counters[i], for n counters
+    static void gaussians(size_t n, const Counter* counters, const Key& key,
+                          double* out)
+    {
+      for(size_t i = 0; i < n; ++i)
+        out[i] = gaussian(counters[i], key);
+    }
+
+   private:
+    static const uint32_t M0 = 0xD2511F53;
+    static const uint32_t M1 = 0xCD9E8D57;
+    static const uint32_t W0 = 0x9E3779B9;
+    static const uint32_t W1 = 0xBB67AE85;
+  };
+
+} // namespace
+
+#endif // header guard
@@ -0,0 +1,163 @@
+#ifndef UWVV_Utilities_ScaleFactorTable_h
+#define UWVV_Utilities_ScaleFactorTable_h
+
+
+#include <vector>
+#include <string>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <cstddef>
+
+class TH2;
+class TAxis;
+
+
+namespace uwvv
+{
+
+  // Immutable copy of the bin contents and errors of a 2D histogram, for
+  // fast lookups. Points outside the histogram get the value of the nearest
+  // bin instead of the under/overflow (i.e. the axes are clamped), and the
+  // bin is found by direct indexing for uniform axes and by binary search
+  // for variable ones, with the same results as TH2::FindBin.
+  class ScaleFactorTable
+  {
+   public:
+    ScaleFactorTable(const TH2& h);
+    ~ScaleFactorTable() {;}
+
+    // Read a table from a binary file made by
+    // Utilities/scripts/compileScaleFactorTables.py from the ROOT file at
+    // sourcePath. The format is
+    //     char[4]  "UWSF"
+    //     uint32   format version (2)
+    //     uint64   size of the source ROOT file in bytes
+    //     int64    modification time of the source ROOT file (Unix time)
+    //     x axis, then y axis, each as
+    //         uint32   number of bins
+    //         uint32   1 if the bins are uniform, 0 if not
+    //         float64  low edge, high edge
+    //         float64  all nBins+1 bin edges (only if not uniform)
+    //     float32  nx*ny bin contents, row-major in x
+    //     float32  nx*ny bin errors
+    // in native (little-endian) byte order. Returns null if the file can't
+    // be read, isn't a valid table, or was made from a different version of
+    // the source file (its size or modification time changed), or if the
+    // source file can't be found to check.
+    static std::unique_ptr<ScaleFactorTable> fromBinary(const std::string& path,
+                                                        const std::string& sourcePath);
+
+    // Index of the (clamped) bin containing (x,y), for value() and error()
+    size_t bin(double x, double y) const
+    {
+      return xAxis.find(x) * yAxis.nBins + yAxis.find(y);
+    }
+
+    float value(size_t iBin) const {return values[iBin];}
+    float error(size_t iBin) const {return errors[iBin];}
+
+    float value(double x, double y) const {return value(bin(x, y));}
+    float error(double x, double y) const {return error(bin(x, y));}
+
+    // Look up n points at once. errorsOut may be null if errors are not
+    // needed.
+    void lookup(size_t n, const float* x, const float* y,
+                float* valuesOut, float* errorsOut = nullptr) const;
+
+   private:
+    class Axis
+    {
+     public:
+      Axis(const TAxis& axis);
+      // Uniform if edges is empty
+      Axis(size_t nBins, double low, double high,
+           const std::vector<double>& edges);
+
+      // Bin (from 0) containing x, clamped to the first and last bins
+      size_t find(double x) const
+      {
+        return uniform ? findUniform(x) : findVariable(x);
+      }
+
+      const size_t nBins;
+
+     private:
+      size_t findUniform(double x) const
+      {
+        // same arithmetic as TAxis::FindFixBin
+        const double pos = nBins * (x - low) / (high - low);
+        if(!(pos >= 0.)) // also catches NaN
+          return 0;
+        if(pos >= nBins)
+          return nBins - 1;
+        return size_t(pos);
+      }
+
+      size_t findVariable(double x) const
+      {
+        // Last edge <= x, without data-dependent branches
+        const double* base = &edges[0];
+        size_t len = edges.size();
+        while(len > 1)
+          {
+            const size_t half = len / 2;
+            base = (base[half] <= x) ? base + half : base;
+            len -= half;
+          }
+
+        const size_t i = base - &edges[0];
+        return i < nBins ? i : nBins - 1;
+      }
+
+      const bool uniform;
+      const double low;
+      const double high;
+      std::vector<double> edges; // nBins+1 edges, only for variable bins
+    };
+
+    ScaleFactorTable(const Axis& xAxis, const Axis& yAxis,
+                     std::vector<float>&& values, std::vector<float>&& errors);
+
+    const Axis xAxis;
+    const Axis yAxis;
+
+    // Row-major in x, i.e. value for x bin i, y bin j is at i*ny + j
+    std::vector<float> values;
+    std::vector<float> errors;
+  };
+
+
+  // Process-wide registry of scale factor tables, so each histogram is only
+  // read once no matter how many modules and streams use it. The tables are
+  // immutable, so they can be shared freely.
+  class ScaleFactorTableCache
+  {
+   public:
+    // Get the table for histogram histName in ROOT file fileName. If a
+    // binary version of the table (see ScaleFactorTable::fromBinary())
+    // made from the current fileName exists at binaryPath(fileName,
+    // histName), it is used instead of reading the histogram. Otherwise
+    // (including if the ROOT file changed since the binary was made), the
+    // histogram is read from the ROOT file.
+    static std::shared_ptr<const ScaleFactorTable> get(const std::string& fileName,
+                                                       const std::string& histName);
+
+    // Where the binary version of a table is looked for:
+    // <fileName without .root>_<histName>.sft
+    static std::string binaryPath(const std::string& fileName,
+                                  const std::string& histName);
+
+   private:
+    static std::shared_ptr<const ScaleFactorTable> load(const std::string& fileName,
+                                                        const std::string& histName);
+
+    static std::mutex mutex_;
+    static std::map<std::pair<std::string, std::string>,
+                    std::shared_ptr<const ScaleFactorTable> > tables_;
+  };
+
+} // namespace
+
+#endif // header guard
@@ -0,0 +1,84 @@
+#ifndef UWVV_Utilities_SplineTable_h
+#define UWVV_Utilities_SplineTable_h
+
+
+#include <vector>
+#include <string>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <cstddef>
+
+class TSpline3;
+
+
+namespace uwvv
+{
+
+  // Several cubic splines (e.g. a nominal value and its systematic
+  // variations) of the same variable, evaluated all at once.
+  //
+  // The splines are put on a common set of knots (the union of all their
+  // knots), and their polynomial coefficients are stored interleaved by
+  // knot, so evaluating all of them takes one knot search and one tight
+  // loop. The knot search starts from a uniform grid over the knots. The
+  // polynomials are re-expanded exactly, so the results are the same as
+  // TSpline3::Eval for each spline, including extrapolation outside the
+  // knots.
+  class SplineTable
+  {
+   public:
+    // (TSpline3::GetCoeff() isn't const, but the splines are not modified)
+    SplineTable(const std::vector<TSpline3*>& splines);
+    ~SplineTable() {;}
+
+    size_t size() const {return nSplines;}
+
+    // Put the value of spline i at x into out[i], for all splines
+    void eval(double x, float* out) const;
+
+   private:
+    // Segment (from 0) whose polynomial is used for x
+    size_t segment(double x) const;
+
+    const size_t nSplines;
+
+    std::vector<double> knots;
+
+    // For segment j, the constant, linear, quadratic, and cubic
+    // coefficients of all splines, in that order, starting at
+    // 4 * nSplines * j
+    std::vector<double> coefficients;
+
+    // First segment worth checking for each cell of a uniform grid
+    // spanning the knots
+    double gridLow;
+    double gridInverseWidth;
+    std::vector<size_t> gridStart;
+  };
+
+
+  // Process-wide registry of spline tables, so each set of splines is only
+  // read once no matter how many modules and streams use it. The tables are
+  // immutable, so they can be shared freely.
+  class SplineTableCache
+  {
+   public:
+    // Get the table for the splines with these names (in this order) in
+    // ROOT file fileName
+    static std::shared_ptr<const SplineTable> get(const std::string& fileName,
+                                                  const std::vector<std::string>& splineNames);
+
+   private:
+    static std::shared_ptr<const SplineTable> load(const std::string& fileName,
+                                                   const std::vector<std::string>& splineNames);
+
+    static std::mutex mutex_;
+    static std::map<std::pair<std::string, std::vector<std::string> >,
+                    std::shared_ptr<const SplineTable> > tables_;
+  };
+
+} // namespace
+
+#endif // header guard
@@ -0,0 +1,105 @@
+'''
+
+Write binary versions of scale factor histograms, which the scale factor
+embedders read instead of the ROOT file if they exist.
+See ScaleFactorTable::fromBinary() in Utilities/interface/ScaleFactorTable.h
+for the format. The binary for histogram h in someFile.root is written to
+someFile_h.sft. It records the size and modification time of the ROOT file,
+and is ignored if either changes, so rerun this if the ROOT file changes.
+The ROOT files must be local.
+
+Usage:
+    python compileScaleFactorTables.py [-n hist1 hist2 ...] file1.root [file2.root ...]
+If no histogram names are given, all 2D histograms in each file are done.
+
+Nate Woods, U. Wisconsin
+
+'''
+
+import argparse
+import struct
+import os
+
+# import ROOT in batch mode
+import sys
+oldargv = sys.argv[:]
+sys.argv = [ '-b-' ]
+import ROOT
+ROOT.gROOT.SetBatch(True)
+sys.argv = oldargv
+
+
+def packAxis(axis):
+    nBins = axis.GetNbins()
+    uniform = axis.GetXbins().GetSize() == 0
+
+    out = struct.pack('<IIdd', nBins, int(uniform), axis.GetXmin(), axis.GetXmax())
+    if not uniform:
+        out += struct.pack('<{}d'.format(nBins+1),
+                           *[axis.GetBinLowEdge(i) for i in xrange(1, nBins+2)])
+
+    return out
+
+
+def packHist(h, fileName):
+    source = os.stat(fileName)
+
+    nx = h.GetNbinsX()
+    ny = h.GetNbinsY()
+
+    bins = [h.GetBin(i, j) for i in xrange(1, nx+1) for j in xrange(1, ny+1)]
+
+    return ''.join([
+        'UWSF',
+        struct.pack('<I', 2),
+        struct.pack('<Qq', source.st_size, int(source.st_mtime)),
+        packAxis(h.GetXaxis()),
+        packAxis(h.GetYaxis()),
+        struct.pack('<{}f'.format(len(bins)), *[h.GetBinContent(b) for b in bins]),
+        struct.pack('<{}f'.format(len(bins)), *[h.GetBinError(b) for b in bins]),
+        ])
+
+
+def binaryPath(fileName, histName):
+    '''
+    Must match ScaleFactorTableCache::binaryPath()
+    '''
+    base = fileName
+    if base.endswith('.root') and len(base) > len('.root'):
+        base = base[:-len('.root')]
+
+    return '{}_{}.sft'.format(base, histName)
+
+
+parser = argparse.ArgumentParser(description='Write binary versions of '
+                                 'scale factor histograms.')
+parser.add_argument('files', type=str, nargs='+',
+                    help='ROOT files with scale factor histograms.')
+parser.add_argument('-n', '--histNames', type=str, nargs='*', default=[],
+                    help='Histograms to convert. If empty, all 2D '
+                    'histograms are converted.')
+
+args = parser.parse_args()
+
+for fileName in args.files:
+    f = ROOT.TFile.Open(fileName)
+    if not f or f.IsZombie():
+        raise IOError("Can't open {}".format(fileName))
+
+    names = args.histNames
+    if not names:
+        names = [k.GetName() for k in f.GetListOfKeys()
+                 if ROOT.TClass.GetClass(k.GetClassName()).InheritsFrom('TH2')]
+
+    for name in names:
+        h = f.Get(name)
+        if not h or not h.InheritsFrom('TH2'):
+            raise ValueError("No 2D histogram {} in {}".format(name, fileName))
+
+        outName = binaryPath(fileName, name)
+        with open(outName, 'wb') as out:
+            out.write(packHist(h, fileName))
+
+        print "Wrote {}".format(outName)
+
+    f.Close()
@@ -0,0 +1,57 @@
+#include "UWVV/Utilities/interface/EtaPhiGrid.h"
+
+#include <cmath>
+#include <algorithm>
+
+
+namespace uwvv
+{
+
+  // Cells smaller than ~0.01 would just waste memory
+  EtaPhiGrid::EtaPhiGrid(float cellSize, float maxEta) :
+    maxEta(maxEta),
+    nEta(std::max(1, int(2. * maxEta / std::max(cellSize, 0.01f)))),
+    etaWidth(2. * maxEta / nEta),
+    nPhi(std::max(1, int(2. * M_PI / std::max(cellSize, 0.01f)))),
+    phiWidth(2. * M_PI / nPhi),
+    cells(nEta * nPhi),
+    nObjects(0)
+  {
+  }
+
+
+  void EtaPhiGrid::clear()
+  {
+    if(!nObjects)
+      return;
+
+    for(auto& cell : cells)
+      cell.clear();
+
+    nObjects = 0;
+  }
+
+
+  void EtaPhiGrid::add(size_t index, float eta, float phi)
+  {
+    const int wrapped = ((phiBin(phi) % nPhi) + nPhi) % nPhi;
+
+    cells[wrapped * nEta + etaBin(eta)].push_back(index);
+    ++nObjects;
+  }
+
+
+  int EtaPhiGrid::etaBin(float eta) const
+  {
+    int bin = int(std::floor((eta + maxEta) / etaWidth));
+
+    return std::min(std::max(bin, 0), nEta - 1);
+  }
+
+
+  int EtaPhiGrid::phiBin(float phi) const
+  {
+    return int(std::floor((phi + M_PI) / phiWidth));
+  }
+
+} // namespace uwvv
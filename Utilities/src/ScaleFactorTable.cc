@@ -0,0 +1,235 @@
+#include "UWVV/Utilities/interface/ScaleFactorTable.h"
+
+#include <cstring>
+#include <cstdint>
+#include <fstream>
+
+#include <sys/stat.h>
+
+#include "TH2.h"
+#include "TAxis.h"
+#include "TArrayD.h"
+#include "TFile.h"
+
+#include "FWCore/Utilities/interface/Exception.h"
+
+
+namespace
+{
+  // Reads consecutive values straight out of a file, keeping track of
+  // whether it ran off the end
+  class BinaryReader
+  {
+   public:
+    BinaryReader(const std::string& path) :
+      in(path, std::ios::binary)
+    {
+    }
+
+    template<typename V>
+      bool read(V* out, size_t n = 1)
+    {
+      in.read(reinterpret_cast<char*>(out), n * sizeof(V));
+      return bool(in);
+    }
+
+    bool atEnd() {return in.peek() == std::ifstream::traits_type::eof();}
+
+   private:
+    std::ifstream in;
+  };
+}
+
+
+namespace uwvv
+{
+
+  ScaleFactorTable::Axis::Axis(const TAxis& axis) :
+    nBins(axis.GetNbins() > 0 ? axis.GetNbins() : 1),
+    uniform(axis.GetXbins()->GetSize() == 0),
+    low(axis.GetXmin()),
+    high(axis.GetXmax())
+  {
+    if(!uniform)
+      {
+        edges.reserve(nBins + 1);
+        for(size_t i = 0; i <= nBins; ++i)
+          edges.push_back(axis.GetBinLowEdge(i + 1));
+      }
+  }
+
+
+  ScaleFactorTable::Axis::Axis(size_t nBins, double low, double high,
+                               const std::vector<double>& edges) :
+    nBins(nBins),
+    uniform(edges.empty()),
+    low(low),
+    high(high),
+    edges(edges)
+  {
+  }
+
+
+  ScaleFactorTable::ScaleFactorTable(const TH2& h) :
+    xAxis(*h.GetXaxis()),
+    yAxis(*h.GetYaxis())
+  {
+    values.reserve(xAxis.nBins * yAxis.nBins);
+    errors.reserve(xAxis.nBins * yAxis.nBins);
+
+    for(size_t i = 0; i < xAxis.nBins; ++i)
+      {
+        for(size_t j = 0; j < yAxis.nBins; ++j)
+          {
+            const int bin = h.GetBin(i + 1, j + 1);
+            values.push_back(h.GetBinContent(bin));
+            errors.push_back(h.GetBinError(bin));
+          }
+      }
+  }
+
+
+  ScaleFactorTable::ScaleFactorTable(const Axis& xAxis, const Axis& yAxis,
+                                     std::vector<float>&& values,
+                                     std::vector<float>&& errors) :
+    xAxis(xAxis),
+    yAxis(yAxis),
+    values(std::move(values)),
+    errors(std::move(errors))
+  {
+  }
+
+
+  std::unique_ptr<ScaleFactorTable>
+  ScaleFactorTable::fromBinary(const std::string& path,
+                               const std::string& sourcePath)
+  {
+    std::unique_ptr<ScaleFactorTable> out;
+
+    // A table can only be trusted if it was made from the source file as
+    // it is now
+    struct stat source;
+    if(stat(sourcePath.c_str(), &source))
+      return out;
+
+    BinaryReader reader(path);
+
+    auto readAxis = [&reader](std::unique_ptr<Axis>& axis) -> bool
+      {
+        uint32_t nBins, uniform;
+        double low, high;
+        if(!(reader.read(&nBins) && reader.read(&uniform) &&
+             reader.read(&low) && reader.read(&high)) || !nBins)
+          return false;
+
+        std::vector<double> edges;
+        if(!uniform)
+          {
+            edges.resize(nBins + 1);
+            if(!reader.read(edges.data(), edges.size()))
+              return false;
+          }
+
+        axis.reset(new Axis(nBins, low, high, edges));
+        return true;
+      };
+
+    char magic[4];
+    uint32_t version;
+    uint64_t sourceSize;
+    int64_t sourceMTime;
+    std::unique_ptr<Axis> xAxis, yAxis;
+    if(reader.read(magic, 4) && !std::memcmp(magic, "UWSF", 4) &&
+       reader.read(&version) && version == 2 &&
+       reader.read(&sourceSize) && sourceSize == uint64_t(source.st_size) &&
+       reader.read(&sourceMTime) && sourceMTime == int64_t(source.st_mtime) &&
+       readAxis(xAxis) && readAxis(yAxis))
+      {
+        const size_t nBins = xAxis->nBins * yAxis->nBins;
+        std::vector<float> values(nBins);
+        std::vector<float> errors(nBins);
+
+        if(reader.read(values.data(), nBins) &&
+           reader.read(errors.data(), nBins) &&
+           reader.atEnd())
+          out.reset(new ScaleFactorTable(*xAxis, *yAxis,
+                                         std::move(values), std::move(errors)));
+      }
+
+    return out;
+  }
+
+
+  void
+  ScaleFactorTable::lookup(size_t n, const float* x, const float* y,
+                           float* valuesOut, float* errorsOut) const
+  {
+    for(size_t i = 0; i < n; ++i)
+      {
+        const size_t iBin = bin(x[i], y[i]);
+        valuesOut[i] = values[iBin];
+        if(errorsOut)
+          errorsOut[i] = errors[iBin];
+      }
+  }
+
+
+  std::mutex ScaleFactorTableCache::mutex_;
+  std::map<std::pair<std::string, std::string>,
+           std::shared_ptr<const ScaleFactorTable> > ScaleFactorTableCache::tables_;
+
+
+  std::shared_ptr<const ScaleFactorTable>
+  ScaleFactorTableCache::get(const std::string& fileName,
+                             const std::string& histName)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    std::shared_ptr<const ScaleFactorTable>& out = tables_[std::make_pair(fileName, histName)];
+    if(!out)
+      out = load(fileName, histName);
+
+    return out;
+  }
+
+
+  std::string
+  ScaleFactorTableCache::binaryPath(const std::string& fileName,
+                                    const std::string& histName)
+  {
+    std::string base = fileName;
+    const std::string ext = ".root";
+    if(base.size() > ext.size() &&
+       !base.compare(base.size() - ext.size(), ext.size(), ext))
+      base.erase(base.size() - ext.size());
+
+    return base + "_" + histName + ".sft";
+  }
+
+
+  std::shared_ptr<const ScaleFactorTable>
+  ScaleFactorTableCache::load(const std::string& fileName,
+                              const std::string& histName)
+  {
+    std::shared_ptr<const ScaleFactorTable> out(ScaleFactorTable::fromBinary(binaryPath(fileName, histName),
+                                                                             fileName));
+    if(out)
+      return out;
+
+    std::unique_ptr<TFile> file(TFile::Open(fileName.c_str()));
+    if(!file || file->IsZombie())
+      throw cms::Exception("InvalidFile")
+        << "Scale factor file " << fileName << " does not exist!" << std::endl;
+
+    const TH2* h = dynamic_cast<const TH2*>(file->Get(histName.c_str()));
+    if(!h)
+      throw cms::Exception("InvalidFile")
+        << "Scale factor file " << fileName << " has no 2D histogram "
+        << histName << std::endl;
+
+    out = std::make_shared<const ScaleFactorTable>(*h);
+
+    return out;
+  }
+
+} // namespace
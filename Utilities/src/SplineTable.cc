@@ -0,0 +1,185 @@
+#include "UWVV/Utilities/interface/SplineTable.h"
+
+#include <algorithm>
+
+#include "TSpline.h"
+#include "TFile.h"
+
+#include "FWCore/Utilities/interface/Exception.h"
+
+
+namespace
+{
+  // Segment of spline whose polynomial TSpline3::Eval uses for x: the last
+  // knot below x, but at least the first and at most the next-to-last
+  int splineSegment(const TSpline3& spline, double x)
+  {
+    int k = 0;
+    for(int i = 1; i < spline.GetNp() - 1; ++i)
+      {
+        double xi, yi;
+        spline.GetKnot(i, xi, yi);
+        if(xi < x)
+          k = i;
+        else
+          break;
+      }
+
+    return k;
+  }
+}
+
+
+namespace uwvv
+{
+
+  SplineTable::SplineTable(const std::vector<TSpline3*>& splines) :
+    nSplines(splines.size())
+  {
+    for(const TSpline3* spline : splines)
+      {
+        if(spline->GetNp() < 2)
+          throw cms::Exception("InvalidSpline")
+            << "Spline " << spline->GetName() << " has fewer than two knots"
+            << std::endl;
+
+        for(int i = 0; i < spline->GetNp(); ++i)
+          {
+            double x, y;
+            spline->GetKnot(i, x, y);
+            knots.push_back(x);
+          }
+      }
+
+    std::sort(knots.begin(), knots.end());
+    knots.erase(std::unique(knots.begin(), knots.end()), knots.end());
+
+    // Each spline has at least two distinct knots, so there is at least
+    // one segment
+    const size_t nSegments = knots.size() - 1;
+    coefficients.resize(4 * nSplines * nSegments);
+
+    for(size_t j = 0; j < nSegments; ++j)
+      {
+        const double x0 = knots[j];
+        const double middle = 0.5 * (knots[j] + knots[j+1]);
+
+        double* y = &coefficients[4 * nSplines * j];
+        double* b = y + nSplines;
+        double* c = b + nSplines;
+        double* d = c + nSplines;
+
+        for(size_t i = 0; i < nSplines; ++i)
+          {
+            // Re-expand this spline's polynomial for this segment around
+            // x0 instead of around its own knot
+            double xk, yk, bk, ck, dk;
+            splines[i]->GetCoeff(splineSegment(*splines[i], middle),
+                                 xk, yk, bk, ck, dk);
+            const double s = x0 - xk;
+
+            y[i] = yk + s * (bk + s * (ck + s * dk));
+            b[i] = bk + s * (2. * ck + 3. * s * dk);
+            c[i] = ck + 3. * s * dk;
+            d[i] = dk;
+          }
+      }
+
+    // A few grid cells per segment keeps the search after the grid lookup
+    // to a step or two even for unevenly spaced knots
+    const size_t nCells = 4 * nSegments;
+    gridLow = knots.front();
+    gridInverseWidth = nCells / (knots.back() - knots.front());
+    gridStart.resize(nCells);
+    for(size_t iCell = 0; iCell < nCells; ++iCell)
+      {
+        const double cellLow = gridLow + iCell / gridInverseWidth;
+        size_t j = std::lower_bound(knots.begin(), knots.end(), cellLow) - knots.begin();
+        // one segment of slack for rounding in the cell computation
+        gridStart[iCell] = (j > 1 ? j - 2 : 0);
+      }
+  }
+
+
+  size_t
+  SplineTable::segment(double x) const
+  {
+    const size_t last = knots.size() - 2;
+
+    if(!(x > knots.front()))
+      return 0;
+    if(x >= knots.back())
+      return last;
+
+    size_t iCell = (x - gridLow) * gridInverseWidth;
+    if(iCell >= gridStart.size())
+      iCell = gridStart.size() - 1;
+
+    size_t j = gridStart[iCell];
+    while(j < last && knots[j+1] < x)
+      ++j;
+
+    return j;
+  }
+
+
+  void
+  SplineTable::eval(double x, float* out) const
+  {
+    const size_t j = segment(x);
+    const double dx = x - knots[j];
+
+    const double* y = &coefficients[4 * nSplines * j];
+    const double* b = y + nSplines;
+    const double* c = b + nSplines;
+    const double* d = c + nSplines;
+
+    for(size_t i = 0; i < nSplines; ++i)
+      out[i] = y[i] + dx * (b[i] + dx * (c[i] + dx * d[i]));
+  }
+
+
+  std::mutex SplineTableCache::mutex_;
+  std::map<std::pair<std::string, std::vector<std::string> >,
+           std::shared_ptr<const SplineTable> > SplineTableCache::tables_;
+
+
+  std::shared_ptr<const SplineTable>
+  SplineTableCache::get(const std::string& fileName,
+                        const std::vector<std::string>& splineNames)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    std::shared_ptr<const SplineTable>& out = tables_[std::make_pair(fileName, splineNames)];
+    if(!out)
+      out = load(fileName, splineNames);
+
+    return out;
+  }
+
+
+  std::shared_ptr<const SplineTable>
+  SplineTableCache::load(const std::string& fileName,
+                         const std::vector<std::string>& splineNames)
+  {
+    std::unique_ptr<TFile> file(TFile::Open(fileName.c_str()));
+    if(!file || file->IsZombie())
+      throw cms::Exception("InvalidFile")
+        << "Spline file " << fileName << " does not exist!" << std::endl;
+
+    std::vector<TSpline3*> splines;
+    for(const auto& name : splineNames)
+      {
+        TSpline3* spline = dynamic_cast<TSpline3*>(file->Get(name.c_str()));
+        if(!spline)
+          throw cms::Exception("InvalidFile")
+            << "Spline file " << fileName << " has no spline " << name
+            << std::endl;
+
+        splines.push_back(spline);
+      }
+
+    return std::make_shared<const SplineTable>(splines);
+  }
+
+} // namespace
@@ -1,4 +1,5 @@
 #include "UWVV/Utilities/interface/helpers.h"
+#include "UWVV/Utilities/interface/DeltaRKernels.h"
 
 namespace uwvv
 {
@@ -40,23 +41,38 @@ namespace uwvv
       return std::abs(p4b.mass() - 91.1876) < std::abs(p4a.mass() - 91.1876);
     }
 
+    namespace
+    {
+      bool overlapWithAnyDaughter(double eta, double phi,
+                                  const reco::Candidate& mother, double dR2)
+      {
+        if(!mother.numberOfDaughters()) // end recursion
+          {
+            const auto p4 = mother.p4();
+            return dr::deltaR2<double>(eta, phi, p4.eta(), p4.phi()) < dR2;
+          }
+
+        for(size_t i = 0; i < mother.numberOfDaughters(); ++i)
+          {
+            if(overlapWithAnyDaughter(eta, phi, *mother.daughter(i), dR2))
+              return true;
+          }
+
+        return false;
+      }
+    }
+
     // Check if any final daughters of mother are within dR of cand.
     // "final daughters" means it checks the daughters of daughters if
     // applicable
     bool overlapWithAnyDaughter(const reco::Candidate& cand,
                                 const reco::Candidate& mother, float dR)
     {
-      if(!mother.numberOfDaughters()) // end recursion
-        return reco::deltaR(cand.p4(), mother.p4()) < dR;
-
-      for(size_t i = 0; i < mother.numberOfDaughters(); ++i)
-        {
-          if(overlapWithAnyDaughter(cand, *mother.daughter(i), dR))
-            return true;
-        }
-
-      return false;
+      const auto p4 = cand.p4();
+      return overlapWithAnyDaughter(p4.eta(), p4.phi(), mother,
+                                    double(dR) * dR);
     }
+
     const edm::PtrVector<pat::Jet>* getCleanedJetCollection(const pat::CompositeCandidate& cand, 
         const std::string& variation, std::string collectionName/*="cleanedJets"*/)
       {
@@ -0,0 +1,256 @@
+// Checks the deltaR kernels in DeltaRKernels.h against the scalar
+// reco::deltaR2 path they replaced, then times both on the same inputs.
+// Returns nonzero if any kernel disagrees with the scalar reference;
+// timings are only printed. Run with a number of repetitions as the
+// argument to get steadier timings (default 200).
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+
+#include "DataFormats/Math/interface/deltaR.h"
+
+#include "UWVV/Utilities/interface/DeltaRKernels.h"
+
+
+using namespace uwvv;
+
+
+namespace
+{
+  unsigned long nFailed = 0;
+
+  void check(bool pass, const char* what, size_t n, size_t i)
+  {
+    if(pass)
+      return;
+
+    if(++nFailed <= 10)
+      std::cout << "FAILED " << what << " (n = " << n << ", i = " << i
+                << ")" << std::endl;
+  }
+
+
+  // Objects spread over the detector like leptons, jets, or PF candidates
+  dr::EtaPhiArrays<double> makeObjects(std::mt19937& gen, size_t n)
+  {
+    std::uniform_real_distribution<double> eta(-4.7, 4.7);
+    std::uniform_real_distribution<double> phi(-M_PI, M_PI);
+
+    dr::EtaPhiArrays<double> out;
+    for(size_t i = 0; i < n; ++i)
+      out.add(eta(gen), phi(gen));
+
+    return out;
+  }
+
+
+  // Cut decisions are only compared away from the boundary, where the two
+  // ways of wrapping phi may round differently
+  bool nearCut(double dR2, double cut)
+  {
+    return std::abs(dR2 - cut) < 1e-12;
+  }
+
+
+  void testAgainstScalar(std::mt19937& gen, size_t n)
+  {
+    const dr::EtaPhiArrays<double> objs = makeObjects(gen, n);
+    const dr::EtaPhiArrays<double> others = makeObjects(gen, 20);
+    std::uniform_real_distribution<double> ptDist(0., 50.);
+    std::vector<double> pts(n);
+    for(auto& pt : pts)
+      pt = ptDist(gen);
+
+    const double maxDR2 = 0.4 * 0.4;
+    const double vetoDR2 = 0.01 * 0.01;
+
+    std::vector<double> dR2s(n);
+    for(size_t k = 0; k < others.size(); ++k)
+      {
+        const double eta = others.eta[k];
+        const double phi = others.phi[k];
+
+        dr::deltaR2(eta, phi, objs.eta.data(), objs.phi.data(), n, dR2s.data());
+
+        std::vector<char> mask(n, 0);
+        dr::markWithin(eta, phi, objs.eta.data(), objs.phi.data(), n, maxDR2,
+                       mask.data());
+
+        double sum = 0.;
+        size_t best = n;
+        double bestDR2 = 0.;
+        bool any = false;
+        bool anyUncertain = false;
+        for(size_t i = 0; i < n; ++i)
+          {
+            const double ref = reco::deltaR2(objs.eta[i], objs.phi[i], eta, phi);
+            check(std::abs(dR2s[i] - ref) < 1e-12, "deltaR2", n, i);
+
+            if(!nearCut(ref, maxDR2))
+              check(bool(mask[i]) == (ref < maxDR2), "markWithin", n, i);
+
+            any |= ref < maxDR2;
+            anyUncertain |= nearCut(ref, maxDR2);
+            if(ref < maxDR2 && ref > vetoDR2)
+              sum += pts[i];
+            if(best == n || ref < bestDR2)
+              {
+                best = i;
+                bestDR2 = ref;
+              }
+          }
+
+        if(!anyUncertain)
+          check(dr::anyWithin(eta, phi, objs.eta.data(), objs.phi.data(), n, maxDR2) == any,
+                "anyWithin", n, k);
+
+        const double kernelSum = dr::coneSum(eta, phi, objs.eta.data(), objs.phi.data(),
+                                             pts.data(), n, maxDR2, vetoDR2);
+        check(std::abs(kernelSum - sum) < 1e-9 * (1. + sum), "coneSum", n, k);
+
+        double kernelDR2 = -1.;
+        const size_t kernelBest = dr::closest(eta, phi, objs.eta.data(),
+                                              objs.phi.data(), n, kernelDR2);
+        check(kernelBest == best && (n == 0 || std::abs(kernelDR2 - bestDR2) < 1e-12),
+              "closest", n, k);
+      }
+
+    // many vs. many
+    std::vector<char> mask;
+    dr::markWithinAny(objs, others, maxDR2, mask);
+    check(mask.size() == n, "markWithinAny size", n, 0);
+    for(size_t i = 0; i < n; ++i)
+      {
+        bool ref = false;
+        bool uncertain = false;
+        for(size_t k = 0; k < others.size(); ++k)
+          {
+            const double dR2 = reco::deltaR2(objs.eta[i], objs.phi[i],
+                                             others.eta[k], others.phi[k]);
+            ref |= dR2 < maxDR2;
+            uncertain |= nearCut(dR2, maxDR2);
+          }
+
+        if(!uncertain)
+          check(bool(mask[i]) == ref, "markWithinAny", n, i);
+      }
+
+    // phi wrapping right at the edges
+    check(std::abs(dr::deltaR2(0., M_PI - 0.01, 0., -M_PI + 0.01) - 0.02 * 0.02) < 1e-12,
+          "phi wrapping", 2, 0);
+  }
+
+
+  template<class F>
+  double timePerPair(F f, size_t nPairs, unsigned nReps, double& result)
+  {
+    const auto start = std::chrono::steady_clock::now();
+    for(unsigned r = 0; r < nReps; ++r)
+      result += f();
+    const auto stop = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::nano>(stop - start).count() / (double(nPairs) * nReps);
+  }
+
+
+  // Isolation-style cone sums of many objects around a few, and cleaning
+  // of many objects against a few, the way the plugins use them
+  void benchmark(std::mt19937& gen, size_t n, unsigned nReps)
+  {
+    const dr::EtaPhiArrays<double> objs = makeObjects(gen, n);
+    const dr::EtaPhiArrays<double> others = makeObjects(gen, 4);
+    std::vector<double> pts(n, 1.);
+
+    const double maxDR2 = 0.4 * 0.4;
+    const double vetoDR2 = 0.01 * 0.01;
+    const size_t nPairs = n * others.size();
+
+    double sink = 0.;
+
+    const double scalarSum = timePerPair([&]()
+      {
+        double total = 0.;
+        for(size_t k = 0; k < others.size(); ++k)
+          for(size_t i = 0; i < n; ++i)
+            {
+              const double dR2 = reco::deltaR2(objs.eta[i], objs.phi[i],
+                                               others.eta[k], others.phi[k]);
+              if(dR2 < maxDR2 && dR2 > vetoDR2)
+                total += pts[i];
+            }
+        return total;
+      }, nPairs, nReps, sink);
+
+    const double kernelSum = timePerPair([&]()
+      {
+        double total = 0.;
+        for(size_t k = 0; k < others.size(); ++k)
+          total += dr::coneSum(others.eta[k], others.phi[k], objs.eta.data(),
+                               objs.phi.data(), pts.data(), n, maxDR2, vetoDR2);
+        return total;
+      }, nPairs, nReps, sink);
+
+    std::vector<char> mask;
+    const double scalarClean = timePerPair([&]()
+      {
+        mask.assign(n, 0);
+        for(size_t i = 0; i < n; ++i)
+          for(size_t k = 0; k < others.size(); ++k)
+            {
+              if(reco::deltaR2(objs.eta[i], objs.phi[i],
+                               others.eta[k], others.phi[k]) < maxDR2)
+                {
+                  mask[i] = 1;
+                  break;
+                }
+            }
+        return double(mask[0]);
+      }, nPairs, nReps, sink);
+
+    const double kernelClean = timePerPair([&]()
+      {
+        dr::markWithinAny(objs, others, maxDR2, mask);
+        return double(mask[0]);
+      }, nPairs, nReps, sink);
+
+    std::cout << std::setw(6) << n
+              << std::fixed << std::setprecision(2)
+              << "  cone sum " << std::setw(6) << scalarSum << " -> "
+              << std::setw(6) << kernelSum << " ns/pair ("
+              << std::setw(5) << scalarSum / kernelSum << "x)"
+              << "  cleaning " << std::setw(6) << scalarClean << " -> "
+              << std::setw(6) << kernelClean << " ns/pair ("
+              << std::setw(5) << scalarClean / kernelClean << "x)"
+              << (sink == -1. ? " " : "") << std::endl;
+  }
+
+} // namespace
+
+
+int main(int argc, char** argv)
+{
+  const unsigned nReps = argc > 1 ? std::atoi(argv[1]) : 200;
+
+  std::mt19937 gen(12345);
+
+  for(size_t n : {0, 1, 7, 16, 100, 2000})
+    testAgainstScalar(gen, n);
+
+  if(nFailed)
+    {
+      std::cout << nFailed << " checks failed" << std::endl;
+      return 1;
+    }
+  std::cout << "All deltaR kernels agree with reco::deltaR2" << std::endl;
+
+  std::cout << "Scalar reco::deltaR2 loop -> kernel, against 4 objects:" << std::endl;
+  for(size_t n : {10, 100, 2000})
+    benchmark(gen, n, nReps);
+
+  return 0;
+}
@@ -0,0 +1,222 @@
+// Checks the LHE weight encodings in LHEWeightEncoding.h against the raw
+// weights they're made from: half floats must be within 2^-11 (relative)
+// of the relative weight, fixed point within the requested precision, and
+// the decoders must give the nominal weight times those (or the weights
+// themselves when the nominal weight is zero). Returns nonzero
+// if anything is out of bounds.
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <cmath>
+
+#include "UWVV/Utilities/interface/LHEWeightEncoding.h"
+
+
+using namespace uwvv::lheWeightEncoding;
+
+
+namespace
+{
+  unsigned long nFailed = 0;
+
+  void check(bool pass, const char* what, double raw, double decoded)
+  {
+    if(pass)
+      return;
+
+    if(++nFailed <= 10)
+      std::cout << "FAILED " << what << ": raw " << raw << " decoded "
+                << decoded << std::endl;
+  }
+
+
+  // Event weights: a nominal weight and relative weights around 1, made
+  // into raw float weights like the ones in the LHEEventProduct
+  struct Sample
+  {
+    float nominal;
+    std::vector<float> weights;
+  };
+
+  std::vector<Sample> makeSamples(std::mt19937& gen, size_t nEvents,
+                                  size_t nWeights, float spread)
+  {
+    std::lognormal_distribution<float> nominal(0., 2.);
+    std::lognormal_distribution<float> rel(0., spread);
+    std::uniform_real_distribution<float> flip(0., 1.);
+
+    std::vector<Sample> out(nEvents);
+    for(auto& s : out)
+      {
+        s.nominal = nominal(gen) * (flip(gen) < 0.1 ? -1.f : 1.f);
+        for(size_t i = 0; i < nWeights; ++i)
+          s.weights.push_back(s.nominal * rel(gen) * (flip(gen) < 0.01 ? -1.f : 1.f));
+      }
+
+    return out;
+  }
+
+
+  void testHalf(const std::vector<Sample>& samples)
+  {
+    const double bound = std::ldexp(1., -11);
+    const double minNormal = std::ldexp(1., -14);
+
+    std::vector<unsigned short> encoded;
+    std::vector<float> decoded;
+    for(const auto& s : samples)
+      {
+        encoded.clear();
+        for(float w : s.weights)
+          encoded.push_back(toHalf(double(w) / s.nominal));
+
+        decodeHalf(encoded, s.nominal, decoded);
+
+        for(size_t i = 0; i < encoded.size(); ++i)
+          {
+            const double rel = double(s.weights[i]) / s.nominal;
+            const double relDecoded = fromHalf(encoded[i]);
+
+            if(std::abs(rel) > 65504.)
+              check(std::isinf(relDecoded), "half overflow", rel, relDecoded);
+            else if(std::abs(rel) < minNormal)
+              check(std::abs(relDecoded - rel) <= std::ldexp(1., -25),
+                    "half subnormal", rel, relDecoded);
+            else
+              check(std::abs(relDecoded - rel) <= bound * std::abs(rel),
+                    "half relative weight", rel, relDecoded);
+
+            check(decoded[i] == s.nominal * fromHalf(encoded[i]),
+                  "decodeHalf", s.weights[i], decoded[i]);
+          }
+      }
+
+    // a double just above the midpoint of two halves, which rounds to the
+    // midpoint as a float, must still round up
+    check(toHalf(1. + std::ldexp(1., -11) + std::ldexp(1., -40)) == 0x3c01,
+          "half double rounding", 1. + std::ldexp(1., -11), 0.);
+    check(toHalf(1. + std::ldexp(1., -11)) == 0x3c00,
+          "half round to even", 1. + std::ldexp(1., -11), 0.);
+    check(std::isnan(fromHalf(toHalf(std::nan("")))), "half nan", 0., 0.);
+  }
+
+
+  void testFixed(const std::vector<Sample>& samples, double precision)
+  {
+    const double range = 65534. * fixedHalfStep(precision);
+
+    std::vector<unsigned short> encoded;
+    std::vector<float> decoded;
+    for(const auto& s : samples)
+      {
+        encoded.clear();
+        for(float w : s.weights)
+          encoded.push_back(toFixed(double(w) / s.nominal, precision));
+
+        decodeFixed(encoded, s.nominal, precision, decoded);
+
+        for(size_t i = 0; i < encoded.size(); ++i)
+          {
+            const double rel = double(s.weights[i]) / s.nominal;
+            const double relDecoded = fromFixed(encoded[i], precision);
+
+            // past the range, weights within half a step of it still get
+            // the last step; anything else must overflow
+            if(encoded[i] == overflowFixed)
+              {
+                check(std::abs(rel - 1.) > range, "fixed overflow in range", rel, relDecoded);
+                check(std::isnan(decoded[i]), "decodeFixed overflow", rel, decoded[i]);
+                continue;
+              }
+
+            check(std::abs(relDecoded - rel) <= precision,
+                  "fixed relative weight", rel, relDecoded);
+            check(std::abs(float(relDecoded) - rel) <= precision,
+                  "fixed relative weight as float", rel, float(relDecoded));
+            check(decoded[i] == float(s.nominal * relDecoded),
+                  "decodeFixed", s.weights[i], decoded[i]);
+          }
+      }
+
+    // the edges of the range and just past them
+    for(double rel : {1. - range, 1. + range})
+      check(std::abs(fromFixed(toFixed(rel, precision), precision) - rel) <= precision,
+            "fixed range edge", rel, fromFixed(toFixed(rel, precision), precision));
+    for(double rel : {1. - range - 2. * precision, 1. + range + 2. * precision})
+      check(toFixed(rel, precision) == overflowFixed, "fixed past range edge", rel, 0.);
+    check(toFixed(std::nan(""), precision) == overflowFixed, "fixed nan", 0., 0.);
+  }
+
+
+  // With a zero (or non-finite) nominal weight there is nothing to divide
+  // by, so the weights are stored as they are and must decode to themselves
+  void testZeroNominal()
+  {
+    const std::vector<float> weights = {0.f, 1.f, -1.f, 0.5f, 3.25f, -12.f};
+    const double precision = 1e-4;
+
+    std::vector<unsigned short> encoded;
+    std::vector<float> decoded;
+    for(float nominal : {0.f, -0.f, float(std::nan("")), HUGE_VALF})
+      {
+        check(referenceWeight(nominal) == 1., "reference weight", nominal,
+              referenceWeight(nominal));
+
+        encodeHalf(weights, nominal, encoded);
+        decodeHalf(encoded, nominal, decoded);
+        for(size_t i = 0; i < weights.size(); ++i)
+          check(encoded[i] == toHalf(weights[i]) && decoded[i] == weights[i],
+                "half zero nominal", weights[i], decoded[i]);
+
+        encodeFixed(weights, nominal, precision, encoded);
+        decodeFixed(encoded, nominal, precision, decoded);
+        for(size_t i = 0; i < weights.size(); ++i)
+          {
+            // the fixed point range is around 1 either way
+            if(std::abs(weights[i] - 1.) > 65534. * fixedHalfStep(precision))
+              check(std::isnan(decoded[i]), "fixed zero nominal overflow", weights[i], decoded[i]);
+            else
+              check(std::abs(decoded[i] - weights[i]) <= precision,
+                    "fixed zero nominal", weights[i], decoded[i]);
+          }
+      }
+
+    // nonzero nominal weights are still divided out
+    encodeHalf(weights, 2., encoded);
+    for(size_t i = 0; i < weights.size(); ++i)
+      check(encoded[i] == toHalf(weights[i] / 2.), "half nonzero nominal",
+            weights[i], fromHalf(encoded[i]));
+  }
+
+} // namespace
+
+
+int main()
+{
+  std::mt19937 gen(12345);
+
+  // scale/PDF-like weights close to 1, and wilder ones
+  std::vector<Sample> narrow = makeSamples(gen, 20000, 100, 0.1);
+  std::vector<Sample> wide = makeSamples(gen, 20000, 100, 1.);
+
+  testHalf(narrow);
+  testHalf(wide);
+
+  for(double precision : {1e-2, 1e-3, 1e-4, 1e-5, minFixedPrecision})
+    {
+      testFixed(narrow, precision);
+      testFixed(wide, precision);
+    }
+
+  testZeroNominal();
+
+  if(nFailed)
+    {
+      std::cout << nFailed << " checks failed" << std::endl;
+      return 1;
+    }
+
+  std::cout << "All LHE weight encoding checks passed" << std::endl;
+  return 0;
+}